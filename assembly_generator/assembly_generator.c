@@ -12,25 +12,19 @@
 #include <llvm-c/IRReader.h>
 #include <llvm-c/Types.h>
 #include "../syntax_analyzer/semantic_analysis.h"
+#include "../syntax_analyzer/parser.h"
 #include "../llvm_ir_builder/llvm_gen.h"
 #include "../optimizer/llvm_optimizations.h"
 #include "../helper/helper_functions.h"
 #include "llvm_to_assembly.h"
 using namespace std;
 
-/* EXTERNS */
-/* ------- */
-
-extern void yyparse();
-extern int yylex_destroy();
-extern FILE *yyin;
-extern char* yytext;
-
-
 /* GLOBAL VARIABLES */
 /* ---------------- */
 
 astNode* root; // root of the AST
+astArena* arena; // owns every node of the AST
+FILE* input = stdin; // source file, or stdin if none is given
 
 /* MAIN */
 /* ---- */
@@ -38,34 +32,35 @@ astNode* root; // root of the AST
 int main(int argc, char** argv){
 	
 	if (argc >= 3){
-		yyin = fopen(argv[2], "r");
+		input = fopen(argv[2], "r");
 	}
 
 	LLVMModuleRef llvm_ir;
 	if(strcmp("build", argv[1]) == 0) {
 		// generate the AST
-		yyparse();
+		arena = createArena();
+		root = parseFile(input, arena);
 
-		// generate LLVM
-		llvm_ir = createLLVMModelFromAST(root, argv[2]);
-		optimizeLLVMBasicBlocks(llvm_ir);
-
-		// check semantics
+		// check semantics, which resolves the variables for the IR builder
 		bool valid_semantics = semanticAnalysis_opt(root);
 
 		if(!valid_semantics) {
-			freeNode(root);
+			freeArena(arena);
 			printf("FAILURE: Semantics Failed\n");
 			return 1;
 		}
 
+		// generate LLVM
+		llvm_ir = createLLVMModelFromAST(root, argv[2]);
+		optimizeLLVMBasicBlocks(llvm_ir);
+
 		// add optimizations here
 		optimizeLLVM(llvm_ir);
 
 		// generate assembly
 		codegen(llvm_ir, argv[3]);
 
-		freeNode(root);
+		freeArena(arena);
 
 	} else {
 		llvm_ir = createLLVMModel(argv[2]);
@@ -78,9 +73,8 @@ int main(int argc, char** argv){
 	}
 
 	// close
-	if (yyin != stdin) {
-		fclose(yyin);
-		yylex_destroy();
+	if (input != stdin) {
+		fclose(input);
 	}
 	
 	return 0;
@@ -6,8 +6,11 @@
 #include <string.h>
 #include <stdbool.h>
 #include "../optimizer/llvm_optimizations.h"
+#include "../optimizer/pass_manager.h"
 #include "llvm_to_assembly.h"
+#include "../helper/time_report.h"
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <set>
 #include <array>
@@ -30,8 +33,15 @@ void registerAllocation(LLVMValueRef func);
     LLVMValueRef findSpill();
     void releaseOperands(LLVMValueRef instruction, int index);
 
+// methods to take SSA values the registers cannot hold back to memory
+void demoteSSAValues(LLVMValueRef func);
+    LLVMValueRef findParameterSlot(LLVMValueRef func);
+    LLVMValueRef addDemotionSlot(LLVMBuilderRef builder, LLVMValueRef func);
+    void demoteValue(LLVMBuilderRef builder, LLVMValueRef func, LLVMValueRef value, unordered_map<LLVMValueRef, int>& positions);
+
 // other helper methods
 void createBBLabels(LLVMValueRef func);
+void markLoopHeaders(LLVMValueRef func);
 void printDirectives(LLVMValueRef func, char* filename);
 void printFunctionEnd(LLVMValueRef func);
 void getOffsetMap(LLVMValueRef func);
@@ -50,17 +60,19 @@ void handleArithmetic(LLVMValueRef instruction);
 /* GLOBAL VARIABLES */
 /* ---------------- */
 
-unordered_map<LLVMValueRef, int> instIndex;
-unordered_map<LLVMValueRef, array<int, 2>> liveRange;
-vector<LLVMValueRef> sortedList;
-unordered_map<LLVMValueRef, string> regMap;
-vector<string> regPool;
+thread_local unordered_map<LLVMValueRef, int> instIndex;
+thread_local unordered_map<LLVMValueRef, array<int, 2>> liveRange;
+thread_local vector<LLVMValueRef> sortedList;
+thread_local unordered_map<LLVMValueRef, string> regMap;
+thread_local vector<string> regPool;
 
-unordered_map<LLVMBasicBlockRef, string> bbLabels;
-unordered_map<LLVMValueRef, int> offsetMap;
-int localMem;
+thread_local unordered_map<LLVMBasicBlockRef, string> bbLabels;
+thread_local unordered_set<LLVMBasicBlockRef> loopHeaders;
+thread_local unordered_map<LLVMValueRef, int> offsetMap;
+thread_local LLVMValueRef parameterSlot; // the allocation the parameter lives in at 8(%ebp), or NULL
+thread_local int localMem;
 
-FILE *fptr;
+thread_local FILE *fptr;
 
 /* FUNCTIONS */
 /* --------- */
@@ -197,17 +209,7 @@ void registerAllocation(LLVMValueRef func) {
             } else if(opcode == LLVMAdd || opcode == LLVMSub || opcode == LLVMMul) {
                 assert(LLVMGetNumOperands(instruction) == 2);
                 LLVMValueRef operand1 = LLVMGetOperand(instruction, 0);
-
-                // check the second operand, and if it ends, return its register to register pool
                 LLVMValueRef operand2 = LLVMGetOperand(instruction, 1);
-                if(regMap.count(operand2) > 0 && regMap[operand2] != "-1") {
-                    assert(liveRange.count(operand2) != 0);
-
-                    // if this is that operands last use, we can transfer the register
-                    if(liveRange[operand2][1] == index) {
-                        regPool.push_back(regMap[operand2]);
-                    }
-                }
 
                 // check if the operand is assigned to a register
                 if(regMap.count(operand1) > 0 && regMap[operand1] != "-1") {
@@ -216,6 +218,15 @@ void registerAllocation(LLVMValueRef func) {
                     // if this is that operands last use, we can transfer the register
                     if(liveRange[operand1][1] == index) {
                         regMap[instruction] = regMap[operand1];
+
+                        // and return the second operand's register to the pool if it ends too -
+                        // not before, as the result must not be given the register it still reads
+                        if(operand2 != operand1 && regMap.count(operand2) > 0 && regMap[operand2] != "-1") {
+                            assert(liveRange.count(operand2) != 0);
+                            if(liveRange[operand2][1] == index) {
+                                regPool.push_back(regMap[operand2]);
+                            }
+                        }
                         continue;
                     }   
                 } 
@@ -279,7 +290,7 @@ void releaseOperands(LLVMValueRef instruction, int index) {
     // loop through operands
     for(int i = 0; i < LLVMGetNumOperands(instruction); i++) {
         LLVMValueRef operand = LLVMGetOperand(instruction, i);
-        if(liveRange.count(operand) == 0) {
+        if(liveRange.count(operand) == 0 || (i > 0 && operand == LLVMGetOperand(instruction, i - 1))) {
             continue;
         }
 
@@ -305,6 +316,11 @@ void codegen(LLVMModuleRef mod, char* filename) {
     assert(mod != NULL);
     assert(filename != NULL);
 
+    // forget the registers, labels and offsets of any previously generated module
+    regMap.clear();
+    bbLabels.clear();
+    offsetMap.clear();
+
     fptr = fopen(filename, "w");
 
     // loop through each function
@@ -317,14 +333,18 @@ void codegen(LLVMModuleRef mod, char* filename) {
         }
 
         // get the parameter
-        LLVMValueRef parameter;
+        LLVMValueRef parameter = NULL;
         if(LLVMCountParams(func) == 1) {
             parameter = LLVMGetParam(func, 0);
         }
 
         // allocate registers and populate global variables
+        demoteSSAValues(func);
         createBBLabels(func);
+        markLoopHeaders(func);
+        startPhase("registerAllocation", NULL);
         registerAllocation(func);
+        endPhase(NULL);
         printDirectives(func, filename);
         getOffsetMap(func);
 
@@ -333,6 +353,9 @@ void codegen(LLVMModuleRef mod, char* filename) {
             bb;
             bb = LLVMGetNextBasicBlock(bb)) {
 
+            if(loopHeaders.count(bb) != 0) {
+                fprintf(fptr, "\t.p2align 4,,10\n");
+            }
             fprintf(fptr, "%s:\n", bbLabels[bb].c_str());
             if(bb == LLVMGetFirstBasicBlock(func)) {
                 printStack();
@@ -392,6 +415,197 @@ void codegen(LLVMModuleRef mod, char* filename) {
     }
 }
 
+/* takes back to memory the SSA values of a function built in SSA form that the backend
+ * cannot keep in a register, as registers are only allocated within a block:
+ * each phi becomes a slot its predecessors store their value to before branching and its block
+ * loads at the top, and each value used outside its block (and the parameter, read from its
+ * own slot at 8(%ebp)) is stored to a slot after its definition and loaded in the blocks using it
+ * undefined values become 0, and a branch whose condition was computed elsewhere recomputes it
+ * right before branching, as it branches on the flags the comparison sets
+ * a function built with its variables in memory has none of these and is left as it is
+ */
+void demoteSSAValues(LLVMValueRef func) {
+    assert(func != NULL);
+
+    LLVMContextRef context = LLVMGetModuleContext(LLVMGetGlobalParent(func));
+    LLVMValueRef zero = LLVMConstInt(LLVMInt32TypeInContext(context), 0, false);
+    LLVMBuilderRef builder = LLVMCreateBuilderInContext(context);
+    vector<LLVMValueRef> phis;
+    vector<LLVMValueRef> values;
+
+    // a function built with its variables in memory stores the parameter to its variable first
+    parameterSlot = findParameterSlot(func);
+
+    for(LLVMBasicBlockRef bb = LLVMGetFirstBasicBlock(func);
+        bb;
+        bb = LLVMGetNextBasicBlock(bb)) {
+
+        // recompute the condition of a branch that is not right after it
+        LLVMValueRef terminator = LLVMGetBasicBlockTerminator(bb);
+        if(terminator != NULL && LLVMGetInstructionOpcode(terminator) == LLVMBr && LLVMGetNumOperands(terminator) == 3) {
+            LLVMValueRef cmp = LLVMGetOperand(terminator, 0);
+            if(LLVMIsAInstruction(cmp) && LLVMGetPreviousInstruction(terminator) != cmp) {
+                assert(LLVMGetInstructionOpcode(cmp) == LLVMICmp);
+                LLVMValueRef copy = LLVMInstructionClone(cmp);
+                LLVMPositionBuilderBefore(builder, terminator);
+                LLVMInsertIntoBuilder(builder, copy);
+                LLVMSetOperand(terminator, 0, copy);
+                if(LLVMGetFirstUse(cmp) == NULL) {
+                    LLVMInstructionEraseFromParent(cmp);
+                }
+            }
+        }
+
+        for(LLVMValueRef instruction = LLVMGetFirstInstruction(bb);
+            instruction;
+            instruction = LLVMGetNextInstruction(instruction)) {
+
+            for(int i = 0; i < LLVMGetNumOperands(instruction); i++) {
+                if(LLVMIsUndef(LLVMGetOperand(instruction, i))) {
+                    LLVMSetOperand(instruction, i, zero);
+                }
+            }
+
+            if(LLVMIsAPHINode(instruction)) {
+                phis.push_back(instruction);
+            } else if(LLVMGetInstructionOpcode(instruction) != LLVMAlloca && LLVMGetFirstUse(instruction) != NULL) {
+                values.push_back(instruction);
+            }
+        }
+    }
+
+    // each predecessor stores its value of the phi, which is loaded after the block's phis
+    for(size_t p = 0; p < phis.size(); p++) {
+        LLVMValueRef phi = phis[p];
+        LLVMValueRef slot = addDemotionSlot(builder, func);
+        for(unsigned i = 0; i < LLVMCountIncoming(phi); i++) {
+            LLVMPositionBuilderBefore(builder, LLVMGetBasicBlockTerminator(LLVMGetIncomingBlock(phi, i)));
+            LLVMBuildStore(builder, LLVMGetIncomingValue(phi, i), slot);
+        }
+
+        LLVMValueRef first = LLVMGetFirstInstruction(LLVMGetInstructionParent(phi));
+        while(LLVMIsAPHINode(first)) {
+            first = LLVMGetNextInstruction(first);
+        }
+        LLVMPositionBuilderBefore(builder, first);
+        LLVMValueRef load = LLVMBuildLoad2(builder, LLVMInt32TypeInContext(context), slot, "");
+        values.push_back(load);
+        LLVMReplaceAllUsesWith(phi, load);
+        LLVMInstructionEraseFromParent(phi);
+    }
+
+    // the position of each instruction in its block, to find the first use of a value in a block
+    unordered_map<LLVMValueRef, int> positions;
+    for(LLVMBasicBlockRef bb = LLVMGetFirstBasicBlock(func);
+        bb;
+        bb = LLVMGetNextBasicBlock(bb)) {
+
+        int index = 0;
+        for(LLVMValueRef instruction = LLVMGetFirstInstruction(bb);
+            instruction;
+            instruction = LLVMGetNextInstruction(instruction)) {
+            positions[instruction] = index++;
+        }
+    }
+
+    if(LLVMCountParams(func) == 1) {
+        demoteValue(builder, func, LLVMGetParam(func, 0), positions);
+    }
+    for(size_t i = 0; i < values.size(); i++) {
+        demoteValue(builder, func, values[i], positions);
+    }
+
+    LLVMDisposeBuilder(builder);
+}
+
+/* returns the allocation of the parameter's variable, the destination of the store of the parameter
+ * in the first block, or NULL if the function has no parameter or no such store
+ */
+LLVMValueRef findParameterSlot(LLVMValueRef func) {
+    if(LLVMCountParams(func) != 1) {
+        return NULL;
+    }
+
+    LLVMValueRef param = LLVMGetParam(func, 0);
+    for(LLVMValueRef instruction = LLVMGetFirstInstruction(LLVMGetFirstBasicBlock(func));
+        instruction;
+        instruction = LLVMGetNextInstruction(instruction)) {
+
+        if(LLVMGetInstructionOpcode(instruction) == LLVMStore && LLVMGetOperand(instruction, 0) == param
+            && LLVMIsAAllocaInst(LLVMGetOperand(instruction, 1))) {
+            return LLVMGetOperand(instruction, 1);
+        }
+    }
+    return NULL;
+}
+
+/* adds an allocation to the top of the first block, where getOffsetMap expects it */
+LLVMValueRef addDemotionSlot(LLVMBuilderRef builder, LLVMValueRef func) {
+    LLVMPositionBuilderBefore(builder, LLVMGetFirstInstruction(LLVMGetEntryBasicBlock(func)));
+    LLVMValueRef slot = LLVMBuildAlloca(builder, LLVMInt32TypeInContext(LLVMGetModuleContext(LLVMGetGlobalParent(func))), "");
+    LLVMSetAlignment(slot, 4);
+    return slot;
+}
+
+/* stores the value to a slot after its definition and loads it before its first use in every
+ * other block using it, if there is one - for the parameter, every use but its stores to slots,
+ * and its slot becomes its home at 8(%ebp) unless its variable already is
+ */
+void demoteValue(LLVMBuilderRef builder, LLVMValueRef func, LLVMValueRef value, unordered_map<LLVMValueRef, int>& positions) {
+    bool isParam = !LLVMIsAInstruction(value);
+    LLVMBasicBlockRef home = isParam ? NULL : LLVMGetInstructionParent(value);
+
+    // the users that need the value loaded, and the first of them in each block
+    unordered_set<LLVMValueRef> users;
+    unordered_map<LLVMBasicBlockRef, LLVMValueRef> firstUsers;
+    for(LLVMUseRef use = LLVMGetFirstUse(value); use; use = LLVMGetNextUse(use)) {
+        LLVMValueRef user = LLVMGetUser(use);
+        LLVMBasicBlockRef block = LLVMGetInstructionParent(user);
+        if(block == home || (isParam && LLVMGetInstructionOpcode(user) == LLVMStore && LLVMGetOperand(user, 0) == value)) {
+            continue;
+        }
+        users.insert(user);
+        if(firstUsers.count(block) == 0 || positions[user] < positions[firstUsers[block]]) {
+            firstUsers[block] = user;
+        }
+    }
+    if(users.empty()) {
+        return;
+    }
+
+    // store it once it is defined - the parameter after the allocations, before anything can
+    // overwrite its home, in a slot only it is stored to, which becomes its home if it has none
+    LLVMValueRef slot = addDemotionSlot(builder, func);
+    if(isParam) {
+        if(parameterSlot == NULL) {
+            parameterSlot = slot;
+        }
+        LLVMValueRef first = LLVMGetFirstInstruction(LLVMGetEntryBasicBlock(func));
+        while(LLVMGetInstructionOpcode(first) == LLVMAlloca) {
+            first = LLVMGetNextInstruction(first);
+        }
+        LLVMPositionBuilderBefore(builder, first);
+    } else {
+        LLVMPositionBuilderBefore(builder, LLVMGetNextInstruction(value));
+    }
+    LLVMBuildStore(builder, value, slot);
+
+    // load it in each block and have that block's users use the load
+    unordered_map<LLVMBasicBlockRef, LLVMValueRef> loads;
+    for(unordered_map<LLVMBasicBlockRef, LLVMValueRef>::iterator it = firstUsers.begin(); it != firstUsers.end(); it++) {
+        LLVMPositionBuilderBefore(builder, it->second);
+        loads[it->first] = LLVMBuildLoad2(builder, LLVMTypeOf(value), slot, "");
+    }
+    for(unordered_set<LLVMValueRef>::iterator it = users.begin(); it != users.end(); it++) {
+        LLVMBasicBlockRef block = LLVMGetInstructionParent(*it);
+        for(int i = 0; i < LLVMGetNumOperands(*it); i++) {
+            if(LLVMGetOperand(*it, i) == value) {
+                LLVMSetOperand(*it, i, loads[block]);
+            }
+        }
+    }
+}
+
 /* assigns each basic block in the module a char* label
  * the first block will be assigned '.LFB0'
  * all subsequent blocks will be labeled '.[block index]'
@@ -419,6 +633,28 @@ void createBBLabels(LLVMValueRef func) {
     }
 }
 
+/* finds the headers of the function's loops, where the code that runs the most starts,
+ * to align them - every block ends in a jump, so the padding before them never runs
+ * a loop whose header is the first block is left as it is, as its padding would run
+ * only the headers are needed, so the loops themselves are never built
+ */
+void markLoopHeaders(LLVMValueRef func) {
+    loopHeaders.clear();
+
+    functionAnalyses* analyses = requireAnalysis(func, analysis_dominators);
+    vector<int> headers = findLoopHeaders(analyses->successors, analyses->idom, analyses->domPreorder, analyses->domPostorder, 0);
+    vector<int>::iterator it = headers.begin();
+    while(it != headers.end()) {
+        if(*it != 0) {
+            loopHeaders.insert(analyses->blocks[*it]);
+        }
+        it++;
+    }
+
+    // the function is not optimized any further, so nothing else needs its analyses
+    invalidateAnalyses(func);
+}
+
 /* prints the directives of the function */
 void printDirectives(LLVMValueRef func, char* filename) {
     assert(func != NULL);
@@ -458,28 +694,9 @@ void getOffsetMap(LLVMValueRef func) {
     int offset = 0;
 
     // set local variable of parameter to have offset 8
-    LLVMValueRef paramAlloca = NULL;
-    if(LLVMCountParams(func) == 1) {
-        // get the parameter
-        LLVMValueRef param = LLVMGetParam(func, 0);
-        
-        // loop through for the store instruction 
-        for(LLVMValueRef instruction = LLVMGetFirstInstruction(LLVMGetFirstBasicBlock(func));
-            instruction;
-            instruction = LLVMGetNextInstruction(instruction)) {
-            
-            // if store instruction with store value of parameter
-            if(LLVMGetInstructionOpcode(instruction) == LLVMStore) {
-                if(LLVMGetOperand(instruction, 0) == param) {
-                    // set the allocation address to be the second operand
-                    paramAlloca = LLVMGetOperand(instruction, 1);
-                    break;
-                }
-            }
-        }
-
+    LLVMValueRef paramAlloca = parameterSlot;
+    if(paramAlloca != NULL) {
         offsetMap[paramAlloca] = 8;
-
     }
 
     // loop through all allocas instructions
@@ -493,19 +710,20 @@ void getOffsetMap(LLVMValueRef func) {
         allocaInstruction = LLVMGetNextInstruction(allocaInstruction);
     }
 
-     // loop through all instructions for loads to set offset to same as local var
-    for(LLVMValueRef instruction = LLVMGetFirstInstruction(LLVMGetFirstBasicBlock(func));
-        instruction;
-        instruction = LLVMGetNextInstruction(instruction)) {
-        
-        // if store instruction with store value of parameter
-        if(LLVMGetInstructionOpcode(instruction) == LLVMLoad) {
-           assert(regMap.count(instruction) != 0);
-           if(regMap[instruction] == "-1") {
-                LLVMValueRef addr = LLVMGetOperand(instruction, 0);
-                assert(offsetMap.count(addr) != 0);
-                offsetMap[instruction] = offsetMap[addr];
-           }
+    // every spilled value gets a slot of its own - a spilled load cannot share its variable's,
+    // as the variable may be stored to before the load's last use
+    for(LLVMBasicBlockRef bb = LLVMGetFirstBasicBlock(func);
+        bb;
+        bb = LLVMGetNextBasicBlock(bb)) {
+
+        for(LLVMValueRef instruction = LLVMGetFirstInstruction(bb);
+            instruction;
+            instruction = LLVMGetNextInstruction(instruction)) {
+
+            if(regMap.count(instruction) != 0 && regMap[instruction] == "-1" && offsetMap.count(instruction) == 0) {
+                offset += 4;
+                offsetMap[instruction] = -offset;
+            }
         }
     }
 
@@ -564,12 +782,13 @@ void handleLoad(LLVMValueRef instruction) {
         int offset = offsetMap[loadVal];
         fprintf(fptr, "\tmovl %d(%%ebp), %%%s\n", offset, regMap[instruction].c_str());
     } else {
-        // load register to register
+        // load memory to memory, through eax
         assert(offsetMap.count(loadVal) != 0);
         assert(offsetMap.count(instruction) != 0);
         int offset1 = offsetMap[loadVal];
         int offset2 = offsetMap[instruction];
-        fprintf(fptr, "\tmovl %d(%%ebp), %d(%%ebp)\n", offset1, offset2);
+        fprintf(fptr, "\tmovl %d(%%ebp), %%eax\n", offset1);
+        fprintf(fptr, "\tmovl %%eax, %d(%%ebp)\n", offset2);
     }
 }
 
@@ -584,12 +803,17 @@ void handleStore(LLVMValueRef instruction, LLVMValueRef parameter) {
     LLVMValueRef destination = LLVMGetOperand(instruction, 1);
     assert(offsetMap.count(destination) != 0);
 
-    // skip if it is a parameter
-    if(storeVal == parameter) {
+    // skip the store giving the parameter its home, which it is already in
+    if(storeVal == parameter && destination == parameterSlot) {
         return;
     }
 
-    if(LLVMIsAConstantInt(storeVal)) { // constant store value
+    if(storeVal == parameter) { // parameter stored to another slot, through eax
+        int offset = offsetMap[destination];
+        fprintf(fptr, "\tmovl 8(%%ebp), %%eax\n");
+        fprintf(fptr, "\tmovl %%eax, %d(%%ebp)\n", offset);
+
+    } else if(LLVMIsAConstantInt(storeVal)) { // constant store value
         int val = LLVMConstIntGetSExtValue(storeVal);
         int offset = offsetMap[destination];
         fprintf(fptr, "\tmovl $%d, %d(%%ebp)\n", val, offset);
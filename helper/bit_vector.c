@@ -0,0 +1,114 @@
+/*
+ * Library for the dense bit vectors used by the dataflow analyses
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "bit_vector.h"
+#include <algorithm>
+//#define NDEBUG
+#include <cassert>
+
+using namespace std;
+
+/* creates an empty bit vector that can hold the integers [0, size) */
+bitVector createBitVector(int size) {
+    assert(size >= 0);
+
+    bitVector bv;
+    bv.size = size;
+    bv.words.assign((size + 63) / 64, 0);
+    return bv;
+}
+
+/* removes every integer from the bit vector */
+void clearBitVector(bitVector* bv) {
+    assert(bv != NULL);
+    fill(bv->words.begin(), bv->words.end(), 0);
+}
+
+/* adds an integer to the bit vector */
+void setBit(bitVector* bv, int index) {
+    assert(bv != NULL);
+    assert(index >= 0 && index < bv->size);
+    bv->words[index / 64] |= ((uint64_t) 1) << (index % 64);
+}
+
+/* removes an integer from the bit vector */
+void resetBit(bitVector* bv, int index) {
+    assert(bv != NULL);
+    assert(index >= 0 && index < bv->size);
+    bv->words[index / 64] &= ~(((uint64_t) 1) << (index % 64));
+}
+
+/* returns true if the integer is in the bit vector */
+bool testBit(const bitVector* bv, int index) {
+    assert(bv != NULL);
+    assert(index >= 0 && index < bv->size);
+    return (bv->words[index / 64] >> (index % 64)) & 1;
+}
+
+/* dest = dest U src
+ * returns true if dest gained any integers
+ */
+bool unionBitVector(bitVector* dest, const bitVector* src) {
+    assert(dest != NULL && src != NULL);
+    assert(dest->size == src->size);
+
+    uint64_t changed = 0;
+    for(size_t i = 0; i < dest->words.size(); i++) {
+        uint64_t merged = dest->words[i] | src->words[i];
+        changed |= merged ^ dest->words[i];
+        dest->words[i] = merged;
+    }
+    return changed != 0;
+}
+
+/* dest = dest - src */
+void differenceBitVector(bitVector* dest, const bitVector* src) {
+    assert(dest != NULL && src != NULL);
+    assert(dest->size == src->size);
+
+    for(size_t i = 0; i < dest->words.size(); i++) {
+        dest->words[i] &= ~src->words[i];
+    }
+}
+
+/* returns true if both bit vectors hold the same integers */
+bool equalBitVector(const bitVector* a, const bitVector* b) {
+    assert(a != NULL && b != NULL);
+    return a->size == b->size && a->words == b->words;
+}
+
+/* returns the smallest integer >= from in the bit vector, or -1 if there is none
+ * use as: for(int i = nextSetBit(bv, 0); i != -1; i = nextSetBit(bv, i + 1))
+ */
+int nextSetBit(const bitVector* bv, int from) {
+    return nextSetBitInBoth(bv, bv, from);
+}
+
+/* returns the smallest integer >= from in both bit vectors, or -1 if there is none
+ * the intersection is never materialized
+ */
+int nextSetBitInBoth(const bitVector* a, const bitVector* b, int from) {
+    assert(a != NULL && b != NULL);
+    assert(a->size == b->size);
+
+    if(from >= a->size) {
+        return -1;
+    }
+
+    // mask off the bits below from in the first word
+    size_t word = from / 64;
+    uint64_t bits = (a->words[word] & b->words[word]) & (~((uint64_t) 0) << (from % 64));
+
+    while(bits == 0) {
+        word++;
+        if(word >= a->words.size()) {
+            return -1;
+        }
+        bits = a->words[word] & b->words[word];
+    }
+
+    return word * 64 + __builtin_ctzll(bits);
+}
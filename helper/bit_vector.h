@@ -0,0 +1,33 @@
+#ifndef BIT_VECTOR_H
+#define BIT_VECTOR_H
+
+#include <stdint.h>
+#include <vector>
+
+using namespace std;
+
+/* dense, fixed-size set of small integers stored as 64-bit words
+ * so that unions, differences and comparisons are done a word at a time
+ */
+typedef struct {
+		int size; // number of bits in the set
+		vector<uint64_t> words;
+	} bitVector;
+
+/* FUNCTIONS */
+/* --------- */
+
+bitVector createBitVector(int size);
+void clearBitVector(bitVector* bv);
+
+void setBit(bitVector* bv, int index);
+void resetBit(bitVector* bv, int index);
+bool testBit(const bitVector* bv, int index);
+
+bool unionBitVector(bitVector* dest, const bitVector* src);
+void differenceBitVector(bitVector* dest, const bitVector* src);
+bool equalBitVector(const bitVector* a, const bitVector* b);
+int nextSetBit(const bitVector* bv, int from);
+int nextSetBitInBoth(const bitVector* a, const bitVector* b, int from);
+
+#endif
@@ -0,0 +1,199 @@
+/*
+ * Library that numbers the blocks of a function and stores its control flow graph
+ * as flat arrays of edges, so that analyses can walk it without hashing or allocating per block
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "cfg.h"
+//#define NDEBUG
+#include <cassert>
+
+using namespace std;
+
+/* FUNCTIONS */
+/* --------- */
+
+/* numbers the blocks of the function in reverse postorder and builds its successor and
+ * predecessor lists from the targets of each block's terminator
+ * blocks without a terminator have no successors
+ */
+controlFlowGraph buildControlFlowGraph(LLVMValueRef func) {
+    controlFlowGraph cfg;
+
+    // number the blocks in layout order to collect the edges
+    vector<LLVMBasicBlockRef> layout;
+    for(LLVMBasicBlockRef bb = LLVMGetFirstBasicBlock(func);
+        bb;
+        bb = LLVMGetNextBasicBlock(bb)) {
+
+        cfg.blockIndex[bb] = layout.size();
+        layout.push_back(bb);
+    }
+    int numBlocks = layout.size();
+
+    vector<pair<int, int>> edges;
+    for(int b = 0; b < numBlocks; b++) {
+        LLVMValueRef terminator = LLVMGetBasicBlockTerminator(layout[b]);
+        if(!terminator) {
+            continue;
+        }
+
+        size_t first = edges.size();
+        unsigned numSuccessors = LLVMGetNumSuccessors(terminator);
+        for(unsigned i = 0; i < numSuccessors; i++) {
+            assert(cfg.blockIndex.count(LLVMGetSuccessor(terminator, i)) != 0);
+            int successor = cfg.blockIndex[LLVMGetSuccessor(terminator, i)];
+
+            // a branch naming the same block twice is a single edge
+            bool duplicate = false;
+            for(size_t e = first; e < edges.size(); e++) {
+                duplicate |= (edges[e].second == successor);
+            }
+            if(!duplicate) {
+                edges.push_back(make_pair(b, successor));
+            }
+        }
+    }
+
+    // renumber the blocks and their edges in reverse postorder
+    vector<int> order = reversePostorder(buildCSRGraph(numBlocks, edges), 0, &cfg.numReachable);
+    vector<int> number(numBlocks);
+    cfg.blocks.resize(numBlocks);
+    for(int i = 0; i < numBlocks; i++) {
+        number[order[i]] = i;
+        cfg.blocks[i] = layout[order[i]];
+        cfg.blockIndex[layout[order[i]]] = i;
+    }
+
+    vector<pair<int, int>>::iterator it = edges.begin();
+    while(it != edges.end()) {
+        it->first = number[it->first];
+        it->second = number[it->second];
+        it++;
+    }
+
+    cfg.successors = buildCSRGraph(numBlocks, edges);
+    cfg.predecessors = transposeGraph(cfg.successors);
+    return cfg;
+}
+
+/* builds the graph from a list of edges (source, target), keeping the order
+ * the edges of each block appear in
+ */
+csrGraph buildCSRGraph(int numBlocks, const vector<pair<int, int>>& edges) {
+    csrGraph graph;
+    graph.offsets.assign(numBlocks + 1, 0);
+    graph.targets.resize(edges.size());
+
+    // count the edges of each block, then place each edge after those of the blocks before it
+    vector<pair<int, int>>::const_iterator it = edges.begin();
+    while(it != edges.end()) {
+        assert(it->first >= 0 && it->first < numBlocks && it->second >= 0 && it->second < numBlocks);
+        graph.offsets[it->first + 1]++;
+        it++;
+    }
+    for(int b = 0; b < numBlocks; b++) {
+        graph.offsets[b + 1] += graph.offsets[b];
+    }
+
+    vector<int> next(graph.offsets.begin(), graph.offsets.end() - 1);
+    it = edges.begin();
+    while(it != edges.end()) {
+        graph.targets[next[it->first]++] = it->second;
+        it++;
+    }
+
+    return graph;
+}
+
+/* reverses every edge of the graph, the edges of each block in the order of their sources */
+csrGraph transposeGraph(const csrGraph& graph) {
+    int numBlocks = graphSize(graph);
+    csrGraph transposed;
+    transposed.offsets.assign(numBlocks + 1, 0);
+    transposed.targets.resize(graph.targets.size());
+
+    vector<int>::const_iterator it = graph.targets.begin();
+    while(it != graph.targets.end()) {
+        transposed.offsets[*it + 1]++;
+        it++;
+    }
+    for(int b = 0; b < numBlocks; b++) {
+        transposed.offsets[b + 1] += transposed.offsets[b];
+    }
+
+    vector<int> next(transposed.offsets.begin(), transposed.offsets.end() - 1);
+    for(int b = 0; b < numBlocks; b++) {
+        for(int e = graph.offsets[b]; e < graph.offsets[b + 1]; e++) {
+            transposed.targets[next[graph.targets[e]]++] = b;
+        }
+    }
+
+    return transposed;
+}
+
+/* returns the number of blocks of the graph */
+int graphSize(const csrGraph& graph) {
+    return graph.offsets.empty() ? 0 : graph.offsets.size() - 1;
+}
+
+/* returns the number of edges of a block */
+int numEdges(const csrGraph& graph, int b) {
+    return graph.offsets[b + 1] - graph.offsets[b];
+}
+
+/* returns the block numbers in reverse postorder of a depth first search from entry
+ * blocks unreachable from entry are appended at the end in numeric order, and the
+ * number of blocks before them is stored in numReachable unless it is NULL
+ * the search uses an explicit stack so deeply nested graphs cannot overflow
+ */
+vector<int> reversePostorder(const csrGraph& successors, int entry, int* numReachable) {
+    int numBlocks = graphSize(successors);
+    vector<int> postorder;
+    postorder.reserve(numBlocks);
+    if(numBlocks == 0) {
+        if(numReachable != NULL) {
+            *numReachable = 0;
+        }
+        return postorder;
+    }
+    assert(entry >= 0 && entry < numBlocks);
+
+    vector<bool> visited(numBlocks, false);
+    vector<pair<int, int>> stack; // block and its next edge to visit
+    stack.push_back(make_pair(entry, successors.offsets[entry]));
+    visited[entry] = true;
+
+    while(stack.size() != 0) {
+        pair<int, int>& top = stack.back();
+        int b = top.first;
+
+        // descend into the next unvisited successor
+        if(top.second < successors.offsets[b + 1]) {
+            int successor = successors.targets[top.second];
+            top.second++;
+            if(!visited[successor]) {
+                visited[successor] = true;
+                stack.push_back(make_pair(successor, successors.offsets[successor]));
+            }
+            continue;
+        }
+
+        // all successors are done
+        postorder.push_back(b);
+        stack.pop_back();
+    }
+
+    if(numReachable != NULL) {
+        *numReachable = postorder.size();
+    }
+    vector<int> order(postorder.rbegin(), postorder.rend());
+    for(int b = 0; b < numBlocks; b++) {
+        if(!visited[b]) {
+            order.push_back(b);
+        }
+    }
+
+    return order;
+}
@@ -0,0 +1,40 @@
+#ifndef CFG_H
+#define CFG_H
+
+#include <llvm-c/Core.h>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+/* the edges of a graph over blocks numbered 0 to n - 1 in compressed sparse row form:
+ * the edges of block b go to targets[offsets[b]] up to, not including, targets[offsets[b + 1]]
+ */
+typedef struct {
+        vector<int> offsets; // one per block, and one past the last
+        vector<int> targets;
+    } csrGraph;
+
+/* the control flow graph of a function, its blocks numbered in reverse postorder from
+ * the entry (0), followed by the blocks unreachable from it in layout order
+ * each edge is there once, even if a branch names its target twice
+ */
+typedef struct {
+        vector<LLVMBasicBlockRef> blocks; // block number to block
+        unordered_map<LLVMBasicBlockRef, int> blockIndex; // block to block number
+        int numReachable; // the blocks numbered below are reachable from the entry
+        csrGraph successors;
+        csrGraph predecessors; // the edges of each block in the order of their sources' numbers
+    } controlFlowGraph;
+
+/* FUNCTIONS */
+/* --------- */
+
+controlFlowGraph buildControlFlowGraph(LLVMValueRef func);
+csrGraph buildCSRGraph(int numBlocks, const vector<pair<int, int>>& edges);
+csrGraph transposeGraph(const csrGraph& graph);
+int graphSize(const csrGraph& graph);
+int numEdges(const csrGraph& graph, int b);
+vector<int> reversePostorder(const csrGraph& successors, int entry, int* numReachable);
+
+#endif
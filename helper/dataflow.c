@@ -0,0 +1,89 @@
+/*
+ * Library containing a generic worklist solver for bit vector dataflow analyses
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "dataflow.h"
+#include <deque>
+#include <algorithm>
+//#define NDEBUG
+#include <cassert>
+
+using namespace std;
+
+/* solves the dataflow problem with a worklist seeded in reverse postorder
+ * (postorder for backward problems), so that most blocks see all of their
+ * inputs before they are visited. a block is only revisited when the
+ * in/out of one of the blocks feeding it changes
+ */
+void solveDataflow(dataflowProblem* problem) {
+    assert(problem != NULL);
+    assert(problem->predecessors != NULL && problem->successors != NULL);
+    assert(problem->gen != NULL && problem->kill != NULL);
+
+    int numBlocks = graphSize(*problem->predecessors);
+    assert(graphSize(*problem->successors) == numBlocks);
+    assert((int) problem->gen->size() == numBlocks && (int) problem->kill->size() == numBlocks);
+
+    problem->visits = 0;
+    problem->in.clear();
+    problem->out.clear();
+    if(numBlocks == 0) {
+        return;
+    }
+
+    bool forward = (problem->direction == dataflow_forward);
+
+    // the edges facts flow in on, and the edges they flow out on
+    const csrGraph& sources = forward ? *problem->predecessors : *problem->successors;
+    const csrGraph& targets = forward ? *problem->successors : *problem->predecessors;
+
+    // the meet side starts empty, the transfer side starts as gen
+    int size = (*problem->gen)[0].size;
+    vector<bitVector>& meet = forward ? problem->in : problem->out;
+    vector<bitVector>& transfer = forward ? problem->out : problem->in;
+    meet.assign(numBlocks, createBitVector(size));
+    transfer = *problem->gen;
+
+    // seed the worklist with every block
+    vector<int> order = reversePostorder(*problem->successors, problem->entry, NULL);
+    if(!forward) {
+        reverse(order.begin(), order.end());
+    }
+    deque<int> worklist(order.begin(), order.end());
+    vector<bool> onWorklist(numBlocks, true);
+
+    bitVector newTransfer = createBitVector(size);
+    while(worklist.size() != 0) {
+        int b = worklist.front();
+        worklist.pop_front();
+        onWorklist[b] = false;
+        problem->visits++;
+
+        // meet = union of the blocks feeding this one
+        clearBitVector(&meet[b]);
+        for(int e = sources.offsets[b]; e < sources.offsets[b + 1]; e++) {
+            unionBitVector(&meet[b], &transfer[sources.targets[e]]);
+        }
+
+        // transfer = gen U (meet - kill)
+        newTransfer.words = meet[b].words;
+        differenceBitVector(&newTransfer, &(*problem->kill)[b]);
+        unionBitVector(&newTransfer, &(*problem->gen)[b]);
+
+        if(equalBitVector(&newTransfer, &transfer[b])) {
+            continue;
+        }
+        transfer[b].words.swap(newTransfer.words);
+
+        // only the blocks this one feeds can change
+        for(int e = targets.offsets[b]; e < targets.offsets[b + 1]; e++) {
+            int target = targets.targets[e];
+            if(!onWorklist[target]) {
+                onWorklist[target] = true;
+                worklist.push_back(target);
+            }
+        }
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef DATAFLOW_H
+#define DATAFLOW_H
+
+#include <vector>
+#include "bit_vector.h"
+#include "cfg.h"
+
+using namespace std;
+
+//enum to identify the direction facts flow through the graph
+typedef enum {
+		dataflow_forward, // in[b] = U out[p], out[b] = gen[b] U (in[b] - kill[b]), e.g. reaching definitions
+		dataflow_backward // out[b] = U in[s], in[b] = gen[b] U (out[b] - kill[b]), e.g. liveness
+	} dataflow_direction;
+
+/* a union (may) dataflow problem over a numbered control flow graph.
+ * the caller fills in the graph and the gen/kill vectors, the solver fills in in/out
+ */
+typedef struct {
+		dataflow_direction direction;
+		int entry; // number of the entry block
+		const csrGraph* predecessors;
+		const csrGraph* successors;
+		const vector<bitVector>* gen;
+		const vector<bitVector>* kill;
+		vector<bitVector> in;
+		vector<bitVector> out;
+		int visits; // number of times a block was popped off the worklist
+	} dataflowProblem;
+
+/* FUNCTIONS */
+/* --------- */
+
+void solveDataflow(dataflowProblem* problem);
+
+#endif
@@ -0,0 +1,229 @@
+/*
+ * Library of dominance analyses over numbered control flow graphs
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "dominators.h"
+//#define NDEBUG
+#include <cassert>
+
+using namespace std;
+
+/* FUNCTION PROTOTYPES */
+/* ------------------- */
+int intersectDominators(const vector<int>& idom, const vector<int>& rpoNumber, int b1, int b2);
+csrGraph reverseToVirtualExit(const csrGraph& successors);
+
+/* computes the immediate dominator of every block using the iterative algorithm of
+ * Cooper, Harvey and Kennedy, which walks the blocks in reverse postorder until
+ * no immediate dominator changes (usually two passes on reducible graphs)
+ * the entry and any block unreachable from it have no immediate dominator (-1)
+ */
+vector<int> computeImmediateDominators(const csrGraph& predecessors, const csrGraph& successors, int entry) {
+    int numBlocks = graphSize(successors);
+    assert(graphSize(predecessors) == numBlocks);
+
+    vector<int> idom(numBlocks, -1);
+    if(numBlocks == 0) {
+        return idom;
+    }
+    assert(entry >= 0 && entry < numBlocks);
+
+    // number the blocks by their position in reverse postorder
+    vector<int> order = reversePostorder(successors, entry, NULL);
+    vector<int> rpoNumber(numBlocks);
+    for(int i = 0; i < numBlocks; i++) {
+        rpoNumber[order[i]] = i;
+    }
+
+    // the entry temporarily dominates itself so the intersections terminate
+    idom[entry] = entry;
+
+    bool changed = true;
+    while(changed) {
+        changed = false;
+
+        vector<int>::iterator it = order.begin();
+        while(it != order.end()) {
+            int b = *it;
+            it++;
+            if(b == entry) {
+                continue;
+            }
+
+            // intersect all of the predecessors that have been processed
+            int newIdom = -1;
+            for(int e = predecessors.offsets[b]; e < predecessors.offsets[b + 1]; e++) {
+                int p = predecessors.targets[e];
+
+                if(idom[p] == -1) { // unprocessed or unreachable
+                    continue;
+                }
+
+                if(newIdom == -1) {
+                    newIdom = p;
+                } else {
+                    newIdom = intersectDominators(idom, rpoNumber, p, newIdom);
+                }
+            }
+
+            if(idom[b] != newIdom) {
+                idom[b] = newIdom;
+                changed = true;
+            }
+        }
+    }
+
+    idom[entry] = -1;
+    return idom;
+}
+
+/* walks up the dominator tree from both blocks until they meet */
+int intersectDominators(const vector<int>& idom, const vector<int>& rpoNumber, int b1, int b2) {
+    while(b1 != b2) {
+        while(rpoNumber[b1] > rpoNumber[b2]) {
+            b1 = idom[b1];
+        }
+        while(rpoNumber[b2] > rpoNumber[b1]) {
+            b2 = idom[b2];
+        }
+    }
+    return b1;
+}
+
+/* turns the immediate dominators into the children lists of the dominator tree */
+vector<vector<int>> generateDominatorTree(const vector<int>& idom) {
+    vector<vector<int>> children(idom.size());
+    for(int b = 0; b < (int) idom.size(); b++) {
+        if(idom[b] != -1) {
+            children[idom[b]].push_back(b);
+        }
+    }
+    return children;
+}
+
+/* computes the dominance frontier of every block, the blocks where its dominance ends:
+ * each join block is in the frontier of every block on the way up the dominator tree
+ * from each of its predecessors to its immediate dominator (Cooper, Harvey and Kennedy)
+ * blocks unreachable from the entry have and are in no frontier
+ */
+vector<vector<int>> computeDominanceFrontiers(const csrGraph& predecessors, const vector<int>& idom, int entry) {
+    int numBlocks = idom.size();
+    assert(graphSize(predecessors) == numBlocks);
+
+    vector<vector<int>> frontiers(numBlocks);
+    for(int b = 0; b < numBlocks; b++) {
+        if(numEdges(predecessors, b) < 2 || (idom[b] == -1 && b != entry)) {
+            continue;
+        }
+
+        for(int e = predecessors.offsets[b]; e < predecessors.offsets[b + 1]; e++) {
+            int runner = predecessors.targets[e];
+            if(idom[runner] == -1 && runner != entry) { // unreachable
+                continue;
+            }
+
+            // a block appears once in each frontier, as the walks from its predecessors stop where they meet
+            while(runner != idom[b] && (frontiers[runner].empty() || frontiers[runner].back() != b)) {
+                frontiers[runner].push_back(b);
+                if(runner == entry) {
+                    break;
+                }
+                runner = idom[runner];
+            }
+        }
+    }
+
+    return frontiers;
+}
+
+/* computes the immediate post-dominator of every block, as the immediate dominators of the
+ * reversed graph from a virtual exit numbered after the last block, which every block
+ * without successors flows to
+ * the returned vector has an entry for the virtual exit too (-1), blocks from which
+ * no exit can be reached have no immediate post-dominator (-1)
+ */
+vector<int> computeImmediatePostDominators(const csrGraph& successors) {
+    csrGraph reversedSuccessors = reverseToVirtualExit(successors);
+    return computeImmediateDominators(transposeGraph(reversedSuccessors), reversedSuccessors, graphSize(successors));
+}
+
+/* computes the post-dominance frontier of every block, the blocks it is control dependent on:
+ * the branches deciding whether it runs, from which only some paths lead through it
+ * takes the immediate post-dominators as computeImmediatePostDominators returns them,
+ * so the frontiers also cover the virtual exit
+ */
+vector<vector<int>> computePostDominanceFrontiers(const csrGraph& successors, const vector<int>& ipdom) {
+    int numBlocks = graphSize(successors);
+    assert((int) ipdom.size() == numBlocks + 1);
+
+    // the predecessors of the reversed graph are the successors
+    return computeDominanceFrontiers(transposeGraph(reverseToVirtualExit(successors)), ipdom, numBlocks);
+}
+
+/* returns the successors of the reversed graph, with an edge from a virtual exit
+ * numbered after the last block to every block without successors
+ */
+csrGraph reverseToVirtualExit(const csrGraph& successors) {
+    int numBlocks = graphSize(successors);
+
+    vector<pair<int, int>> edges;
+    edges.reserve(successors.targets.size() + 1);
+    for(int b = 0; b < numBlocks; b++) {
+        if(numEdges(successors, b) == 0) {
+            edges.push_back(make_pair(numBlocks, b));
+        }
+        for(int e = successors.offsets[b]; e < successors.offsets[b + 1]; e++) {
+            edges.push_back(make_pair(successors.targets[e], b));
+        }
+    }
+
+    return buildCSRGraph(numBlocks + 1, edges);
+}
+
+/* numbers the blocks in preorder and postorder of a walk of the dominator tree
+ * from each of its roots (the entry, then the unreachable blocks), so that
+ * dominance between any two blocks can be checked in constant time
+ */
+void numberDominatorTree(const vector<vector<int>>& tree, const vector<int>& idom, vector<int>& preorder, vector<int>& postorder) {
+    int numBlocks = tree.size();
+    assert((int) idom.size() == numBlocks);
+    preorder.assign(numBlocks, -1);
+    postorder.assign(numBlocks, -1);
+
+    int preNumber = 0;
+    int postNumber = 0;
+    vector<pair<int, size_t>> stack; // block and index of its next child to visit
+    for(int root = 0; root < numBlocks; root++) {
+        if(idom[root] != -1) {
+            continue;
+        }
+
+        preorder[root] = preNumber++;
+        stack.push_back(make_pair(root, 0));
+        while(stack.size() != 0) {
+            pair<int, size_t>& top = stack.back();
+            int b = top.first;
+
+            if(top.second < tree[b].size()) {
+                int child = tree[b][top.second];
+                top.second++;
+                preorder[child] = preNumber++;
+                stack.push_back(make_pair(child, 0));
+                continue;
+            }
+
+            postorder[b] = postNumber++;
+            stack.pop_back();
+        }
+    }
+}
+
+/* checks if the first block dominates the second (every block dominates itself),
+ * given the numbering of numberDominatorTree: a block's descendants are numbered after it
+ * in preorder and before it in postorder
+ */
+bool dominates(const vector<int>& preorder, const vector<int>& postorder, int dominator, int block) {
+    return preorder[dominator] <= preorder[block] && postorder[block] <= postorder[dominator];
+}
@@ -0,0 +1,20 @@
+#ifndef DOMINATORS_H
+#define DOMINATORS_H
+
+#include <vector>
+#include "cfg.h"
+
+using namespace std;
+
+/* FUNCTIONS */
+/* --------- */
+
+vector<int> computeImmediateDominators(const csrGraph& predecessors, const csrGraph& successors, int entry);
+vector<vector<int>> generateDominatorTree(const vector<int>& idom);
+vector<vector<int>> computeDominanceFrontiers(const csrGraph& predecessors, const vector<int>& idom, int entry);
+vector<int> computeImmediatePostDominators(const csrGraph& successors);
+vector<vector<int>> computePostDominanceFrontiers(const csrGraph& successors, const vector<int>& ipdom);
+void numberDominatorTree(const vector<vector<int>>& tree, const vector<int>& idom, vector<int>& preorder, vector<int>& postorder);
+bool dominates(const vector<int>& preorder, const vector<int>& postorder, int dominator, int block);
+
+#endif
@@ -0,0 +1,13 @@
+/*
+ * Library for measuring wall time between clock readings, kept free of LLVM
+ * so that the front-end benches can use it too
+*/
+#include "elapsed_time.h"
+
+/* FUNCTIONS */
+/* --------- */
+
+/* returns the milliseconds between two CLOCK_MONOTONIC readings */
+double elapsedMs(struct timespec start, struct timespec end) {
+    return (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1000000.0;
+}
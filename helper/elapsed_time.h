@@ -0,0 +1,11 @@
+#ifndef ELAPSED_TIME_H
+#define ELAPSED_TIME_H
+
+#include <time.h>
+
+/* FUNCTIONS */
+/* --------- */
+
+double elapsedMs(struct timespec start, struct timespec end);
+
+#endif
@@ -0,0 +1,210 @@
+/*
+ * Library that finds the natural loops of a numbered control flow graph and how they nest
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "loops.h"
+#include "dominators.h"
+#include <algorithm>
+//#define NDEBUG
+#include <cassert>
+
+using namespace std;
+
+/* FUNCTIONS */
+/* --------- */
+
+/* finds the headers of the loops, the targets of the back edges, edges from a block they dominate,
+ * given the immediate dominators and the numbering of numberDominatorTree
+ * they are sorted by their preorder in the dominator tree, so the headers of the loops
+ * containing a loop come before its own - this is all a caller needing no more than the headers pays for
+ */
+vector<int> findLoopHeaders(const csrGraph& successors, const vector<int>& idom, const vector<int>& domPreorder, const vector<int>& domPostorder, int entry) {
+    int numBlocks = graphSize(successors);
+    assert((int) idom.size() == numBlocks);
+
+    vector<int> headers;
+    vector<bool> isHeader(numBlocks, false);
+    for(int b = 0; b < numBlocks; b++) {
+        if(idom[b] == -1 && b != entry) { // unreachable
+            continue;
+        }
+        for(int e = successors.offsets[b]; e < successors.offsets[b + 1]; e++) {
+            int header = successors.targets[e];
+            if(!isHeader[header] && dominates(domPreorder, domPostorder, header, b)) {
+                isHeader[header] = true;
+                headers.push_back(header);
+            }
+        }
+    }
+    sort(headers.begin(), headers.end(), [&domPreorder](int a, int b) {
+        return domPreorder[a] < domPreorder[b];
+    });
+
+    return headers;
+}
+
+/* returns the outermost loop found so far to contain the given one, shortening the path to it */
+int outermostFound(vector<int>& outermost, int loop) {
+    int root = loop;
+    while(outermost[root] != root) {
+        root = outermost[root];
+    }
+    while(outermost[loop] != root) {
+        int next = outermost[loop];
+        outermost[loop] = root;
+        loop = next;
+    }
+    return root;
+}
+
+/* finds the loop of every block with a back edge to it and how the loops nest
+ * the loops are found innermost first, walking back from the latches of each: a block already
+ * in a loop stands for the outermost loop found so far around it, which becomes a loop of this one,
+ * and the walk goes on from the blocks entering its header, so each block is walked into a loop once
+ * edges closing a cycle whose target does not dominate their source (irreducible control flow)
+ * and blocks unreachable from the entry belong to no loop
+ */
+loopNest findLoops(const csrGraph& successors, const csrGraph& predecessors, const vector<int>& idom, const vector<int>& domPreorder, const vector<int>& domPostorder, int entry) {
+    int numBlocks = graphSize(successors);
+    assert(graphSize(predecessors) == numBlocks && (int) idom.size() == numBlocks);
+
+    // loops are numbered by their header's position here until they are put in preorder
+    vector<int> headers = findLoopHeaders(successors, idom, domPreorder, domPostorder, entry);
+    int numLoops = headers.size();
+    vector<int> found(numBlocks, -1); // the innermost loop of each block
+    vector<int> parent(numLoops, -1);
+    vector<int> outermost(numLoops);
+    vector<vector<int>> latches(numLoops);
+
+    // a loop's header is dominated by the headers of the loops around it, so it comes after them
+    for(int l = numLoops - 1; l >= 0; l--) {
+        int header = headers[l];
+        outermost[l] = l;
+        found[header] = l;
+
+        vector<int> worklist;
+        for(int e = predecessors.offsets[header]; e < predecessors.offsets[header + 1]; e++) {
+            int p = predecessors.targets[e];
+            if((idom[p] != -1 || p == entry) && dominates(domPreorder, domPostorder, header, p)) {
+                latches[l].push_back(p);
+                worklist.push_back(p);
+            }
+        }
+
+        // walk back from the latches, stopping at the header
+        while(!worklist.empty()) {
+            int b = worklist.back();
+            worklist.pop_back();
+
+            int entered = header;
+            if(found[b] == -1) {
+                found[b] = l;
+                entered = b;
+            } else {
+                int inner = outermostFound(outermost, found[b]);
+                if(inner == l) {
+                    continue;
+                }
+                // a loop inside this one, only entered through its header
+                parent[inner] = l;
+                outermost[inner] = l;
+                entered = headers[inner];
+            }
+
+            for(int e = predecessors.offsets[entered]; e < predecessors.offsets[entered + 1]; e++) {
+                int p = predecessors.targets[e];
+                if((idom[p] == -1 && p != entry) || (entered != b && dominates(domPreorder, domPostorder, entered, p))) {
+                    continue; // unreachable, or a latch of the inner loop
+                }
+                worklist.push_back(p);
+            }
+        }
+    }
+
+    // number the loops in preorder of the loop tree, the children of a loop in the order of their headers
+    vector<vector<int>> children(numLoops);
+    vector<int> pending;
+    for(int l = numLoops - 1; l >= 0; l--) {
+        if(parent[l] == -1) {
+            pending.push_back(l);
+        } else {
+            children[parent[l]].push_back(l);
+        }
+    }
+    vector<int> number(numLoops);
+    loopNest nest;
+    while(!pending.empty()) {
+        int l = pending.back();
+        pending.pop_back();
+        number[l] = nest.loops.size();
+
+        naturalLoop loop;
+        loop.header = headers[l];
+        loop.preheader = -1;
+        loop.parent = (parent[l] == -1) ? -1 : number[parent[l]];
+        loop.depth = (loop.parent == -1) ? 1 : nest.loops[loop.parent].depth + 1;
+        loop.end = nest.loops.size() + 1;
+        loop.latches.swap(latches[l]);
+        nest.loops.push_back(loop);
+
+        // pushed in decreasing order of their headers, so popped in increasing order
+        pending.insert(pending.end(), children[l].begin(), children[l].end());
+    }
+    for(int l = numLoops - 1; l >= 0; l--) {
+        int p = nest.loops[l].parent;
+        if(p != -1) {
+            nest.loops[p].end = max(nest.loops[p].end, nest.loops[l].end);
+        }
+    }
+
+    nest.innermostLoop.assign(numBlocks, -1);
+    nest.loopDepth.assign(numBlocks, 0);
+    for(int b = 0; b < numBlocks; b++) {
+        if(found[b] != -1) {
+            nest.innermostLoop[b] = number[found[b]];
+            nest.loopDepth[b] = nest.loops[number[found[b]]].depth;
+        }
+    }
+
+    // an edge leaving a block's innermost loop leaves each loop around it up to one containing its target
+    for(int b = 0; b < numBlocks; b++) {
+        for(int e = successors.offsets[b]; e < successors.offsets[b + 1]; e++) {
+            int s = successors.targets[e];
+            int l = nest.innermostLoop[b];
+            while(l != -1 && !loopContains(nest.loops, nest.innermostLoop, l, s)) {
+                nest.loops[l].exits.push_back(s);
+                l = nest.loops[l].parent;
+            }
+        }
+    }
+
+    for(int l = 0; l < numLoops; l++) {
+        naturalLoop& loop = nest.loops[l];
+        sort(loop.exits.begin(), loop.exits.end());
+        loop.exits.erase(unique(loop.exits.begin(), loop.exits.end()), loop.exits.end());
+
+        // the preheader is the only way into the loop, and leads nowhere else
+        int entries = 0;
+        int outside = -1;
+        for(int e = predecessors.offsets[loop.header]; e < predecessors.offsets[loop.header + 1]; e++) {
+            int p = predecessors.targets[e];
+            if(!loopContains(nest.loops, nest.innermostLoop, l, p) && (idom[p] != -1 || p == entry)) {
+                entries++;
+                outside = p;
+            }
+        }
+        if(entries == 1 && numEdges(successors, outside) == 1) {
+            loop.preheader = outside;
+        }
+    }
+
+    return nest;
+}
+
+/* checks if a loop contains a block, in constant time, as the loops inside it are numbered right after it */
+bool loopContains(const vector<naturalLoop>& loops, const vector<int>& innermostLoop, int loop, int block) {
+    int inner = innermostLoop[block];
+    return inner >= loop && inner < loops[loop].end;
+}
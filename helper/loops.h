@@ -0,0 +1,37 @@
+#ifndef LOOPS_H
+#define LOOPS_H
+
+#include <vector>
+#include "cfg.h"
+
+using namespace std;
+
+/* a natural loop: the blocks that reach a back edge to its header without going through the header,
+ * which dominates all of them. the back edges to one header make a single loop
+ * its blocks are not listed - a block is in it when its innermost loop is the loop or one it contains
+ */
+typedef struct {
+        int header;
+        int preheader; // the only block outside the loop branching to the header, if it branches nowhere else, or -1
+        int parent; // the innermost loop containing this one, or -1
+        int depth; // 1 for a loop no other loop contains
+        int end; // the loops it contains are the ones numbered after it, up to end excluded
+        vector<int> latches; // blocks of the loop that branch back to the header
+        vector<int> exits; // in increasing order, blocks outside the loop that blocks of the loop branch to
+    } naturalLoop;
+
+/* the loops of a function and the innermost loop of each block */
+typedef struct {
+        vector<naturalLoop> loops; // in preorder of the loop tree, so each loop comes before the loops it contains
+        vector<int> innermostLoop; // block number to the innermost loop containing it, or -1
+        vector<int> loopDepth; // block number to the number of loops containing it
+    } loopNest;
+
+/* FUNCTIONS */
+/* --------- */
+
+vector<int> findLoopHeaders(const csrGraph& successors, const vector<int>& idom, const vector<int>& domPreorder, const vector<int>& domPostorder, int entry);
+loopNest findLoops(const csrGraph& successors, const csrGraph& predecessors, const vector<int>& idom, const vector<int>& domPreorder, const vector<int>& domPostorder, int entry);
+bool loopContains(const vector<naturalLoop>& loops, const vector<int>& innermostLoop, int loop, int block);
+
+#endif
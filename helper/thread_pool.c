@@ -0,0 +1,119 @@
+/*
+ * Library containing a simple thread pool, used to compile several files at once
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "thread_pool.h"
+//#define NDEBUG
+#include <cassert>
+
+using namespace std;
+
+/* FUNCTION PROTOTYPES */
+/* ------------------- */
+void runWorker(threadPool* pool);
+
+/* FUNCTIONS */
+/* --------- */
+
+/* starts the worker threads - each one runs threadStart (if not NULL) before taking tasks
+ * and threadExit (if not NULL) once the pool is destroyed, so they can set up per-thread state
+ */
+threadPool* createThreadPool(int numThreads, void (*threadStart)(), void (*threadExit)()) {
+    assert(numThreads > 0);
+
+    threadPool* pool = new threadPool();
+    pool->pending = 0;
+    pool->stopping = false;
+    pool->threadStart = threadStart;
+    pool->threadExit = threadExit;
+
+    for(int i = 0; i < numThreads; i++) {
+        pool->workers.push_back(thread(runWorker, pool));
+    }
+
+    return pool;
+}
+
+/* queues a task to be run with its argument on the next free worker */
+void submitTask(threadPool* pool, void (*task)(void*), void* arg) {
+    assert(pool != NULL && task != NULL);
+
+    unique_lock<mutex> guard(pool->lock);
+    assert(!pool->stopping);
+    pool->tasks.push_back(make_pair(task, arg));
+    pool->pending++;
+    guard.unlock();
+
+    pool->taskReady.notify_one();
+}
+
+/* blocks until every submitted task has finished */
+void waitForTasks(threadPool* pool) {
+    assert(pool != NULL);
+
+    unique_lock<mutex> guard(pool->lock);
+    while(pool->pending != 0) {
+        pool->tasksDone.wait(guard);
+    }
+}
+
+/* finishes the queued tasks, stops and joins the workers and frees the pool */
+void destroyThreadPool(threadPool* pool) {
+    assert(pool != NULL);
+
+    unique_lock<mutex> guard(pool->lock);
+    pool->stopping = true;
+    guard.unlock();
+    pool->taskReady.notify_all();
+
+    vector<thread>::iterator it = pool->workers.begin();
+    while(it != pool->workers.end()) {
+        it->join();
+        it++;
+    }
+
+    delete(pool);
+}
+
+/* returns the number of hardware threads, or 1 if it is unknown */
+int defaultThreadCount() {
+    int count = thread::hardware_concurrency();
+    return (count > 0) ? count : 1;
+}
+
+/* takes tasks off the queue until the pool is stopping and the queue is empty */
+void runWorker(threadPool* pool) {
+    if(pool->threadStart != NULL) {
+        (*pool->threadStart)();
+    }
+
+    unique_lock<mutex> guard(pool->lock);
+    while(true) {
+        while(pool->tasks.size() == 0 && !pool->stopping) {
+            pool->taskReady.wait(guard);
+        }
+        if(pool->tasks.size() == 0) {
+            break;
+        }
+
+        pair<void (*)(void*), void*> task = pool->tasks.front();
+        pool->tasks.pop_front();
+
+        // run the task without holding the lock
+        guard.unlock();
+        (*task.first)(task.second);
+        guard.lock();
+
+        pool->pending--;
+        if(pool->pending == 0) {
+            pool->tasksDone.notify_all();
+        }
+    }
+    guard.unlock();
+
+    if(pool->threadExit != NULL) {
+        (*pool->threadExit)();
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+using namespace std;
+
+/* a fixed set of worker threads that run submitted tasks in the order they were submitted */
+typedef struct {
+		vector<thread> workers;
+		deque<pair<void (*)(void*), void*>> tasks; // task and its argument
+		mutex lock; // guards the tasks, pending and stopping
+		condition_variable taskReady;
+		condition_variable tasksDone;
+		int pending; // tasks submitted but not yet finished
+		bool stopping;
+		void (*threadStart)(); // run by each worker before its first task, may be NULL
+		void (*threadExit)(); // run by each worker after its last task, may be NULL
+	} threadPool;
+
+/* FUNCTIONS */
+/* --------- */
+
+threadPool* createThreadPool(int numThreads, void (*threadStart)(), void (*threadExit)());
+void submitTask(threadPool* pool, void (*task)(void*), void* arg);
+void waitForTasks(threadPool* pool);
+void destroyThreadPool(threadPool* pool);
+int defaultThreadCount();
+
+#endif
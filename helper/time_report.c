@@ -0,0 +1,232 @@
+/*
+ * Library that records the wall time, peak memory and instruction counts of the
+ * compiler phases and prints them as a table or as JSON (--time-report)
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "time_report.h"
+#include <algorithm>
+//#define NDEBUG
+#include <cassert>
+
+using namespace std;
+
+/* TYPES */
+/* ----- */
+
+// a phase that has started but not yet ended
+typedef struct {
+		int entry; // index into the report
+		struct timespec start;
+		int instructions; // instructions in the module when it started, -1 if none
+	} runningPhase;
+
+/* FUNCTION PROTOTYPES */
+/* ------------------- */
+int findEntry(const char* name, int depth);
+void printJSONString(FILE* out, const string& str);
+
+/* GLOBAL VARIABLES */
+/* ---------------- */
+bool reportEnabled = false;
+thread_local vector<timeReportEntry> report; // in the order the phases first started, per thread
+thread_local vector<runningPhase> runningPhases;
+
+/* FUNCTIONS */
+/* --------- */
+
+/* turns the recording on or off - while off, starting and ending phases costs nothing */
+void enableTimeReport(bool enabled) {
+    reportEnabled = enabled;
+}
+
+bool timeReportEnabled() {
+    return reportEnabled;
+}
+
+/* forgets every recorded phase */
+void clearTimeReport() {
+    report.clear();
+    runningPhases.clear();
+}
+
+/* starts timing a phase, nested in any phase that is still running
+ * the module, if not NULL, is counted to find how many instructions the phase removes
+ */
+void startPhase(const char* name, LLVMModuleRef mod) {
+    if(!reportEnabled) {
+        return;
+    }
+    assert(name != NULL);
+
+    runningPhase phase;
+    phase.entry = findEntry(name, runningPhases.size());
+    phase.instructions = (mod != NULL) ? countModuleInstructions(mod) : -1;
+    clock_gettime(CLOCK_MONOTONIC, &phase.start);
+
+    runningPhases.push_back(phase);
+}
+
+/* ends the most recently started phase and adds its time to the report
+ * the module, if not NULL, is the one the phase produced or changed
+ */
+void endPhase(LLVMModuleRef mod) {
+    if(!reportEnabled) {
+        return;
+    }
+    assert(runningPhases.size() != 0);
+
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    runningPhase phase = runningPhases.back();
+    runningPhases.pop_back();
+
+    timeReportEntry& entry = report[phase.entry];
+    entry.calls++;
+    entry.ms += elapsedMs(phase.start, end);
+    entry.peakRSS = getPeakRSS();
+
+    if(mod != NULL) {
+        entry.instructions = countModuleInstructions(mod);
+        if(phase.instructions != -1) {
+            entry.removed += phase.instructions - entry.instructions;
+        }
+    }
+}
+
+/* adds a phase that was timed elsewhere (e.g. by the optimizer's pass manager),
+ * nested in any phase that is still running
+ */
+void recordPhase(const char* name, int calls, double ms, long peakRSS, int removed) {
+    if(!reportEnabled) {
+        return;
+    }
+    assert(name != NULL);
+
+    timeReportEntry& entry = report[findEntry(name, runningPhases.size())];
+    entry.calls += calls;
+    entry.ms += ms;
+    entry.peakRSS = peakRSS;
+    entry.removed += removed;
+}
+
+/* returns the index of the phase with the name at the depth, adding it if it is new */
+int findEntry(const char* name, int depth) {
+    for(int i = 0; i < (int) report.size(); i++) {
+        if(report[i].depth == depth && report[i].name == name) {
+            return i;
+        }
+    }
+
+    timeReportEntry entry;
+    entry.name = name;
+    entry.depth = depth;
+    entry.calls = 0;
+    entry.ms = 0;
+    entry.peakRSS = 0;
+    entry.instructions = -1;
+    entry.removed = 0;
+    report.push_back(entry);
+
+    return report.size() - 1;
+}
+
+const vector<timeReportEntry>& getTimeReport() {
+    return report;
+}
+
+/* adds the phases of another thread's report to this thread's report */
+void mergeTimeReport(const vector<timeReportEntry>& other) {
+    vector<timeReportEntry>::const_iterator it = other.begin();
+    while(it != other.end()) {
+        timeReportEntry& entry = report[findEntry(it->name.c_str(), it->depth)];
+        entry.calls += it->calls;
+        entry.ms += it->ms;
+        entry.peakRSS = max(entry.peakRSS, it->peakRSS);
+        if(it->instructions != -1) {
+            entry.instructions = it->instructions;
+        }
+        entry.removed += it->removed;
+        it++;
+    }
+}
+
+/* prints every recorded phase, as an indented table or as a JSON object */
+void printTimeReport(FILE* out, bool json) {
+    assert(out != NULL);
+
+    if(json) {
+        fprintf(out, "{\"phases\": [");
+        for(int i = 0; i < (int) report.size(); i++) {
+            timeReportEntry& entry = report[i];
+            fprintf(out, "%s\n  {\"name\": ", (i == 0) ? "" : ",");
+            printJSONString(out, entry.name);
+            fprintf(out, ", \"depth\": %d, \"calls\": %d, \"wall_ms\": %.3f, \"peak_rss_kb\": %ld, \"instructions\": %d, \"removed\": %d}",
+                entry.depth, entry.calls, entry.ms, entry.peakRSS, entry.instructions, entry.removed);
+        }
+        fprintf(out, "\n]}\n");
+        return;
+    }
+
+    fprintf(out, "%-36s %6s %12s %14s %13s %8s\n", "phase", "calls", "wall (ms)", "peak RSS (KB)", "instructions", "removed");
+    vector<timeReportEntry>::iterator it = report.begin();
+    while(it != report.end()) {
+        string name = string(2 * it->depth, ' ') + it->name;
+        fprintf(out, "%-36s %6d %12.3f %14ld ", name.c_str(), it->calls, it->ms, it->peakRSS);
+        if(it->instructions == -1) {
+            fprintf(out, "%13s %8d\n", "-", it->removed);
+        } else {
+            fprintf(out, "%13d %8d\n", it->instructions, it->removed);
+        }
+        it++;
+    }
+}
+
+/* prints a string with the characters JSON requires escaped */
+void printJSONString(FILE* out, const string& str) {
+    fputc('"', out);
+    for(size_t i = 0; i < str.size(); i++) {
+        char c = str[i];
+        if(c == '"' || c == '\\') {
+            fputc('\\', out);
+        }
+        fputc(c, out);
+    }
+    fputc('"', out);
+}
+
+/* returns the peak resident set size of the process so far in KB */
+long getPeakRSS() {
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0) {
+        return -1;
+    }
+    return usage.ru_maxrss;
+}
+
+/* returns the number of instructions across all functions of the module */
+int countModuleInstructions(LLVMModuleRef mod) {
+    assert(mod != NULL);
+
+    int count = 0;
+    for(LLVMValueRef func = LLVMGetFirstFunction(mod);
+        func;
+        func = LLVMGetNextFunction(func)) {
+
+        for(LLVMBasicBlockRef bb = LLVMGetFirstBasicBlock(func);
+            bb;
+            bb = LLVMGetNextBasicBlock(bb)) {
+
+            for(LLVMValueRef instruction = LLVMGetFirstInstruction(bb);
+                instruction;
+                instruction = LLVMGetNextInstruction(instruction)) {
+                count++;
+            }
+        }
+    }
+
+    return count;
+}
@@ -0,0 +1,44 @@
+#ifndef TIME_REPORT_H
+#define TIME_REPORT_H
+
+#include <llvm-c/Core.h>
+#include <llvm-c/Types.h>
+#include <stdio.h>
+#include "elapsed_time.h"
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/* wall time, memory and instruction counts of one compiler phase, summed over its calls
+ * each thread records its own report, which can be merged into another thread's
+ */
+typedef struct {
+		string name;
+		int depth; // number of phases running when it started, so passes nest under optimizeLLVM
+		int calls;
+		double ms;
+		long peakRSS; // peak resident set size of the process in KB when the phase last ended
+		int instructions; // instructions in the module when the phase last ended, -1 if it has no module
+		int removed; // instructions the phase removed (negative if it added them)
+	} timeReportEntry;
+
+/* FUNCTIONS */
+/* --------- */
+
+void enableTimeReport(bool enabled);
+bool timeReportEnabled();
+void clearTimeReport();
+
+void startPhase(const char* name, LLVMModuleRef mod);
+void endPhase(LLVMModuleRef mod);
+void recordPhase(const char* name, int calls, double ms, long peakRSS, int removed);
+
+const vector<timeReportEntry>& getTimeReport();
+void mergeTimeReport(const vector<timeReportEntry>& other);
+void printTimeReport(FILE* out, bool json);
+
+long getPeakRSS();
+int countModuleInstructions(LLVMModuleRef mod);
+
+#endif
@@ -4,7 +4,33 @@
 #include<assert.h>
 #include<string.h>
 
+#include<new>
+#include<deque>
+#include<string>
+#include<string_view>
+#include<unordered_map>
+
+#define ARENA_CHUNK_SIZE (64 * 1024) // bytes in a chunk, unless an allocation needs more
+#define ARENA_ALIGNMENT alignof(max_align_t)
+
+thread_local astArena* currentArena = NULL; // arena the create* functions allocate from, NULL for the heap
+thread_local deque<string> internedNames; // by ID - a deque never moves its strings, so views of them stay valid
+thread_local unordered_map<string_view, int> internedIDs;
+
+/* an entry of the print stack: a node, a statement or a label line, printed at an indent */
+typedef struct {
+		astNode *node;
+		astStmt *stmt;
+		const char *label;
+		int indent;
+	} printItem;
+
 /* local helper functions */
+void pushChildren(vector<astNode*> &pending, astNode *node);
+void printPending(vector<printItem> &pending);
+void printNodeItem(astNode *node, int n, char *indent, vector<printItem> &pending);
+void printStmtItem(astStmt *stmt, int n, char *indent, vector<printItem> &pending);
+
 char * get_indent_str(int n){
 	char * ret = (char *) calloc(n+1, sizeof(char));
 	for (int i=0; i < n; i++)
@@ -12,10 +38,127 @@ char * get_indent_str(int n){
 	return ret;
 }
 
+/* returns a zeroed node from the current arena, or the heap if there is none */
+astNode* allocNode(){
+	if (currentArena == NULL)
+		return (astNode *)calloc(1, sizeof(astNode));
+
+	currentArena->nodes++;
+	astNode *node = (astNode *)arenaAlloc(currentArena, sizeof(astNode));
+	memset(node, 0, sizeof(astNode));
+	return node;
+}
+
+/* functions for the identifier interner */
+
+/* returns the ID of the first length characters of the name, adding it if it is new */
+int internName(const char *name, size_t length){
+	assert(name != NULL);
+	if (internedNames.empty())
+		clearInterner();
+
+	unordered_map<string_view, int>::iterator it = internedIDs.find(string_view(name, length));
+	if (it != internedIDs.end())
+		return it->second;
+
+	int id = internedNames.size();
+	internedNames.push_back(string(name, length));
+	internedIDs[string_view(internedNames.back())] = id;
+	return id;
+}
+
+/* returns the name of an ID, which lives until the interner is cleared */
+const char* internedName(int id){
+	assert(id >= 0 && id < (int) internedNames.size());
+	return internedNames[id].c_str();
+}
+
+/* returns the number of IDs handed out, so arrays indexed by ID can be sized */
+int internedCount(){
+	if (internedNames.empty())
+		clearInterner();
+	return internedNames.size();
+}
+
+/* forgets every name but the reserved ones */
+void clearInterner(){
+	internedIDs.clear();
+	internedNames.clear();
+
+	internedNames.push_back("print");
+	internedIDs[string_view(internedNames.back())] = id_print;
+	internedNames.push_back("read");
+	internedIDs[string_view(internedNames.back())] = id_read;
+}
+
+/* functions for the AST arena */
+astArena* createArena(){
+	astArena *arena = new astArena();
+	arena->next = NULL;
+	arena->remaining = 0;
+	arena->bytes = 0;
+	arena->nodes = 0;
+	arena->lists = 0;
+	return arena;
+}
+
+/* frees the arena and everything allocated from it, without visiting any of it */
+void freeArena(astArena *arena){
+	assert(arena != NULL);
+	assert(currentArena != arena);
+
+	vector<pair<char*, size_t> >::iterator it = arena->chunks.begin();
+	while (it != arena->chunks.end()){
+		free(it->first);
+		it++;
+	}
+	delete(arena);
+}
+
+/* bump allocates size bytes aligned for any type, starting a new chunk when the newest is full */
+void* arenaAlloc(astArena *arena, size_t size){
+	assert(arena != NULL);
+	size = (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+
+	if (size > arena->remaining){
+		size_t chunkSize = (size > ARENA_CHUNK_SIZE) ? size : ARENA_CHUNK_SIZE;
+		char *chunk = (char *) malloc(chunkSize);
+		if (chunk == NULL){
+			fprintf(stderr, "Out of memory for the AST\n");
+			exit(1);
+		}
+		arena->chunks.push_back(make_pair(chunk, chunkSize));
+		arena->next = chunk;
+		arena->remaining = chunkSize;
+	}
+
+	void *ptr = arena->next;
+	arena->next += size;
+	arena->remaining -= size;
+	arena->bytes += size;
+	return ptr;
+}
+
+/* makes the create* functions of this thread allocate from the arena (or the heap if NULL)
+ * returns the arena that was in use before, to be restored afterwards */
+astArena* useArena(astArena *arena){
+	astArena *previous = currentArena;
+	currentArena = arena;
+	return previous;
+}
+
+/* prints how many allocations the arena served and how few it took from the heap */
+void printArenaStatistics(FILE *out, astArena *arena){
+	assert(out != NULL && arena != NULL);
+	fprintf(out, "AST arena: %d allocations (%d nodes, %d lists) in %d chunks, %.1f KB\n",
+		arena->nodes + arena->lists, arena->nodes, arena->lists,
+		(int) arena->chunks.size(), arena->bytes / 1024.0);
+}
+
 /* create and free functions for ast_prog type astNode */
 astNode* createProg(astNode *ext1, astNode	*ext2, astNode	*func){
 	astNode	*node;
-	node = (astNode *)calloc(1, sizeof(astNode));
+	node = allocNode();
 	node->type = ast_prog;
 
 	node->prog.ext1 = ext1;
@@ -38,12 +181,16 @@ void freeProg(astNode *node){
 
 /*create and free functions for ast_func type astNode */
 astNode* createFunc(const char *name, astNode *param, astNode* body){
+	return createFunc(internName(name, strlen(name)), param, body);
+}
+
+astNode* createFunc(int id, astNode *param, astNode* body){
 	astNode *node;
-	node = (astNode*)calloc(1, sizeof(astNode));
+	node = allocNode();
 	node->type = ast_func;
 
-	node->func.name = (char *) calloc(1, sizeof(char) * (strlen(name)+1));
-	strcpy(node->func.name, name);
+	node->func.id = id;
+	node->func.name = (char *) internedName(id);
 
 	node->func.param = param;
 	node->func.body = body;
@@ -54,7 +201,6 @@ astNode* createFunc(const char *name, astNode *param, astNode* body){
 void freeFunc(astNode *node){
 	assert(node != NULL && node->type == ast_func);
 	
-	free(node->func.name);
 	if (node->func.param != NULL)
 		freeVar(node->func.param);
 
@@ -68,12 +214,16 @@ void freeFunc(astNode *node){
 /*create and free functionns for ast_extern*/
 
 astNode* createExtern(const char *name){
+	return createExtern(internName(name, strlen(name)));
+}
+
+astNode* createExtern(int id){
 	astNode *node;
-	node = (astNode*)calloc(1, sizeof(astNode));
+	node = allocNode();
 	node->type = ast_extern;
 	
-	node->ext.name = (char *) calloc(1, sizeof(char) * (strlen(name)+1));
-	strcpy(node->ext.name, name);
+	node->ext.id = id;
+	node->ext.name = (char *) internedName(id);
 
 	return(node);
 }
@@ -81,7 +231,6 @@ astNode* createExtern(const char *name){
 void freeExtern(astNode *node){
 	assert(node != NULL && node->type == ast_extern);
 	
-	free(node->ext.name);
 	free(node);
 
 	return;
@@ -90,12 +239,17 @@ void freeExtern(astNode *node){
 /*create and free functions for ast_var*/
 
 astNode* createVar(const char *name){
+	return createVar(internName(name, strlen(name)));
+}
+
+astNode* createVar(int id){
 	astNode *node;
-	node = (astNode*)calloc(1, sizeof(astNode));
+	node = allocNode();
 	node->type = ast_var;
 	
-	node->var.name = (char *) calloc(1, sizeof(char) * (strlen(name)+1));
-	strcpy(node->var.name, name);
+	node->var.id = id;
+	node->var.name = (char *) internedName(id);
+	node->var.slot = -1;
 	
 	return(node);
 }
@@ -103,7 +257,6 @@ astNode* createVar(const char *name){
 void freeVar(astNode *node){
 	assert(node != NULL && node->type == ast_var);
 	
-	free(node->var.name);
 	free(node);
 
 	return;
@@ -112,7 +265,7 @@ void freeVar(astNode *node){
 /*create and free functions for ast_cnst type of node*/
 astNode* createCnst(int value){
 	astNode *node;
-	node = (astNode*)calloc(1, sizeof(astNode));
+	node = allocNode();
 	node->type = ast_cnst;
 
 	node->cnst.value = value;
@@ -129,7 +282,7 @@ void freeCnst(astNode *node){
 /*create and free functions for ast_rexpr type of node*/
 astNode* createRExpr(astNode *lhs, astNode *rhs, rop_type op){
 	astNode *node;
-	node = (astNode*)calloc(1, sizeof(astNode));
+	node = allocNode();
 	node->type = ast_rexpr;
 	
 	node->rexpr.lhs = lhs;
@@ -154,7 +307,7 @@ void freeRExpr(astNode *node){
 /*create and free functions for ast_bexpr type of node*/
 astNode* createBExpr(astNode *lhs, astNode *rhs, op_type op){
 	astNode *node;
-	node = (astNode*)calloc(1, sizeof(astNode));
+	node = allocNode();
 	node->type = ast_bexpr;
 	
 	node->bexpr.lhs = lhs;
@@ -179,7 +332,7 @@ void freeBExpr(astNode *node){
 /* create and free functions for ast_uexpr type of node */
 astNode* createUExpr(astNode *expr, op_type op){
 	astNode *node;
-	node = (astNode*)calloc(1, sizeof(astNode));
+	node = allocNode();
 	node->type = ast_uexpr;
 	
 	node->uexpr.expr = expr;
@@ -199,13 +352,17 @@ void freeUExpr(astNode *node){
 
 /* create and free functions for a statement of type ast_call */
 astNode* createCall(const char *name, astNode *param){
+	return createCall(internName(name, strlen(name)), param);
+}
+
+astNode* createCall(int id, astNode *param){
 	astNode *node;
-	node = (astNode*) calloc(1, sizeof(astNode));
+	node = allocNode();
 	node->type = ast_stmt;
 	node->stmt.type = ast_call;
 	
-	node->stmt.call.name = (char *) calloc(strlen(name) + 1, sizeof(char));
-	strcpy(node->stmt.call.name, name);
+	node->stmt.call.id = id;
+	node->stmt.call.name = (char *) internedName(id);
 	
 	node->stmt.call.param = param;
 
@@ -216,7 +373,6 @@ void freeCall(astNode *node){
 	assert(node != NULL && node->type == ast_stmt);
 	assert(node->stmt.type == ast_call);
 	
-	free(node->stmt.call.name);
 	if (node->stmt.call.param != NULL)
 		freeNode(node->stmt.call.param);
 
@@ -227,7 +383,7 @@ void freeCall(astNode *node){
 /*create and free functions for a stmt of type ast_ret*/
 astNode* createRet(astNode	*expr){
 	astNode *node;
-	node = (astNode*) calloc(1, sizeof(astNode));
+	node = allocNode();
 	node->type = ast_stmt;
 	node->stmt.type = ast_ret;
 	
@@ -245,9 +401,8 @@ void freeRet(astNode *node){
 }
 
 /*create and free functions for a stmt of type ast_block*/
-astNode* createBlock(vector<astNode*> *stmt_list){
-	vector<astNode*> slist;
-	astNode* node = (astNode *)calloc(1, sizeof(astNode));
+astNode* createBlock(astNodeList *stmt_list){
+	astNode* node = allocNode();
 	node->type = ast_stmt;
 	node->stmt.type = ast_block;
 	
@@ -260,22 +415,41 @@ void freeBlock(astNode *node){
 	assert(node != NULL && node->type == ast_stmt);
 	assert(node->stmt.type == ast_block);
 
-	vector<astNode *> slist = *(node->stmt.block.stmt_list);
-	vector<astNode*>::iterator it = slist.begin();
+	astNodeList *slist = node->stmt.block.stmt_list;
+	astNodeList::iterator it = slist->begin();
 
-	while (it != slist.end()){
+	while (it != slist->end()){
 		freeNode(*it);
 		it++;	
 	}
 	
-	delete(node->stmt.block.stmt_list);
+	freeNodeList(slist);
 	free(node);
 	return;
 }
 
+/* create and free functions for the statement list of a block,
+which lives in the current arena (its buffer included) if there is one */
+astNodeList* createNodeList(){
+	if (currentArena == NULL)
+		return new astNodeList();
+
+	currentArena->lists++;
+	void *list = arenaAlloc(currentArena, sizeof(astNodeList));
+	return new(list) astNodeList(astAllocator<astNode*>(currentArena));
+}
+
+/* frees a list made by createNodeList, but not the nodes in it
+an arena list is left for freeArena to reclaim */
+void freeNodeList(astNodeList *slist){
+	assert(slist != NULL);
+	if (slist->get_allocator().arena == NULL)
+		delete(slist);
+}
+
 /* create and free functions for stmt of type while*/
 astNode* createWhile(astNode *cond, astNode *body){
-	astNode* node = (astNode *)calloc(1, sizeof(astNode));
+	astNode* node = allocNode();
 	node->type = ast_stmt;
 	node->stmt.type = ast_while;
 	
@@ -298,7 +472,7 @@ void freeWhile(astNode *node){
 
 /*create and free functions for stmt of type if*/
 astNode* createIf(astNode *cond, astNode *ifbody, astNode *elsebody){
-	astNode* node = (astNode *)calloc(1, sizeof(astNode));
+	astNode* node = allocNode();
 	node->type = ast_stmt;
 	node->stmt.type = ast_if;
 
@@ -325,12 +499,17 @@ void freeIf(astNode *node){
 
 /* create and free functions of stmt type ast_decl */
 astNode* createDecl(const char *name){
-	astNode* node = (astNode *)calloc(1, sizeof(astNode));
+	return createDecl(internName(name, strlen(name)));
+}
+
+astNode* createDecl(int id){
+	astNode* node = allocNode();
 	node->type = ast_stmt;
 	node->stmt.type = ast_decl;
 
-	node->stmt.decl.name = (char *)calloc(strlen(name)+1, sizeof(char));
-	strcpy(node->stmt.decl.name, name);
+	node->stmt.decl.id = id;
+	node->stmt.decl.name = (char *) internedName(id);
+	node->stmt.decl.slot = -1;
 
 	return(node);
 }
@@ -339,13 +518,12 @@ void freeDecl(astNode *node){
 	assert(node != NULL && node->type == ast_stmt);
 	assert(node->stmt.type == ast_decl);
 	
-	free(node->stmt.decl.name);
 	free(node);
 }
 
 /* create and free functions of stmt type ast_assign */
 astNode* createAsgn(astNode *lhs, astNode *rhs){
-	astNode* node = (astNode *)calloc(1, sizeof(astNode));
+	astNode* node = allocNode();
 	node->type = ast_stmt;
 	node->stmt.type = ast_asgn;
 
@@ -368,46 +546,92 @@ void freeAsgn(astNode *node){
 
 /* free function for releasing all the memory assigned to a node based
 on the type. This function is called by other free* functions when
-the type of a child node is not obvious from the context */
+the type of a child node is not obvious from the context 
+the nodes still to free are kept on a heap stack rather than recursing into them,
+so deeply nested trees cannot overflow the native stack */
 
 void freeNode(astNode *node){
 	assert(node != NULL);
+	vector<astNode*> pending(1, node);
+
+	while (!pending.empty()){
+		node = pending.back();
+		pending.pop_back();
+
+		pushChildren(pending, node);
+		if (node->type == ast_stmt && node->stmt.type == ast_block)
+			freeNodeList(node->stmt.block.stmt_list);
+		free(node);
+	}
+}
 
+/* pushes every child of the node onto the stack */
+void pushChildren(vector<astNode*> &pending, astNode *node){
 	switch(node->type){
 		case ast_prog:{
-						freeProg(node);
+						pending.push_back(node->prog.ext1);
+						pending.push_back(node->prog.ext2);
+						pending.push_back(node->prog.func);
 						break;
 					  }
 		case ast_func:{
-						freeFunc(node);
-						break;
-					  }
-		case ast_stmt:{
-						freeStmt(node);
-						break;
-					  }
-		case ast_extern:{
-						freeExtern(node);
+						if (node->func.param != NULL)
+							pending.push_back(node->func.param);
+						pending.push_back(node->func.body);
 						break;
 					  }
-		case ast_var: {	
-						freeVar(node);
+		case ast_extern:
+		case ast_var:
+		case ast_cnst:
 						break;
-					  }
-		case ast_cnst: {
-						 freeCnst(node);
-						 break;
-					  }
 		case ast_rexpr: {
-						freeRExpr(node);
+						pending.push_back(node->rexpr.lhs);
+						pending.push_back(node->rexpr.rhs);
 						break;
 					  }
 		case ast_bexpr: {
-						freeBExpr(node);
+						pending.push_back(node->bexpr.lhs);
+						pending.push_back(node->bexpr.rhs);
 						break;
 					  }
 		case ast_uexpr: {
-						freeUExpr(node);
+						pending.push_back(node->uexpr.expr);
+						break;
+					  }
+		case ast_stmt: {
+						astStmt *stmt = &node->stmt;
+						switch(stmt->type){
+							case ast_call: 
+											if (stmt->call.param != NULL)
+												pending.push_back(stmt->call.param);
+											break;
+							case ast_ret: 
+											pending.push_back(stmt->ret.expr);
+											break;
+							case ast_block:
+											pending.insert(pending.end(), stmt->block.stmt_list->begin(), stmt->block.stmt_list->end());
+											break;
+							case ast_while:
+											pending.push_back(stmt->whilen.cond);
+											pending.push_back(stmt->whilen.body);
+											break;
+							case ast_if: 
+											pending.push_back(stmt->ifn.cond);
+											pending.push_back(stmt->ifn.if_body);
+											if (stmt->ifn.else_body != NULL)
+												pending.push_back(stmt->ifn.else_body);
+											break;
+							case ast_asgn:	
+											pending.push_back(stmt->asgn.lhs);
+											pending.push_back(stmt->asgn.rhs);
+											break;
+							case ast_decl:	
+											break;
+							default: {
+										fprintf(stderr,"Incorrect node type\n");
+									 	exit(1);
+									 }
+						}
 						break;
 					  }
 		default: {
@@ -451,28 +675,57 @@ void freeStmt(astNode *node){
 	}
 }
 
+/* the print functions keep what is left to print on a heap stack rather than recursing,
+so deeply nested trees cannot overflow the native stack */
 void printNode(astNode *node, int n){
 	assert(node != NULL);
-	char *indent = get_indent_str(n);
-	
+	vector<printItem> pending(1, printItem{node, NULL, NULL, n});
+	printPending(pending);
+}
+
+void printStmt(astStmt *stmt, int n){
+	assert(stmt != NULL);
+	vector<printItem> pending(1, printItem{NULL, stmt, NULL, n});
+	printPending(pending);
+}
+
+/* prints the items on the stack until it is empty, the children of each are
+pushed last first so that the output is in the order of the tree */
+void printPending(vector<printItem> &pending){
+	while (!pending.empty()){
+		printItem item = pending.back();
+		pending.pop_back();
+
+		char *indent = get_indent_str(item.indent);
+		if (item.label != NULL)
+			printf("%s%s\n", indent, item.label);
+		else if (item.stmt != NULL)
+			printStmtItem(item.stmt, item.indent, indent, pending);
+		else
+			printNodeItem(item.node, item.indent, indent, pending);
+		free(indent);
+	}
+}
+
+void printNodeItem(astNode *node, int n, char *indent, vector<printItem> &pending){
+	assert(node != NULL);
+
 	switch(node->type){
 		case ast_prog:{
 						printf("%sProg:\n",indent);
-						printNode(node->prog.func, n+1);
+						pending.push_back(printItem{node->prog.func, NULL, NULL, n+1});
 						break;
 					  }
 		case ast_func:{
 						printf("%sFunc: %s\n",indent, node->func.name);
+						pending.push_back(printItem{node->func.body, NULL, NULL, n+1});
 						if (node->func.param != NULL)
-							printNode(node->func.param, n+1);
-
-						printNode(node->func.body, n+1);
+							pending.push_back(printItem{node->func.param, NULL, NULL, n+1});
 						break;
 					  }
 		case ast_stmt:{
 						printf("%sStmt: \n",indent);
-						astStmt stmt= node->stmt;
-						printStmt(&stmt, n+1);
+						pending.push_back(printItem{NULL, &node->stmt, NULL, n+1});
 						break;
 					  }
 		case ast_extern:{
@@ -489,19 +742,19 @@ void printNode(astNode *node, int n){
 					  }
 		case ast_rexpr: {
 						printf("%sRExpr: \n", indent);
-						printNode(node->rexpr.lhs, n+1);
-						printNode(node->rexpr.rhs, n+1);
+						pending.push_back(printItem{node->rexpr.rhs, NULL, NULL, n+1});
+						pending.push_back(printItem{node->rexpr.lhs, NULL, NULL, n+1});
 						break;
 					  }
 		case ast_bexpr: {
 						printf("%sBExpr: \n", indent);
-						printNode(node->bexpr.lhs, n+1);
-						printNode(node->bexpr.rhs, n+1);
+						pending.push_back(printItem{node->bexpr.rhs, NULL, NULL, n+1});
+						pending.push_back(printItem{node->bexpr.lhs, NULL, NULL, n+1});
 						break;
 					  }
 		case ast_uexpr: {
 						printf("%sUExpr: \n", indent);
-						printNode(node->uexpr.expr, n+1);
+						pending.push_back(printItem{node->uexpr.expr, NULL, NULL, n+1});
 						break;
 					  }
 		default: {
@@ -509,61 +762,61 @@ void printNode(astNode *node, int n){
 				 	exit(1);
 				 }
 	}
-	free(indent);
 }
 
-void printStmt(astStmt *stmt, int n){
+/* the labels between the children of a statement are pushed as items of their own,
+printed at the statement's indent */
+void printStmtItem(astStmt *stmt, int n, char *indent, vector<printItem> &pending){
 	assert(stmt != NULL);
-	char *indent = get_indent_str(n);
 
 	switch(stmt->type){
 		case ast_call: { 
 							printf("%sCall: name %s\n", indent, stmt->call.name);
 							if (stmt->call.param != NULL){
 								printf("%sCall: param\n", indent);
-								printNode(stmt->call.param, n+1);
+								pending.push_back(printItem{stmt->call.param, NULL, NULL, n+1});
 							}
 							break;
 						}
 		case ast_ret: {
 							printf("%sRet:\n", indent);
-							printNode(stmt->ret.expr, n+1);
+							pending.push_back(printItem{stmt->ret.expr, NULL, NULL, n+1});
 							break;
 						}
 		case ast_block: {
 							printf("%sBlock:\n", indent);
-							vector<astNode*> slist = *(stmt->block.stmt_list);
-							vector<astNode*>::iterator it = slist.begin();
-							while (it != slist.end()){
-								printNode(*it, n+1);
+							astNodeList *slist = stmt->block.stmt_list;
+							astNodeList::reverse_iterator it = slist->rbegin();
+							while (it != slist->rend()){
+								pending.push_back(printItem{*it, NULL, NULL, n+1});
 								it++;
 							}
 							break;
 						}
 		case ast_while: {
 							printf("%sWhile: cond \n", indent);
-							printNode(stmt->whilen.cond, n+1);
-							printf("%sWhile: body \n", indent);
-							printNode(stmt->whilen.body, n+1);
+							pending.push_back(printItem{stmt->whilen.body, NULL, NULL, n+1});
+							pending.push_back(printItem{NULL, NULL, "While: body ", n});
+							pending.push_back(printItem{stmt->whilen.cond, NULL, NULL, n+1});
 							break;
 						}
 		case ast_if: {
 							printf("%sIf: cond\n", indent);
-							printNode(stmt->ifn.cond, n+1);
-							printf("%sIf: body\n", indent);
-							printNode(stmt->ifn.if_body, n+1);
 							if (stmt->ifn.else_body != NULL)
 							{
-								printf("%sElse: body\n", indent);
-								printNode(stmt->ifn.else_body, n+1);
+								pending.push_back(printItem{stmt->ifn.else_body, NULL, NULL, n+1});
+								pending.push_back(printItem{NULL, NULL, "Else: body", n});
 							}
+							pending.push_back(printItem{stmt->ifn.if_body, NULL, NULL, n+1});
+							pending.push_back(printItem{NULL, NULL, "If: body", n});
+							pending.push_back(printItem{stmt->ifn.cond, NULL, NULL, n+1});
 							break;
 						}
 		case ast_asgn:	{
 							printf("%sAsgn: lhs\n", indent);
-							printNode(stmt->asgn.lhs, n+1);
-							printf("%sAsgn: rhs\n", indent);
-							printNode(stmt->asgn.rhs, n+1);
+							pending.push_back(printItem{stmt->asgn.rhs, NULL, NULL, n+1});
+							pending.push_back(printItem{NULL, NULL, "Asgn: rhs", n});
+							pending.push_back(printItem{stmt->asgn.lhs, NULL, NULL, n+1});
 							break;
 						}
 		case ast_decl:	{
@@ -575,5 +828,5 @@ void printStmt(astStmt *stmt, int n){
 				 	exit(1);
 				 }
 	}
-	free(indent);
 }
+
@@ -2,6 +2,7 @@
 #define AST_H 
 
 #include <cstddef>
+#include <stdio.h>
 #include<vector>
 using namespace std;
 
@@ -53,6 +54,67 @@ typedef enum {
 		uminus// -: unary minus
 	} op_type;
 
+/* every identifier is interned into a small integer ID, the same name always getting the same ID,
+ * so later stages compare IDs and index arrays by them instead of hashing strings
+ * the table belongs to the thread and is cleared by each parse, so the IDs of a program are dense */
+typedef enum {
+		id_print, // names interned ahead of any program, so their IDs are constant
+		id_read
+	} reserved_id;
+
+int internName(const char* name, size_t length);
+const char* internedName(int id);
+int internedCount();
+void clearInterner();
+
+/* arena that a whole AST (its nodes and statement lists) is bump allocated from,
+ * so that building a tree costs a few large allocations and it is freed in one call */
+typedef struct {
+		vector<pair<char*, size_t> > chunks; // start and size of every chunk allocated, the newest last
+		char* next; // next free byte of the newest chunk
+		size_t remaining; // free bytes left in the newest chunk
+		size_t bytes; // bytes handed out
+		int nodes; // allocations served, by what they were for
+		int lists;
+	} astArena;
+
+astArena* createArena();
+void freeArena(astArena* arena);
+void* arenaAlloc(astArena* arena, size_t size);
+astArena* useArena(astArena* arena);
+void printArenaStatistics(FILE* out, astArena* arena);
+
+/* allocator for the containers in the AST, which takes from the arena it was made with,
+ * or from the heap if that is NULL - arena memory is never given back before the arena is freed */
+template <typename T>
+struct astAllocator {
+		typedef T value_type;
+		astArena* arena;
+
+		astAllocator(astArena* arena = NULL) : arena(arena) {}
+		template <typename U> astAllocator(const astAllocator<U>& other) : arena(other.arena) {}
+
+		T* allocate(size_t n) {
+			if (arena == NULL)
+				return (T*) ::operator new(n * sizeof(T));
+			arena->lists++;
+			return (T*) arenaAlloc(arena, n * sizeof(T));
+		}
+
+		void deallocate(T* ptr, size_t n) {
+			if (arena == NULL)
+				::operator delete(ptr);
+		}
+	};
+
+template <typename T, typename U>
+bool operator==(const astAllocator<T>& a, const astAllocator<U>& b) { return a.arena == b.arena; }
+template <typename T, typename U>
+bool operator!=(const astAllocator<T>& a, const astAllocator<U>& b) { return a.arena != b.arena; }
+
+// statements of a block
+typedef vector<astNode*, astAllocator<astNode*> > astNodeList;
+
 /* structs for different node types */
 
 typedef struct {
@@ -63,16 +125,20 @@ typedef struct {
 
 typedef struct {
 		char* name; // name of the function
+		int id; // interned ID of the name
 		astNode* param; // parameter, possibly NULL if the function doesn't take a param
 		astNode* body; //function body
 	} astFunc;
 
 typedef struct {
 		char* name; // For extern functions defined we will only save function names
+		int id;
 	} astExtern;
 
 typedef struct {
 		char* name;
+		int id; // interned ID of the name
+		int slot; // stack slot of the declaration it refers to, set by semantic analysis (-1 before)
 	} astVar; 
 
 typedef struct {
@@ -99,6 +165,7 @@ typedef struct {
 /* structs for different statement types */
 typedef struct {
 		char* name;
+		int id; // interned ID of the name, id_print or id_read
 		astNode* param; // For read function this field will be NULL
 	} astCall;
 
@@ -107,7 +174,7 @@ typedef struct {
 	} astRet;
 
 typedef struct {
-		vector<astNode*> *stmt_list;
+		astNodeList *stmt_list;
 	} astBlock;
 
 typedef struct {
@@ -123,6 +190,8 @@ typedef struct {
 
 typedef struct {
 		char* name;
+		int id; // interned ID of the name
+		int slot; // stack slot of the variable, set by semantic analysis (-1 before)
 	} astDecl;
 
 typedef struct {
@@ -162,12 +231,19 @@ struct ast_Node{
 /* 
 Declarations of create* functions for all the types of nodes 
 defined above. All the create* functions return a astNode*. 
+While an arena is in use (see useArena) they allocate from it,
+and a tree built that way is released with freeArena, not the free* functions.
+Names are interned, so the name of a node is owned by the interner, and
+each create* taking a name has a variant taking an already interned ID.
 */
 
 astNode* createProg(astNode* extern1, astNode* extern2, astNode* func);
 astNode* createFunc(const char* name, astNode* param, astNode* body);
+astNode* createFunc(int id, astNode* param, astNode* body);
 astNode* createExtern(const char *name);
+astNode* createExtern(int id);
 astNode* createVar(const char *name);
+astNode* createVar(int id);
 astNode* createCnst(int value);
 astNode* createRExpr(astNode* lhs, astNode* rhs, rop_type op);
 astNode* createBExpr(astNode* lhs, astNode* rhs, op_type op);
@@ -181,11 +257,14 @@ a astNode*.
 */
 
 astNode* createCall(const char *name, astNode *param=NULL);
+astNode* createCall(int id, astNode *param=NULL);
 astNode* createRet(astNode* expr);
-astNode* createBlock(vector<astNode*> *stmt_list);
+astNode* createBlock(astNodeList *stmt_list);
+astNodeList* createNodeList();
 astNode* createWhile(astNode* cond, astNode* body);
 astNode* createIf(astNode* cond, astNode* if_body, astNode* else_body=NULL);
 astNode* createDecl(const char* decl);
+astNode* createDecl(int id);
 astNode* createAsgn(astNode* lhs, astNode* rhs);
 
 /* 
@@ -213,6 +292,7 @@ void freeAsgn(astNode*);
 
 /* freeNode checks the node type and calls the corresponding free* function.*/
 void freeNode(astNode*);
+void freeNodeList(astNodeList*);
 
 /* freeStmt checks the stmt type and calls the corresponding free* function.*/
 void freeStmt(astNode*);
@@ -0,0 +1,471 @@
+#include"flat_ast.h"
+#include<stdio.h>
+#include<stdlib.h>
+#include<assert.h>
+#include<string.h>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<string>
+
+/* the arrays of a flat AST while it is being built */
+typedef struct {
+		vector<uint8_t> kinds;
+		vector<uint8_t> ops;
+		vector<int32_t> first;
+		vector<int32_t> second;
+		vector<int32_t> third;
+		vector<int32_t> children;
+	} flatBuilder;
+
+/* a node still to be flattened, and the operand its index is written to once it is added */
+typedef struct {
+		astNode *node;
+		vector<int32_t> *operands; // first, second, third or children of the builder, NULL for the root
+		int32_t position;
+	} pendingFlatten;
+
+/* local helper functions */
+void flattenNode(flatBuilder *ast, pendingFlatten item, vector<pendingFlatten> &pending);
+size_t storageSize(int32_t size, int32_t numChildren);
+void pointIntoStorage(flatAST *ast);
+bool validFlatAST(flatAST *ast, uint32_t numNames);
+
+/* appends a node and returns its index, its operands are filled in by the caller */
+int32_t addFlatNode(flatBuilder *ast, flat_kind kind, int op){
+	int32_t index = ast->kinds.size();
+	ast->kinds.push_back(kind);
+	ast->ops.push_back(op);
+	ast->first.push_back(FLAT_NONE);
+	ast->second.push_back(FLAT_NONE);
+	ast->third.push_back(FLAT_NONE);
+	return index;
+}
+
+/* converts the tree rooted at the prog node into a flat AST, which owns no part of the tree
+its arrays are built up in vectors, then copied into a single block laid out as in a cache file
+the nodes still to flatten are kept on a heap stack, so deeply nested trees cannot overflow the native stack */
+flatAST* flattenAST(astNode *root){
+	assert(root != NULL && root->type == ast_prog);
+
+	flatBuilder builder;
+	vector<pendingFlatten> pending;
+	pending.push_back({ root, NULL, 0 });
+	while (!pending.empty()){
+		pendingFlatten item = pending.back();
+		pending.pop_back();
+		flattenNode(&builder, item, pending);
+	}
+
+	flatAST *ast = new flatAST();
+	ast->size = builder.kinds.size();
+	ast->numChildren = builder.children.size();
+	ast->root = 0; // the first node added
+	ast->storageSize = storageSize(ast->size, ast->numChildren);
+	ast->storage = (char *)malloc(ast->storageSize);
+	ast->mapping = NULL;
+	ast->mappingSize = 0;
+	pointIntoStorage(ast);
+
+	memcpy(ast->first, builder.first.data(), ast->size * sizeof(int32_t));
+	memcpy(ast->second, builder.second.data(), ast->size * sizeof(int32_t));
+	memcpy(ast->third, builder.third.data(), ast->size * sizeof(int32_t));
+	memcpy(ast->children, builder.children.data(), ast->numChildren * sizeof(int32_t));
+	memcpy(ast->kinds, builder.kinds.data(), ast->size);
+	memcpy(ast->ops, builder.ops.data(), ast->size);
+	return ast;
+}
+
+/* bytes of the block holding the arrays of a flat AST */
+size_t storageSize(int32_t size, int32_t numChildren){
+	return (3 * (size_t)size + numChildren) * sizeof(int32_t) + 2 * (size_t)size;
+}
+
+/* sets the array pointers of the flat AST to their place in its storage */
+void pointIntoStorage(flatAST *ast){
+	int32_t *words = (int32_t *)ast->storage;
+	ast->first = words;
+	ast->second = words + ast->size;
+	ast->third = words + 2 * ast->size;
+	ast->children = words + 3 * ast->size;
+
+	uint8_t *bytes = (uint8_t *)(ast->children + ast->numChildren);
+	ast->kinds = bytes;
+	ast->ops = bytes + ast->size;
+}
+
+/* appends the node and writes its index to its parent's operand, then pushes its children
+last first, so they are popped and appended after it in order */
+void flattenNode(flatBuilder *ast, pendingFlatten item, vector<pendingFlatten> &pending){
+	astNode *node = item.node;
+	assert(node != NULL);
+	int32_t index;
+
+	switch(node->type){
+		case ast_prog:{
+						index = addFlatNode(ast, flat_prog, 0);
+						pending.push_back({ node->prog.func, &ast->third, index });
+						pending.push_back({ node->prog.ext2, &ast->second, index });
+						pending.push_back({ node->prog.ext1, &ast->first, index });
+						break;
+					  }
+		case ast_func:{
+						index = addFlatNode(ast, flat_func, 0);
+						ast->first[index] = node->func.id;
+						pending.push_back({ node->func.body, &ast->third, index });
+						if (node->func.param != NULL){
+							pending.push_back({ node->func.param, &ast->second, index });
+						}
+						break;
+					  }
+		case ast_extern:{
+						index = addFlatNode(ast, flat_extern, 0);
+						ast->first[index] = node->ext.id;
+						break;
+					  }
+		case ast_var: {
+						index = addFlatNode(ast, flat_var, 0);
+						ast->first[index] = node->var.id;
+						ast->second[index] = node->var.slot;
+						break;
+					  }
+		case ast_cnst: {
+						index = addFlatNode(ast, flat_cnst, 0);
+						ast->first[index] = node->cnst.value;
+						break;
+					  }
+		case ast_rexpr: {
+						index = addFlatNode(ast, flat_rexpr, node->rexpr.op);
+						pending.push_back({ node->rexpr.rhs, &ast->second, index });
+						pending.push_back({ node->rexpr.lhs, &ast->first, index });
+						break;
+					  }
+		case ast_bexpr: {
+						index = addFlatNode(ast, flat_bexpr, node->bexpr.op);
+						pending.push_back({ node->bexpr.rhs, &ast->second, index });
+						pending.push_back({ node->bexpr.lhs, &ast->first, index });
+						break;
+					  }
+		case ast_uexpr: {
+						index = addFlatNode(ast, flat_uexpr, node->uexpr.op);
+						pending.push_back({ node->uexpr.expr, &ast->first, index });
+						break;
+					  }
+		case ast_stmt: {
+						astStmt *stmt = &node->stmt;
+						switch(stmt->type){
+							case ast_call: {
+											index = addFlatNode(ast, flat_call, 0);
+											ast->first[index] = stmt->call.id;
+											if (stmt->call.param != NULL){
+												pending.push_back({ stmt->call.param, &ast->second, index });
+											}
+											break;
+										}
+							case ast_ret: {
+											index = addFlatNode(ast, flat_ret, 0);
+											pending.push_back({ stmt->ret.expr, &ast->first, index });
+											break;
+										}
+							case ast_block: {
+											// reserve the block's run of children before flattening them,
+											// so nested blocks take the runs after it
+											index = addFlatNode(ast, flat_block, 0);
+											astNodeList *slist = stmt->block.stmt_list;
+											int32_t offset = ast->children.size();
+											ast->children.resize(offset + slist->size());
+											ast->first[index] = offset;
+											ast->second[index] = slist->size();
+
+											for (size_t i = slist->size(); i > 0; i--){
+												pending.push_back({ (*slist)[i - 1], &ast->children, (int32_t)(offset + i - 1) });
+											}
+											break;
+										}
+							case ast_while: {
+											index = addFlatNode(ast, flat_while, 0);
+											pending.push_back({ stmt->whilen.body, &ast->second, index });
+											pending.push_back({ stmt->whilen.cond, &ast->first, index });
+											break;
+										}
+							case ast_if: {
+											index = addFlatNode(ast, flat_if, 0);
+											if (stmt->ifn.else_body != NULL){
+												pending.push_back({ stmt->ifn.else_body, &ast->third, index });
+											}
+											pending.push_back({ stmt->ifn.if_body, &ast->second, index });
+											pending.push_back({ stmt->ifn.cond, &ast->first, index });
+											break;
+										}
+							case ast_asgn: {
+											index = addFlatNode(ast, flat_asgn, 0);
+											pending.push_back({ stmt->asgn.rhs, &ast->second, index });
+											pending.push_back({ stmt->asgn.lhs, &ast->first, index });
+											break;
+										}
+							case ast_decl: {
+											index = addFlatNode(ast, flat_decl, 0);
+											ast->first[index] = stmt->decl.id;
+											ast->second[index] = stmt->decl.slot;
+											break;
+										}
+							default: {
+										fprintf(stderr,"Incorrect node type\n");
+										exit(1);
+									 }
+						}
+						break;
+					  }
+		default: {
+					fprintf(stderr,"Incorrect node type\n");
+				 	exit(1);
+				 }
+	}
+
+	if (item.operands != NULL){
+		(*item.operands)[item.position] = index;
+	}
+}
+
+void freeFlatAST(flatAST *ast){
+	assert(ast != NULL);
+	if (ast->mapping != NULL)
+		munmap(ast->mapping, ast->mappingSize);
+	else
+		free(ast->storage);
+	delete(ast);
+}
+
+/* returns the bytes the nodes and block children take up */
+size_t flatASTBytes(flatAST *ast){
+	assert(ast != NULL);
+	return storageSize(ast->size, ast->numChildren);
+}
+
+/* functions for the binary cache of a flat AST */
+
+/* writes the flat AST and the names of the current interner to the cache file, 
+tagged with the size and hash of the source it came from
+it is written to a temporary file and renamed over the cache, so a reader never sees half of it
+returns false if the file could not be written */
+bool writeFlatASTCache(const char *path, flatAST *ast, uint64_t sourceSize, uint64_t sourceHash){
+	assert(path != NULL && ast != NULL);
+
+	flatCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, FLAT_AST_MAGIC, sizeof(header.magic));
+	header.version = FLAT_AST_VERSION;
+	header.size = ast->size;
+	header.numChildren = ast->numChildren;
+	header.root = ast->root;
+	header.sourceSize = sourceSize;
+	header.sourceHash = sourceHash;
+
+	// every name with its NUL, in the order of the IDs
+	string names;
+	header.numNames = internedCount();
+	for (uint32_t id = 0; id < header.numNames; id++){
+		names.append(internedName(id));
+		names.push_back('\0');
+	}
+	header.namesSize = names.size();
+
+	string temporary = string(path) + ".tmp";
+	FILE *out = fopen(temporary.c_str(), "wb");
+	if (out == NULL)
+		return false;
+
+	bool written = fwrite(&header, sizeof(header), 1, out) == 1
+		&& fwrite(ast->storage, 1, ast->storageSize, out) == ast->storageSize
+		&& fwrite(names.data(), 1, names.size(), out) == names.size();
+	written &= (fclose(out) == 0);
+
+	if (!written || rename(temporary.c_str(), path) != 0){
+		remove(temporary.c_str());
+		return false;
+	}
+	return true;
+}
+
+/* maps the cache file and returns the flat AST in it, with its arrays left in the mapping
+the interner is restarted with the cached names, so the IDs in the AST mean the same as when written
+returns NULL if there is no cache, or it is from another version or another source */
+flatAST* loadFlatASTCache(const char *path, uint64_t sourceSize, uint64_t sourceHash){
+	assert(path != NULL);
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(flatCacheHeader)){
+		close(fd);
+		return NULL;
+	}
+	size_t length = info.st_size;
+	char *mapping = (char *)mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED)
+		return NULL;
+
+	// the cache must be whole, of this version and made from this exact source
+	flatCacheHeader *header = (flatCacheHeader *)mapping;
+	size_t arrays = storageSize(header->size, header->numChildren);
+	if (memcmp(header->magic, FLAT_AST_MAGIC, sizeof(header->magic)) != 0
+		|| header->version != FLAT_AST_VERSION
+		|| header->sourceSize != sourceSize || header->sourceHash != sourceHash
+		|| header->size <= 0 || header->numChildren < 0
+		|| length != sizeof(flatCacheHeader) + arrays + header->namesSize){
+		munmap(mapping, length);
+		return NULL;
+	}
+
+	// intern the names again, which must come back with the IDs they were written with
+	clearInterner();
+	const char *name = mapping + sizeof(flatCacheHeader) + arrays;
+	const char *end = name + header->namesSize;
+	for (uint32_t id = 0; id < header->numNames; id++){
+		size_t nameLength = strnlen(name, end - name);
+		if (name + nameLength == end || internName(name, nameLength) != (int)id){
+			munmap(mapping, length);
+			return NULL;
+		}
+		name += nameLength + 1;
+	}
+
+	// the arrays are used where they are mapped, the whole mapping is released with the AST
+	flatAST *ast = new flatAST();
+	ast->size = header->size;
+	ast->numChildren = header->numChildren;
+	ast->root = header->root;
+	ast->storage = mapping + sizeof(flatCacheHeader);
+	ast->storageSize = arrays;
+	ast->mapping = mapping;
+	ast->mappingSize = length;
+	pointIntoStorage(ast);
+
+	// a garbled cache is parsed again rather than built from
+	if (!validFlatAST(ast, header->numNames)){
+		freeFlatAST(ast);
+		return NULL;
+	}
+	return ast;
+}
+
+/* checks that a flat AST read from a cache is one the IR builder can build from: every node has a
+known kind, every child is a node after its parent of a kind that may go there and has no other
+parent, every name ID is interned, and each slot is declared once and only used once declared */
+bool validFlatAST(flatAST *ast, uint32_t numNames){
+	int32_t size = ast->size;
+	if (ast->root < 0 || ast->root >= size || ast->kinds[ast->root] != flat_prog)
+		return false;
+
+	// what a child may be: an extern, a func, a var, a term of an expression,
+	// an expression, a condition or a statement
+	enum { want_extern, want_func, want_var, want_term, want_expr, want_cond, want_stmt };
+	vector<uint8_t> hasParent(size, false);
+	auto validChild = [&](int32_t parent, int32_t child, int want){
+		if (child <= parent || child >= size || hasParent[child])
+			return false;
+		hasParent[child] = true;
+
+		uint8_t kind = ast->kinds[child];
+		switch (want){
+			case want_extern: return kind == flat_extern;
+			case want_func: return kind == flat_func;
+			case want_var: return kind == flat_var;
+			case want_term: return kind == flat_var || kind == flat_cnst;
+			case want_expr: return kind == flat_var || kind == flat_cnst || kind == flat_bexpr
+									|| kind == flat_uexpr || kind == flat_call;
+			case want_cond: return kind == flat_rexpr;
+			default: return kind == flat_call || kind == flat_ret || kind == flat_block || kind == flat_while
+									|| kind == flat_if || kind == flat_asgn || kind == flat_decl;
+		}
+	};
+	auto validName = [&](int32_t id){
+		return id >= 0 && (uint32_t)id < numNames;
+	};
+
+	// slots are numbered below the number of nodes, as each is declared by one
+	vector<uint8_t> declared(size, false);
+	vector<int32_t> usedSlots;
+	for (int32_t node = 0; node < size; node++){
+		int32_t first = ast->first[node];
+		int32_t second = ast->second[node];
+		int32_t third = ast->third[node];
+		bool valid;
+		switch (ast->kinds[node]){
+			case flat_prog:
+				valid = validChild(node, first, want_extern) && validChild(node, second, want_extern)
+					&& validChild(node, third, want_func);
+				break;
+			case flat_func:
+				valid = validName(first) && validChild(node, third, want_stmt) && ast->kinds[third] == flat_block;
+				if (valid && second != FLAT_NONE){
+					int32_t slot = validChild(node, second, want_var) ? ast->second[second] : -1;
+					valid = slot >= 0 && slot < size && !declared[slot];
+					if (valid)
+						declared[slot] = true;
+				}
+				break;
+			case flat_extern:
+				valid = validName(first);
+				break;
+			case flat_var:
+				valid = validName(first) && second >= 0 && second < size;
+				usedSlots.push_back(second);
+				break;
+			case flat_decl:
+				valid = validName(first) && second >= 0 && second < size && !declared[second];
+				if (valid)
+					declared[second] = true;
+				break;
+			case flat_cnst:
+				valid = true;
+				break;
+			case flat_rexpr:
+				valid = ast->ops[node] <= neq && validChild(node, first, want_term) && validChild(node, second, want_term);
+				break;
+			case flat_bexpr:
+				valid = ast->ops[node] <= mul && validChild(node, first, want_term) && validChild(node, second, want_term);
+				break;
+			case flat_uexpr:
+				valid = validChild(node, first, want_term);
+				break;
+			case flat_call:
+				valid = validName(first) && (second == FLAT_NONE ? first != id_print : validChild(node, second, want_expr));
+				break;
+			case flat_ret:
+				valid = validChild(node, first, want_expr);
+				break;
+			case flat_block:
+				valid = first >= 0 && second >= 0 && first <= ast->numChildren - second;
+				for (int32_t i = 0; valid && i < second; i++)
+					valid = validChild(node, ast->children[first + i], want_stmt);
+				break;
+			case flat_while:
+				valid = validChild(node, first, want_cond) && validChild(node, second, want_stmt);
+				break;
+			case flat_if:
+				valid = validChild(node, first, want_cond) && validChild(node, second, want_stmt)
+					&& (third == FLAT_NONE || validChild(node, third, want_stmt));
+				break;
+			case flat_asgn:
+				valid = validChild(node, first, want_var) && validChild(node, second, want_expr);
+				break;
+			default:
+				valid = false;
+				break;
+		}
+		if (!valid)
+			return false;
+	}
+
+	// the slots used must be declared, anywhere, as the builder allocates all of them first
+	for (size_t i = 0; i < usedSlots.size(); i++){
+		if (!declared[usedSlots[i]])
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,94 @@
+#ifndef FLAT_AST_H
+#define FLAT_AST_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "ast.h"
+using namespace std;
+
+#define FLAT_NONE -1 // index of an absent child (no parameter, no else body)
+
+//enum to identify flat node kinds, one per node type and statement type
+typedef enum {
+		flat_prog,
+		flat_func,
+		flat_extern,
+		flat_var,
+		flat_cnst,
+		flat_rexpr,
+		flat_bexpr,
+		flat_uexpr,
+		flat_call,
+		flat_ret,
+		flat_block,
+		flat_while,
+		flat_if,
+		flat_asgn,
+		flat_decl
+	} flat_kind;
+
+/* the AST as parallel arrays indexed by 32-bit node indices, in pre-order so a parent
+ * always comes before its children, with the statements of each block next to each other
+ * what the operands of a node hold depends on its kind:
+ *   prog              first = extern, second = extern, third = func
+ *   func              first = name ID, second = param var (or FLAT_NONE), third = body block
+ *   extern            first = name ID
+ *   var, decl         first = name ID, second = stack slot (-1 until semantic analysis resolves it)
+ *   cnst              first = value
+ *   rexpr, bexpr      first = lhs, second = rhs, op = rop_type / op_type
+ *   uexpr             first = expr, op = op_type
+ *   call              first = name ID, second = param (or FLAT_NONE)
+ *   ret               first = expr
+ *   block             first = offset of its statements in children, second = number of statements
+ *   while             first = cond, second = body
+ *   if                first = cond, second = if body, third = else body (or FLAT_NONE)
+ *   asgn              first = lhs var, second = rhs
+ */
+typedef struct {
+		int32_t* first;
+		int32_t* second;
+		int32_t* third;
+		int32_t* children; // statements of every block
+		uint8_t* kinds; // flat_kind of each node
+		uint8_t* ops;
+		int32_t size; // number of nodes
+		int32_t numChildren;
+		int32_t root;
+		char* storage; // one block holding every array, in the order above
+		size_t storageSize;
+		char* mapping; // the mapped cache file the storage lies in, or NULL if it was malloc'd
+		size_t mappingSize;
+	} flatAST;
+
+/* header of a cache file, followed by the flat AST's storage block and then the name of every
+ * interned ID in order, each ending in a NUL - the arrays are in the byte order of the machine
+ * that wrote them, as the cache is only meant for repeated builds on the same machine
+ */
+#define FLAT_AST_MAGIC "miniCAST"
+#define FLAT_AST_VERSION 2
+
+typedef struct {
+		char magic[8];
+		uint32_t version;
+		int32_t size;
+		int32_t numChildren;
+		int32_t root;
+		uint64_t sourceSize; // the source the cache was made from, to tell if it has changed since
+		uint64_t sourceHash;
+		uint32_t numNames;
+		uint32_t namesSize; // bytes of the names, NULs included
+	} flatCacheHeader;
+
+/* FUNCTIONS */
+/* --------- */
+
+flatAST* flattenAST(astNode* root);
+void freeFlatAST(flatAST* ast);
+size_t flatASTBytes(flatAST* ast);
+
+/* the cache functions */
+bool writeFlatASTCache(const char* path, flatAST* ast, uint64_t sourceSize, uint64_t sourceHash);
+flatAST* loadFlatASTCache(const char* path, uint64_t sourceSize, uint64_t sourceHash);
+
+#endif
@@ -2,8 +2,8 @@
 #include<stdio.h>
 
 int main(){
-	vector<astNode*> *slist;
-	slist = new vector<astNode*> ();
+	astNodeList *slist;
+	slist = createNodeList();
 
 	astNode *a11 = createVar("test1");
 	astNode *a12 = createVar("test2");
@@ -0,0 +1,9 @@
+extern void print(int);
+extern int read();
+
+int func(int n){
+	if (n > 100) {
+		n = 1;
+	}
+	return n;
+}
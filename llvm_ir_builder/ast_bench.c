@@ -0,0 +1,309 @@
+/*
+ * This is a benchmark program for the flat AST which parses a large generated miniC source,
+ * then times semantic analysis and IR generation on the pointer tree against the flat AST,
+ * printing the memory each representation takes up, times the fused check and build against
+ * the separate passes, and times a cold parse and check of the source against loading its AST
+ * from the binary cache
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <string>
+#include <llvm-c/Core.h>
+#include "../syntax_analyzer/semantic_analysis.h"
+#include "../syntax_analyzer/parser.h"
+#include "../syntax_analyzer/source_buffer.h"
+#include "llvm_gen.h"
+#include "../helper/elapsed_time.h"
+using namespace std;
+
+/* FUNCTION PROTOTYPES */
+/* ------------------- */
+
+bool benchCache(const char* path, int repeats);
+bool rejectsGarbledCache(const char* cachePath, size_t sourceSize, uint64_t sourceHash);
+void writeSource(const char* path, int numStatements);
+void writeStatement(FILE* out, int i, int depth, int numVars);
+
+
+/* MAIN */
+/* ---- */
+
+int main(int argc, char** argv){
+
+    // benchmarks a generated source of [statements] statements, the best of [repeats] runs
+    const char* path = "ast_bench_input.c";
+    int numStatements = (argc > 1) ? atoi(argv[1]) : 100000;
+    int repeats = (argc > 2) ? atoi(argv[2]) : 5;
+    assert(numStatements > 0 && repeats > 0);
+    writeSource(path, numStatements);
+
+    double best[6] = { -1, -1, -1, -1, -1, -1 };
+    size_t treeBytes = 0;
+    size_t flatBytes = 0;
+    for(int r = 0; r < repeats; r++) {
+        FILE* input = fopen(path, "r");
+        assert(input != NULL);
+        astArena* arena = createArena();
+        astNode* root = parseFile(input, arena);
+        fclose(input);
+        assert(root != NULL);
+
+        // the fused build runs first, on the tree as it was parsed, and its module is only kept as text
+        struct timespec times[8];
+        clock_gettime(CLOCK_MONOTONIC, &times[6]);
+        LLVMContextRef fusedContext = LLVMContextCreate();
+        LLVMModuleRef fusedModule = createLLVMModelFromAST_fused(root, (char*) path, fusedContext);
+        clock_gettime(CLOCK_MONOTONIC, &times[7]);
+        assert(fusedModule != NULL);
+        char* fusedIR = (r == 0) ? LLVMPrintModuleToString(fusedModule) : NULL;
+        LLVMDisposeModule(fusedModule);
+        LLVMContextDispose(fusedContext);
+
+        clock_gettime(CLOCK_MONOTONIC, &times[0]);
+        flatAST* flat = flattenAST(root);
+        clock_gettime(CLOCK_MONOTONIC, &times[1]);
+        bool treeValid = semanticAnalysis_opt(root);
+        clock_gettime(CLOCK_MONOTONIC, &times[2]);
+        bool flatValid = semanticAnalysis_flat(flat);
+        clock_gettime(CLOCK_MONOTONIC, &times[3]);
+        LLVMContextRef treeContext = LLVMContextCreate();
+        LLVMModuleRef treeModule = createLLVMModelFromASTInContext(root, (char*) path, treeContext);
+        clock_gettime(CLOCK_MONOTONIC, &times[4]);
+        LLVMContextRef flatContext = LLVMContextCreate();
+        LLVMModuleRef flatModule = createLLVMModelFromFlatAST(flat, (char*) path, flatContext);
+        clock_gettime(CLOCK_MONOTONIC, &times[5]);
+        assert(treeValid && flatValid);
+
+        // both representations, and the fused build, must build the same module
+        if(r == 0) {
+            char* treeIR = LLVMPrintModuleToString(treeModule);
+            char* flatIR = LLVMPrintModuleToString(flatModule);
+            if(strcmp(treeIR, flatIR) != 0) {
+                printf("The tree and flat AST built different modules\n");
+                return 1;
+            }
+            if(strcmp(treeIR, fusedIR) != 0) {
+                printf("The separate passes and the fused build built different modules\n");
+                return 1;
+            }
+            LLVMDisposeMessage(treeIR);
+            LLVMDisposeMessage(flatIR);
+            LLVMDisposeMessage(fusedIR);
+        }
+
+        for(int i = 0; i < 6; i++) {
+            double ms = (i < 5) ? elapsedMs(times[i], times[i + 1]) : elapsedMs(times[6], times[7]);
+            if(best[i] < 0 || ms < best[i]) {
+                best[i] = ms;
+            }
+        }
+        treeBytes = arena->bytes;
+        flatBytes = flatASTBytes(flat);
+
+        LLVMDisposeModule(treeModule);
+        LLVMContextDispose(treeContext);
+        LLVMDisposeModule(flatModule);
+        LLVMContextDispose(flatContext);
+        freeFlatAST(flat);
+        freeArena(arena);
+    }
+
+    printf("statements: %d\n", numStatements);
+    printf("%-28s %10.2f ms\n", "flattenAST", best[0]);
+    printf("%-28s %10.2f ms\n", "semanticAnalysis_opt", best[1]);
+    printf("%-28s %10.2f ms\n", "semanticAnalysis_flat", best[2]);
+    printf("%-28s %10.2f ms\n", "createLLVMModelFromAST", best[3]);
+    printf("%-28s %10.2f ms\n", "createLLVMModelFromFlatAST", best[4]);
+    printf("%-28s %10.2f ms (checked and built separately: %.2f ms)\n", "createLLVMModelFromAST_fused",
+        best[5], best[1] + best[3]);
+    printf("tree: %zu bytes, flat: %zu bytes\n", treeBytes, flatBytes);
+
+    bool cacheMatches = benchCache(path, repeats);
+    remove(path);
+    return cacheMatches ? 0 : 1;
+}
+
+/* times what a build does before IR generation with and without a cache of the source's AST:
+ * mapping, parsing and checking the source, against mapping and hashing it and loading the cache
+ * returns false if the module built from the cache differs from the one built from the tree,
+ * or if the cache is loaded once its arrays are garbled
+ */
+bool benchCache(const char* path, int repeats) {
+    string cachePath = string(path) + ".ast";
+    double bestParse = -1;
+    double bestLoad = -1;
+    size_t cacheBytes = 0;
+    bool matches = true;
+    bool rejects = true;
+
+    for(int r = 0; r < repeats; r++) {
+        // cold: parse and check the source, then cache it
+        struct timespec times[4];
+        clock_gettime(CLOCK_MONOTONIC, &times[0]);
+        sourceBuffer source;
+        bool loaded = loadSource(path, &source);
+        assert(loaded);
+        astArena* arena = createArena();
+        astNode* root = parseBuffer(source.data, source.size, arena);
+        releaseSource(&source);
+        bool valid = semanticAnalysis_opt(root);
+        clock_gettime(CLOCK_MONOTONIC, &times[1]);
+        assert(valid);
+
+        flatAST* flat = flattenAST(root);
+        loaded = loadSource(path, &source);
+        bool written = writeFlatASTCache(cachePath.c_str(), flat, source.size, hashSource(&source));
+        assert(loaded && written);
+        struct stat info;
+        if(stat(cachePath.c_str(), &info) == 0) {
+            cacheBytes = info.st_size;
+        }
+        freeFlatAST(flat);
+        releaseSource(&source);
+
+        // cached: check the source is unchanged and map its AST
+        clock_gettime(CLOCK_MONOTONIC, &times[2]);
+        loaded = loadSource(path, &source);
+        assert(loaded);
+        flatAST* cached = loadFlatASTCache(cachePath.c_str(), source.size, hashSource(&source));
+        releaseSource(&source);
+        clock_gettime(CLOCK_MONOTONIC, &times[3]);
+        assert(cached != NULL);
+
+        // the cached AST must build the same module as the tree
+        if(r == 0) {
+            LLVMContextRef treeContext = LLVMContextCreate();
+            LLVMModuleRef treeModule = createLLVMModelFromASTInContext(root, (char*) path, treeContext);
+            LLVMContextRef cacheContext = LLVMContextCreate();
+            LLVMModuleRef cacheModule = createLLVMModelFromFlatAST(cached, (char*) path, cacheContext);
+            char* treeIR = LLVMPrintModuleToString(treeModule);
+            char* cacheIR = LLVMPrintModuleToString(cacheModule);
+            matches = (strcmp(treeIR, cacheIR) == 0);
+            LLVMDisposeMessage(treeIR);
+            LLVMDisposeMessage(cacheIR);
+            LLVMDisposeModule(treeModule);
+            LLVMContextDispose(treeContext);
+            LLVMDisposeModule(cacheModule);
+            LLVMContextDispose(cacheContext);
+
+            loaded = loadSource(path, &source);
+            assert(loaded);
+            rejects = rejectsGarbledCache(cachePath.c_str(), source.size, hashSource(&source));
+            releaseSource(&source);
+        }
+
+        double parseMs = elapsedMs(times[0], times[1]);
+        double loadMs = elapsedMs(times[2], times[3]);
+        if(bestParse < 0 || parseMs < bestParse) {
+            bestParse = parseMs;
+        }
+        if(bestLoad < 0 || loadMs < bestLoad) {
+            bestLoad = loadMs;
+        }
+        freeFlatAST(cached);
+        freeArena(arena);
+    }
+
+    printf("%-28s %10.2f ms\n", "parse + semanticAnalysis_opt", bestParse);
+    printf("%-28s %10.2f ms (%zu byte cache)\n", "hashSource + loadFlatASTCache", bestLoad, cacheBytes);
+    if(!matches) {
+        printf("The tree and cached AST built different modules\n");
+    }
+    if(!rejects) {
+        printf("A cache with garbled arrays was loaded\n");
+    }
+
+    remove(cachePath.c_str());
+    return matches && rejects;
+}
+
+/* copies the cache with the first nodes after its header overwritten, keeping the header and the
+ * length valid, and returns true if loading the copy fails as it should
+ */
+bool rejectsGarbledCache(const char* cachePath, size_t sourceSize, uint64_t sourceHash) {
+    FILE* in = fopen(cachePath, "rb");
+    assert(in != NULL);
+    string bytes;
+    char buffer[4096];
+    size_t read;
+    while((read = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        bytes.append(buffer, read);
+    }
+    fclose(in);
+    assert(bytes.size() >= sizeof(flatCacheHeader) + 40);
+
+    // the first operand of the first nodes, the root's among them, now points nowhere
+    memset(&bytes[sizeof(flatCacheHeader)], 0xff, 40);
+    string garbledPath = string(cachePath) + ".garbled";
+    FILE* out = fopen(garbledPath.c_str(), "wb");
+    assert(out != NULL);
+    fwrite(bytes.data(), 1, bytes.size(), out);
+    fclose(out);
+
+    flatAST* garbled = loadFlatASTCache(garbledPath.c_str(), sourceSize, sourceHash);
+    remove(garbledPath.c_str());
+    if(garbled != NULL) {
+        freeFlatAST(garbled);
+        return false;
+    }
+    return true;
+}
+
+/* writes a valid miniC program whose function body has the given number of statements,
+ * with ifs and whiles nesting blocks a few levels deep
+ */
+void writeSource(const char* path, int numStatements) {
+    FILE* out = fopen(path, "w");
+    assert(out != NULL);
+
+    fprintf(out, "extern void print(int);\nextern int read();\n\nint func(int p){\n");
+    int numVars = 256;
+    for(int v = 0; v < numVars; v++) {
+        fprintf(out, "\tint var_%d;\n", v);
+    }
+
+    for(int i = 0; i < numStatements; i++) {
+        writeStatement(out, i, 0, numVars);
+    }
+
+    fprintf(out, "\treturn var_0;\n}\n");
+    fclose(out);
+}
+
+/* writes statement i, nesting a block of further statements under every eighth one */
+void writeStatement(FILE* out, int i, int depth, int numVars) {
+    const char* ops[] = { "+", "-", "*", "/" };
+    int a = i % numVars;
+    int b = (i * 7 + 3) % numVars;
+
+    if(i % 8 == 7 && depth < 3) {
+        fprintf(out, (i % 16 == 7) ? "\tif (var_%d < var_%d) {\n" : "\twhile (var_%d > var_%d) {\n", a, b);
+        fprintf(out, "\tint inner_%d;\n", depth);
+        fprintf(out, "\tinner_%d = var_%d;\n", depth, b);
+        for(int j = 1; j < 8; j++) {
+            writeStatement(out, i + j, depth + 1, numVars);
+        }
+        fprintf(out, "\t}\n");
+        return;
+    }
+
+    switch(i % 4) {
+        case 0:
+            fprintf(out, "\tvar_%d = var_%d %s %d;\n", a, b, ops[i % 4], i);
+            break;
+        case 1:
+            fprintf(out, "\tif (var_%d <= var_%d) var_%d = read(); else print(var_%d);\n", a, b, a, b);
+            break;
+        case 2:
+            fprintf(out, "\tvar_%d = var_%d %s p;\n", a, b, ops[i % 4]);
+            break;
+        default:
+            fprintf(out, "\tvar_%d = -var_%d;\n", a, b);
+            break;
+    }
+}
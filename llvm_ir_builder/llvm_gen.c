@@ -5,30 +5,109 @@
 #include <stdio.h>
 #include <string.h>
 #include "llvm_gen.h"
-#include "../helper/helper_functions.h"
+#include "../helper/cfg.h"
+#include "../syntax_analyzer/semantic_analysis.h"
 #include <unordered_map>
-#include <set>
-#include <deque>
-#include <string>
+#include <unordered_set>
+#include <algorithm>
 //#define NDEBUG
 #include <cassert>
 
 using namespace std;
 
+/* what traverseAST does with a step: build a statement, 
+ * or branch to / move the builder to a block once the statements before it are built,
+ * or (in a fused build) close the scope of a block once its statements are built
+ * or (in an SSA build) seal a block once all of its predecessors are built
+ */
+typedef enum { build_stmt, build_branch, build_position, build_close, build_seal } build_action;
+
+typedef struct {
+        build_action action;
+        astNode* node; // statement to build
+        LLVMBasicBlockRef block; // block to branch to or position at
+    } buildStep;
+
+// the same for a flat build, whose statements are indices into the flat ast
+typedef struct {
+        build_action action;
+        int32_t node;
+        LLVMBasicBlockRef block;
+    } flatStep;
+
+/* what an SSA build knows of a block: the predecessors branching to it so far, and the phis
+ * of slots read in it before it was sealed, whose operands are added once no more predecessors can come
+ * the value each slot was last given in it is kept in ssaDefs under the block's number
+ */
+typedef struct {
+        int number; // blocks are numbered as the build reaches them
+        vector<LLVMBasicBlockRef> preds;
+        bool sealed; // every predecessor has been built
+        vector<pair<int, LLVMValueRef>> incompletePhis; // slot and phi
+        bool visiting; // a lookup is in its predecessors
+        LLVMValueRef cyclePhi; // phi added when that lookup came back to it, if it did
+        vector<int>* assigned; // sorted slots the body assigns if it is a loop's condition, NULL otherwise
+    } ssaBlock;
+
+/* a sealed block with several predecessors a lookup of a slot is in, and the blocks with
+ * a single predecessor it walked through to reach it, which take the same definition
+ */
+typedef struct {
+        LLVMBasicBlockRef block;
+        vector<LLVMBasicBlockRef> walked;
+        vector<LLVMValueRef> values; // the slot's value in each predecessor looked in so far
+    } ssaLookup;
+
+#define SSA_RETURN_SLOT -1 // the return value of an SSA build is tracked like a variable in this slot
+#define ssaDefKey(number, slot) (((uint64_t) (number) << 32) | (uint32_t) (slot))
+
 /* FUNCTION PROTOTYPES */
 /* ------------------- */
 
+LLVMModuleRef buildModuleShell(char* filename, int ext1, int ext2, int funcID, bool hasParam, bool ssa);
+void addExtern(LLVMModuleRef mod, int id);
+LLVMValueRef allocateVariable(int slot, int id);
+
 void traverseAST(astNode* node);
+void buildStatement(astNode* node, vector<buildStep>& steps);
 void getDeclarations(astNode* node);
-void handleStatements_decs(astNode* node);
+void handleStatements_decs(astNode* node, vector<astNode*>& pending);
 
 LLVMValueRef getLLVMCondition(astNode* node);
 LLVMValueRef getLLVMExpression(astNode* node);
 LLVMValueRef getTerm(astNode* node, bool negative);
 
+bool traverseAST_fused(astNode* node);
+bool buildStatement_fused(astNode* node, vector<buildStep>& steps);
+LLVMValueRef allocateVariable_fused(int slot, int id);
+
+void traverseAST_flat(int32_t node);
+void buildStatement_flat(int32_t node, vector<flatStep>& steps);
+void getDeclarations_flat(int32_t node);
+LLVMValueRef getLLVMCondition_flat(int32_t node);
+LLVMValueRef getLLVMExpression_flat(int32_t node);
+LLVMValueRef getTerm_flat(int32_t node, bool negative);
+
+void traverseAST_ssa(astNode* node);
+void findLoopAssignments_ssa(astNode* node);
+void buildStatement_ssa(astNode* node, vector<buildStep>& steps);
+ssaBlock& blockState_ssa(LLVMBasicBlockRef block);
+bool isLiveBlock_ssa(LLVMBasicBlockRef block);
+void branch_ssa(LLVMBasicBlockRef target);
+void condBranch_ssa(LLVMValueRef condition, LLVMBasicBlockRef then, LLVMBasicBlockRef otherwise);
+void sealBlock_ssa(LLVMBasicBlockRef block);
+void writeVariable_ssa(int slot, LLVMBasicBlockRef block, LLVMValueRef value);
+LLVMValueRef useVariable_ssa(int slot);
+LLVMValueRef readVariable_ssa(int slot, LLVMBasicBlockRef block);
+LLVMValueRef findDefinition_ssa(int slot, LLVMBasicBlockRef block, vector<ssaLookup>& lookups);
+LLVMValueRef joinDefinitions_ssa(int slot, ssaLookup& lookup);
+LLVMValueRef addPhi_ssa(LLVMBasicBlockRef block);
+void removeTrivialPhis_ssa(vector<LLVMValueRef>& candidates);
+LLVMValueRef resolveValue_ssa(LLVMValueRef value);
+
 void deadTerminatorElimination(LLVMValueRef function);
-void deadBlockElimination(LLVMValueRef function);
-void mergeLinearBlocks(LLVMValueRef function);
+void deadBlockElimination(LLVMValueRef function, const controlFlowGraph& cfg);
+void mergeLinearBlocks(LLVMValueRef function, const controlFlowGraph& cfg);
     void mergeBlocks(LLVMBasicBlockRef first, LLVMBasicBlockRef second);
 
 void deleteBasicBlocks(vector<LLVMBasicBlockRef> blocks);
@@ -37,121 +116,204 @@ void deleteBasicBlocks(vector<LLVMBasicBlockRef> blocks);
 /* GLOBAL VARIABLES */
 /* ---------------- */
 
-unordered_map<string, LLVMValueRef> vars; 
-LLVMValueRef func;
-LLVMValueRef printFunc;
-LLVMValueRef readFunc;
-LLVMTypeRef printType;
-LLVMTypeRef readType;
-LLVMBasicBlockRef returnBlock;
-LLVMBuilderRef builder;
-
-unordered_map<LLVMBasicBlockRef, set<LLVMBasicBlockRef>> bbOutGraph;
-unordered_map<LLVMBasicBlockRef, set<LLVMBasicBlockRef>> bbInGraph;
+thread_local LLVMContextRef context; // context of the module being built or optimized
+thread_local vector<LLVMValueRef> vars; // allocation of each variable, indexed by the stack slot semantic analysis gave it
+thread_local LLVMValueRef returnVar; // allocation of the return value
+thread_local LLVMValueRef func;
+thread_local LLVMValueRef printFunc;
+thread_local LLVMValueRef readFunc;
+thread_local LLVMTypeRef printType;
+thread_local LLVMTypeRef readType;
+thread_local LLVMBasicBlockRef returnBlock;
+thread_local LLVMBuilderRef builder;
+thread_local flatAST* flat; // flat AST being built, if any
+thread_local LLVMBuilderRef entryBuilder; // adds the allocations of a fused build to the first block
+thread_local LLVMValueRef lastAllocation; // allocation in the first block the next one goes after
+
+thread_local bool buildSSA; // whether variables are read as SSA values rather than loaded
+thread_local unordered_map<LLVMBasicBlockRef, ssaBlock> ssaBlocks;
+thread_local unordered_map<uint64_t, LLVMValueRef> ssaDefs; // current value of a slot in a block, keyed by ssaDefKey
+thread_local unordered_set<LLVMValueRef> unfilledPhis; // phis without their operands yet, which cannot be removed
+thread_local unordered_map<LLVMValueRef, LLVMValueRef> replacedPhis; // trivial phi and the value that replaced it
+thread_local unordered_map<astNode*, vector<int>> loopAssignments; // sorted slots each while's body assigns
+thread_local LLVMBuilderRef phiBuilder; // adds phis to the top of blocks
 
 
 /* BUILD METHODS */
 /* ------- */
 
+/* builds the module in the global LLVM context */
+LLVMModuleRef createLLVMModelFromAST(astNode* root, char* filename) {
+    return createLLVMModelFromASTInContext(root, filename, LLVMGetGlobalContext());
+}
+
 /* main semantic analysis method - 
  * traverses nodes and handles them according to type 
+ * the module and all of its types live in the given context
  */
-LLVMModuleRef createLLVMModelFromAST(astNode* root, char* filename) {  
+LLVMModuleRef createLLVMModelFromASTInContext(astNode* root, char* filename, LLVMContextRef llvmContext) {  
     assert(root != NULL);
+    assert(llvmContext != NULL);
+    context = llvmContext;
+
+    // create the module, externs and function
+    assert(root->prog.ext1 != NULL && root->prog.ext2 != NULL);
+    assert(root->prog.func != NULL);
+    astNode* param = root->prog.func->func.param;
+    LLVMModuleRef mod = buildModuleShell(filename, root->prog.ext1->ext.id, root->prog.ext2->ext.id,
+        root->prog.func->func.id, param != NULL, false);
+
+    // allocate
+    if(param != NULL) {
+        assert(param->var.slot >= 0); // set by semantic analysis
+        LLVMValueRef paramVar = allocateVariable(param->var.slot, param->var.id);
+        assert(root->prog.func->func.body != NULL);
+        getDeclarations(root->prog.func->func.body); // add all other allocations of variables in the program
+        LLVMBuildStore(builder, LLVMGetParam(func, 0), paramVar);
+    } else {
+        assert(root->prog.func->func.body != NULL);
+        getDeclarations(root->prog.func->func.body); // add all other allocations of variables in the program
+    }
+
+    // traverse the ast
+    traverseAST(root->prog.func->func.body);
+    LLVMDisposeBuilder(builder);
+
+    LLVMMoveBasicBlockAfter(returnBlock, LLVMGetLastBasicBlock(func));
+   
+    return mod;
+}
+
+/* creates the module with its two externs and the function, whose first block holds the
+ * return value's allocation and whose return block loads and returns it
+ * (for an SSA build, the return block is left empty and nothing is allocated)
+ * leaves the builder at the end of the first block, ready for the variables' allocations
+ */
+LLVMModuleRef buildModuleShell(char* filename, int ext1, int ext2, int funcID, bool hasParam, bool ssa) {
+    assert(filename != NULL);
+
+    // forget the variables and externs of any previously built module
+    vars.clear();
+    printFunc = NULL;
+    readFunc = NULL;
 
     // create module
-    LLVMModuleRef mod = LLVMModuleCreateWithName("");
+    LLVMModuleRef mod = LLVMModuleCreateWithNameInContext("", context);
     LLVMSetTarget(mod, "x86_64-pc-linux-gnu");
 
 
     LLVMSetSourceFileName(mod, filename, strlen(filename));
 
     // create extern functions
-    assert(root->prog.ext1 != NULL);
-    if(root->prog.ext1 != NULL) {
-        if(strcmp(root->prog.ext1->ext.name, "print") == 0) {
-            LLVMTypeRef param_types[] = { LLVMInt32Type() };
-            printType = LLVMFunctionType(LLVMVoidType(), param_types, 1, 0);
-            assert(root->prog.ext1->ext.name != NULL);
-            printFunc = LLVMAddFunction(mod, root->prog.ext1->ext.name, printType);
-        } else if(strcmp(root->prog.ext1->ext.name, "read") == 0) {
-            readType = LLVMFunctionType(LLVMInt32Type(), {}, 0, 0);
-            assert(root->prog.ext1->ext.name != NULL);
-            readFunc = LLVMAddFunction(mod, root->prog.ext1->ext.name, readType);
-        }
-    }
-
-    assert(root->prog.ext2 != NULL);
-    if(root->prog.ext2 != NULL) {
-        if(strcmp(root->prog.ext2->ext.name, "print") == 0) {
-            LLVMTypeRef param_types[] = { LLVMInt32Type() };
-            printType = LLVMFunctionType(LLVMVoidType(), param_types, 1, 0);
-            assert(root->prog.ext2->ext.name != NULL);
-            printFunc = LLVMAddFunction(mod, root->prog.ext2->ext.name, printType);
-        } else if(strcmp(root->prog.ext2->ext.name, "read") == 0) {
-            readType = LLVMFunctionType(LLVMInt32Type(), {}, 0, 0);
-            assert(root->prog.ext2->ext.name != NULL);
-            readFunc = LLVMAddFunction(mod, root->prog.ext2->ext.name, readType);
-        }
-    }
+    addExtern(mod, ext1);
+    addExtern(mod, ext2);
 
     // create function with module
-    assert(root->prog.func != NULL);
-    if(root->prog.func->func.param != NULL) {
-        LLVMTypeRef param_types[] = { LLVMInt32Type() };
-        LLVMTypeRef ret_type = LLVMFunctionType(LLVMInt32Type(), param_types, 1, 0);
-        assert(root->prog.func->func.name);
-        func = LLVMAddFunction(mod, root->prog.func->func.name, ret_type);
+    if(hasParam) {
+        LLVMTypeRef param_types[] = { LLVMInt32TypeInContext(context) };
+        LLVMTypeRef ret_type = LLVMFunctionType(LLVMInt32TypeInContext(context), param_types, 1, 0);
+        func = LLVMAddFunction(mod, internedName(funcID), ret_type);
     } else {
-        LLVMTypeRef ret_type = LLVMFunctionType(LLVMInt32Type(), {}, 0, 0);
-        assert(root->prog.func->func.name);
-        func = LLVMAddFunction(mod, root->prog.func->func.name, ret_type);
+        LLVMTypeRef ret_type = LLVMFunctionType(LLVMInt32TypeInContext(context), {}, 0, 0);
+        func = LLVMAddFunction(mod, internedName(funcID), ret_type);
     }
 
     // build first basic block for function wrapper
-    LLVMBasicBlockRef first = LLVMAppendBasicBlock(func, "");
-    builder = LLVMCreateBuilder();
+    LLVMBasicBlockRef first = LLVMAppendBasicBlockInContext(context, func, "");
+    builder = LLVMCreateBuilderInContext(context);
+    returnBlock = LLVMAppendBasicBlockInContext(context, func, "");
+    if(ssa) { // the return value is only known once every return is built
+        returnVar = NULL;
+        LLVMPositionBuilderAtEnd(builder, first);
+        return mod;
+    }
     LLVMPositionBuilderAtEnd(builder, first);
-    LLVMValueRef returnVal = LLVMBuildAlloca(builder, LLVMInt32Type(), "RETURN");
+    LLVMValueRef returnVal = LLVMBuildAlloca(builder, LLVMInt32TypeInContext(context), "RETURN");
     LLVMSetAlignment(returnVal, 4);
-    vars["return"] = returnVal;
+    returnVar = returnVal;
 
     // initialize return block with return statement for return value
-    returnBlock = LLVMAppendBasicBlock(func, "");
     LLVMPositionBuilderAtEnd(builder, returnBlock);
-    LLVMValueRef toReturn = LLVMBuildLoad2(builder, LLVMInt32Type(), returnVal, "");
+    LLVMValueRef toReturn = LLVMBuildLoad2(builder, LLVMInt32TypeInContext(context), returnVal, "");
     LLVMBuildRet(builder, toReturn);
     LLVMPositionBuilderAtEnd(builder, first);
 
-    // allocate
-    if(root->prog.func->func.param != NULL) {
-        assert(root->prog.func->func.param->var.name != NULL);
-        LLVMValueRef param = LLVMBuildAlloca(builder, LLVMInt32Type(), root->prog.func->func.param->var.name);
-        LLVMSetAlignment(param, 4);
-        vars[root->prog.func->func.param->var.name] = param;
-        assert(root->prog.func->func.body != NULL);
-        getDeclarations(root->prog.func->func.body); // add all other allocations of variables in the program
-        LLVMBuildStore(builder, LLVMGetParam(func, 0), param);
-    } else {
-        assert(root->prog.func->func.body != NULL);
-        getDeclarations(root->prog.func->func.body); // add all other allocations of variables in the program
+    return mod;
+}
+
+/* declares the extern print or read function in the module */
+void addExtern(LLVMModuleRef mod, int id) {
+    if(id == id_print) {
+        LLVMTypeRef param_types[] = { LLVMInt32TypeInContext(context) };
+        printType = LLVMFunctionType(LLVMVoidTypeInContext(context), param_types, 1, 0);
+        printFunc = LLVMAddFunction(mod, internedName(id), printType);
+    } else if(id == id_read) {
+        readType = LLVMFunctionType(LLVMInt32TypeInContext(context), {}, 0, 0);
+        readFunc = LLVMAddFunction(mod, internedName(id), readType);
     }
+}
 
-    // traverse the ast
-    traverseAST(root->prog.func->func.body);
-    LLVMDisposeBuilder(builder);
+/* allocates a variable at the builder's position and adds it to the map of variables
+ * under the stack slot semantic analysis gave its declaration, naming it after the variable
+ */
+LLVMValueRef allocateVariable(int slot, int id) {
+    assert(slot >= 0);
+    if(slot >= (int) vars.size()) {
+        vars.resize(slot + 1, NULL);
+    }
+    assert(vars[slot] == NULL);
 
-    LLVMMoveBasicBlockAfter(returnBlock, LLVMGetLastBasicBlock(func));
-   
-    return mod;
+    LLVMValueRef var = LLVMBuildAlloca(builder, LLVMInt32TypeInContext(context), internedName(id));
+    LLVMSetAlignment(var, 4);
+    vars[slot] = var;
+    return var;
 }
 
 /* traverses the statements of an ast and 
  * builds the basic blocks accordingly
+ * the work left after a statement's children (branching back, moving to the final block)
+ * is kept as steps on a heap stack, so deep nesting cannot overflow the native stack
  */
 void traverseAST(astNode* node) {
     assert(node != NULL);
 
+    vector<buildStep> steps;
+    steps.push_back({ build_stmt, node, NULL });
+
+    while(!steps.empty()) {
+        buildStep step = steps.back();
+        steps.pop_back();
+
+        switch(step.action) {
+            case(build_stmt): {
+                buildStatement(step.node, steps);
+                break;
+            }
+
+            case(build_branch): {
+                LLVMBuildBr(builder, step.block);
+                break;
+            }
+
+            case(build_position): {
+                LLVMPositionBuilderAtEnd(builder, step.block);
+                break;
+            }
+
+            // scopes are only tracked by a fused build
+            default:
+                break;
+        }
+    }
+
+}
+
+/* builds a single statement, pushing its bodies and whatever follows them
+ * onto the steps in reverse order
+ */
+void buildStatement(astNode* node, vector<buildStep>& steps) {
+    assert(node != NULL);
+
     assert(node->type == ast_stmt);
     switch(node->stmt.type) {
 
@@ -163,7 +325,7 @@ void traverseAST(astNode* node) {
         case(ast_call): {
             assert(node->stmt.call.name != NULL);
             // if a lone PRINT instruction, build it (READ handled in expressions)
-            if(strcmp(node->stmt.call.name, "print") == 0) {
+            if(node->stmt.call.id == id_print) {
                 assert(node->stmt.call.param != NULL);
                 LLVMValueRef args[] = { getLLVMExpression(node->stmt.call.param) };
                 LLVMBuildCall2(builder, printType, printFunc, args, 1, "");
@@ -173,14 +335,14 @@ void traverseAST(astNode* node) {
 
         case(ast_ret): {
             // build a new basic block for the return
-            LLVMBasicBlockRef assignRetVal_BB = LLVMAppendBasicBlock(func, "");
+            LLVMBasicBlockRef assignRetVal_BB = LLVMAppendBasicBlockInContext(context, func, "");
             LLVMBuildBr(builder, assignRetVal_BB); // branch to it
 
             // assign proper return value and branch to return block
             LLVMPositionBuilderAtEnd(builder, assignRetVal_BB);
             assert(node->stmt.ret.expr != NULL);
             LLVMValueRef expr = getLLVMExpression(node->stmt.ret.expr);
-            LLVMBuildStore(builder, expr, vars["return"]);
+            LLVMBuildStore(builder, expr, returnVar);
             LLVMBuildBr(builder, returnBlock);
 
             break;
@@ -188,9 +350,9 @@ void traverseAST(astNode* node) {
 
         case(ast_while): {
             // create basic blocks
-            LLVMBasicBlockRef condition_BB = LLVMAppendBasicBlock(func, "");
-            LLVMBasicBlockRef body_BB = LLVMAppendBasicBlock(func, "");
-            LLVMBasicBlockRef final = LLVMAppendBasicBlock(func, "");
+            LLVMBasicBlockRef condition_BB = LLVMAppendBasicBlockInContext(context, func, "");
+            LLVMBasicBlockRef body_BB = LLVMAppendBasicBlockInContext(context, func, "");
+            LLVMBasicBlockRef final = LLVMAppendBasicBlockInContext(context, func, "");
 
             // build branch to condition
             LLVMBuildBr(builder, condition_BB);
@@ -201,12 +363,12 @@ void traverseAST(astNode* node) {
             LLVMValueRef condition = getLLVMCondition(node->stmt.whilen.cond);
             LLVMBuildCondBr(builder, condition, body_BB, final);
 
+            // build the body, then branch back to the condition and continue in the final block
             LLVMPositionBuilderAtEnd(builder, body_BB);
             assert(node->stmt.whilen.body != NULL);
-            traverseAST(node->stmt.whilen.body);
-            LLVMBuildBr(builder, condition_BB);
-
-            LLVMPositionBuilderAtEnd(builder, final);
+            steps.push_back({ build_position, NULL, final });
+            steps.push_back({ build_branch, NULL, condition_BB });
+            steps.push_back({ build_stmt, node->stmt.whilen.body, NULL });
 
             break;
         }
@@ -215,9 +377,9 @@ void traverseAST(astNode* node) {
             // if body
             if(node->stmt.ifn.else_body != NULL) {
                 // create basic blocks
-                LLVMBasicBlockRef if_BB = LLVMAppendBasicBlock(func, "");
-                LLVMBasicBlockRef else_BB = LLVMAppendBasicBlock(func, "");
-                LLVMBasicBlockRef final = LLVMAppendBasicBlock(func, "");
+                LLVMBasicBlockRef if_BB = LLVMAppendBasicBlockInContext(context, func, "");
+                LLVMBasicBlockRef else_BB = LLVMAppendBasicBlockInContext(context, func, "");
+                LLVMBasicBlockRef final = LLVMAppendBasicBlockInContext(context, func, "");
 
                 // create condition
                 assert(node->stmt.ifn.cond != NULL);
@@ -227,20 +389,18 @@ void traverseAST(astNode* node) {
                 // traverse through bodies of if, else, and final block
                 LLVMPositionBuilderAtEnd(builder, if_BB);
                 assert(node->stmt.ifn.if_body != NULL);
-                traverseAST(node->stmt.ifn.if_body);
-                LLVMBuildBr(builder, final);
-
-                LLVMPositionBuilderAtEnd(builder, else_BB);
-                traverseAST(node->stmt.ifn.else_body);
-                LLVMBuildBr(builder, final);
-
-                LLVMPositionBuilderAtEnd(builder, final);
+                steps.push_back({ build_position, NULL, final });
+                steps.push_back({ build_branch, NULL, final });
+                steps.push_back({ build_stmt, node->stmt.ifn.else_body, NULL });
+                steps.push_back({ build_position, NULL, else_BB });
+                steps.push_back({ build_branch, NULL, final });
+                steps.push_back({ build_stmt, node->stmt.ifn.if_body, NULL });
 
             // if-else body
             } else {
                 // create basic blocks
-                LLVMBasicBlockRef if_BB = LLVMAppendBasicBlock(func, "");
-                LLVMBasicBlockRef final = LLVMAppendBasicBlock(func, "");
+                LLVMBasicBlockRef if_BB = LLVMAppendBasicBlockInContext(context, func, "");
+                LLVMBasicBlockRef final = LLVMAppendBasicBlockInContext(context, func, "");
 
                 // create condition
                 assert(node->stmt.ifn.cond != NULL);
@@ -250,10 +410,9 @@ void traverseAST(astNode* node) {
                 // traverse through bodies of if, and final block
                 LLVMPositionBuilderAtEnd(builder, if_BB);
                 assert(node->stmt.ifn.if_body != NULL);
-                traverseAST(node->stmt.ifn.if_body);
-                LLVMBuildBr(builder, final);
-
-                LLVMPositionBuilderAtEnd(builder, final);
+                steps.push_back({ build_position, NULL, final });
+                steps.push_back({ build_branch, NULL, final });
+                steps.push_back({ build_stmt, node->stmt.ifn.if_body, NULL });
             }
             break;
         }
@@ -264,18 +423,18 @@ void traverseAST(astNode* node) {
             LLVMValueRef rhs = getLLVMExpression(node->stmt.asgn.rhs);
             assert(node->stmt.asgn.lhs != NULL);
             assert(node->stmt.asgn.lhs->var.name != NULL);
-            LLVMBuildStore(builder, rhs, vars[string(node->stmt.asgn.lhs->var.name)]);
+            LLVMBuildStore(builder, rhs, vars[node->stmt.asgn.lhs->var.slot]);
             break;
         }
 
         case(ast_block): {
-            // loop through all statements and handle accordingly
+            // push all statements, the last first, so they are built in order
             assert(node->stmt.block.stmt_list != NULL);
-            vector<astNode*>* slist = node->stmt.block.stmt_list;
-            vector<astNode*>::iterator it = slist->begin();
-            while(it != slist->end()) {
+            astNodeList* slist = node->stmt.block.stmt_list;
+            astNodeList::reverse_iterator it = slist->rbegin();
+            while(it != slist->rend()) {
                 assert(*it != NULL);
-                traverseAST(*it);
+                steps.push_back({ build_stmt, *it, NULL });
                 it++;
             }
             break;
@@ -287,26 +446,28 @@ void traverseAST(astNode* node) {
 
 /* performs an initial traversal of the tree to get all declarations
  * so they can be allocated at the beginning of the function
+ * the statements still to visit are kept on a heap stack rather than the native one
  */
 void getDeclarations(astNode* node) {
     assert(node != NULL);
 
-    // loop through statements and handle them
-    vector<astNode*>* slist = node->stmt.block.stmt_list;
-    vector<astNode*>::iterator it = slist->begin();
-    while(it != slist->end()) {
-        assert(*it != NULL);
-        astNode* node = (astNode*) *it;
-        handleStatements_decs(node);        
-        it++;
+    vector<astNode*> pending;
+    pending.push_back(node);
+
+    // handle statements in the order they appear in the source
+    while(!pending.empty()) {
+        astNode* next = pending.back();
+        pending.pop_back();
+        handleStatements_decs(next, pending);
     }
 
 }
 
 /* a helper method that handles statements in the initial traversal, 
  * creating value refs for them when declarations are reached
+ * and pushing the statements nested in them to be handled next
  */
-void handleStatements_decs(astNode* node) {
+void handleStatements_decs(astNode* node, vector<astNode*>& pending) {
     assert(node != NULL);
     
     // traverse through all locations there could be declarations
@@ -314,38 +475,38 @@ void handleStatements_decs(astNode* node) {
     switch(node->stmt.type) {
             
             case(ast_block): {
-                getDeclarations(node);
+                // push statements, the last first
+                astNodeList* slist = node->stmt.block.stmt_list;
+                astNodeList::reverse_iterator it = slist->rbegin();
+                while(it != slist->rend()) {
+                    assert(*it != NULL);
+                    pending.push_back(*it);
+                    it++;
+                }
                 break;
             }
 
             case(ast_if): {
                 // handle if and else bodies
-                assert(node->stmt.ifn.if_body != NULL);
-                handleStatements_decs(node->stmt.ifn.if_body);
                 if(node->stmt.ifn.else_body != NULL) {
-                    handleStatements_decs(node->stmt.ifn.else_body);
+                    pending.push_back(node->stmt.ifn.else_body);
                 }
+                assert(node->stmt.ifn.if_body != NULL);
+                pending.push_back(node->stmt.ifn.if_body);
                 break;
             }
 
             case(ast_while): {
                 assert(node->stmt.whilen.body != NULL);
-                handleStatements_decs(node->stmt.whilen.body);
+                pending.push_back(node->stmt.whilen.body);
                 break;
             }
 
             case(ast_decl): {
-                // if the variable has already been allocated, do not reallocate
-                assert(node->stmt.decl.name != NULL);
-                if(vars.count(node->stmt.decl.name)) {
-                    break;
-                }
-
-                // allocate the variable and add it to the map of variables
+                // allocate the variable and add it to the map of variables, 
+                // every declaration has a slot of its own even if it shadows another
                 assert(node->stmt.decl.name != NULL);
-                LLVMValueRef var = LLVMBuildAlloca(builder, LLVMInt32Type(), node->stmt.decl.name);
-                LLVMSetAlignment(var, 4);
-                vars[string(node->stmt.decl.name)] = var;
+                allocateVariable(node->stmt.decl.slot, node->stmt.decl.id);
                 break;
             }
 
@@ -467,7 +628,7 @@ LLVMValueRef getLLVMExpression(astNode* node) {
             assert(node->uexpr.expr != NULL);
             if(node->uexpr.expr->type == ast_var) {
                 LLVMValueRef term = getTerm(node->uexpr.expr, false);
-                LLVMValueRef neg1 = LLVMConstInt(LLVMInt32Type(), -1, false);
+                LLVMValueRef neg1 = LLVMConstInt(LLVMInt32TypeInContext(context), -1, false);
                 expr = LLVMBuildMul(builder, term, neg1, "");
             } else {
                 // otherwise just set the term as negative
@@ -479,11 +640,11 @@ LLVMValueRef getLLVMExpression(astNode* node) {
         case(ast_stmt): { // if statement, must be an extern call
             assert(node->stmt.type == ast_call);
             assert(node->stmt.call.name != NULL);
-            if(strcmp(node->stmt.call.name, "read") == 0) {
+            if(node->stmt.call.id == id_read) {
                 LLVMValueRef args[] = {};
                 expr = LLVMBuildCall2(builder, readType, readFunc, args, 0, "");
             } else {
-                expr = LLVMConstInt(LLVMInt32Type(), 1, false);
+                expr = LLVMConstInt(LLVMInt32TypeInContext(context), 1, false);
             }
             break;
         }
@@ -505,226 +666,1268 @@ LLVMValueRef getLLVMExpression(astNode* node) {
 LLVMValueRef getTerm(astNode* node, bool negative) {
     assert(node != NULL);
 
-    if(node->type == ast_var) { // variable - load
+    if(node->type == ast_var) { // variable - load, or its current value in an SSA build
         assert(node->var.name != NULL);
-        return LLVMBuildLoad2(builder, LLVMInt32Type(), vars[node->var.name], "");
+        if(buildSSA) {
+            return useVariable_ssa(node->var.slot);
+        }
+        return LLVMBuildLoad2(builder, LLVMInt32TypeInContext(context), vars[node->var.slot], "");
     } else { // constant
         assert(node->type == ast_cnst);
         if(negative) {
-            return LLVMConstInt(LLVMInt32Type(), -1 * node->cnst.value, false);
+            return LLVMConstInt(LLVMInt32TypeInContext(context), -1 * node->cnst.value, false);
         } else {
-            return LLVMConstInt(LLVMInt32Type(), node->cnst.value, false);
+            return LLVMConstInt(LLVMInt32TypeInContext(context), node->cnst.value, false);
         }
     }
 }
 
 
-/* OPTIMIZATION FUNCTIONS */
-/* ---------------------- */
-
-/* optimizes the basic block from the generator */
-void optimizeLLVMBasicBlocks(LLVMModuleRef mod) {
-    
-    // loop through the functions and optimize
-    for(LLVMValueRef function =  LLVMGetFirstFunction(mod); 
-        function; 
-        function = LLVMGetNextFunction(function)) {
 
-        deadTerminatorElimination(function);
+/* FUSED BUILD METHODS */
+/* ------------------- */
 
-        array<unordered_map<LLVMBasicBlockRef, set<LLVMBasicBlockRef>>, 2> graphs = generateGraphs(function);
-        bbOutGraph = graphs[0];
-        bbInGraph = graphs[1];
+/* builds the same module as createLLVMModelFromASTInContext in one traversal of an unchecked tree,
+ * running the checks of semanticAnalysis_opt on each statement before building it
+ * and allocating each declaration as it is reached, instead of walking the tree
+ * once to check it, once for its declarations and once to build it
+ * returns NULL, having printed the same errors as semanticAnalysis_opt, if the checks fail
+ */
+LLVMModuleRef createLLVMModelFromAST_fused(astNode* root, char* filename, LLVMContextRef llvmContext) {
+    assert(root != NULL);
+    assert(llvmContext != NULL);
+    context = llvmContext;
+
+    // create the module, externs and function
+    assert(root->prog.ext1 != NULL && root->prog.ext2 != NULL);
+    assert(root->prog.func != NULL && root->prog.func->func.body != NULL);
+    astNode* param = root->prog.func->func.param;
+    LLVMModuleRef mod = buildModuleShell(filename, root->prog.ext1->ext.id, root->prog.ext2->ext.id,
+        root->prog.func->func.id, param != NULL, false);
+    entryBuilder = LLVMCreateBuilderInContext(context);
+    lastAllocation = returnVar;
+
+    // open the function's scope with the parameter in it
+    symbolTable* symbols = semanticSymbols();
+    openScope(symbols);
+    startFunction(symbols);
+    if(param != NULL) {
+        assert(param->var.name != NULL);
+        param->var.slot = declareSymbol(symbols, param->var.id);
+        LLVMValueRef paramVar = allocateVariable_fused(param->var.slot, param->var.id);
+        LLVMBuildStore(builder, LLVMGetParam(func, 0), paramVar);
+    }
 
-        deadBlockElimination(function);
-        mergeLinearBlocks(function);
+    // check and build the body
+    bool valid = traverseAST_fused(root->prog.func->func.body);
+    closeScope(symbols);
+    LLVMDisposeBuilder(entryBuilder);
+    LLVMDisposeBuilder(builder);
 
+    // the module is discarded if any check failed
+    if(!valid) {
+        LLVMDisposeModule(mod);
+        return NULL;
     }
+
+    LLVMMoveBasicBlockAfter(returnBlock, LLVMGetLastBasicBlock(func));
+    return mod;
 }
 
-/* runs through all of the basic blocks
- * once a terminator is reached, it deletes all instructions after that terminator
-*/
-void deadTerminatorElimination(LLVMValueRef function) {
-    assert(function != NULL);
+/* checks and builds the statements of an ast like traverseAST, closing each block's scope after it
+ * once a check fails nothing more is built, and the rest of the tree is only checked
+ * so that every error is still reported
+ * returns false if any check failed
+ */
+bool traverseAST_fused(astNode* node) {
+    assert(node != NULL);
 
-    vector<LLVMValueRef> instructionsToErase; // instructions to erase
+    bool valid = true;
+    vector<buildStep> steps;
+    steps.push_back({ build_stmt, node, NULL });
 
-    for(LLVMBasicBlockRef bb = LLVMGetFirstBasicBlock(function);
-        bb;
-        bb = LLVMGetNextBasicBlock(bb)) {
+    while(!steps.empty()) {
+        buildStep step = steps.back();
+        steps.pop_back();
 
-        bool terminatorReached = false;
-        // walk instructions
-        for (LLVMValueRef instruction = LLVMGetFirstInstruction(bb); 
-            instruction;
-            instruction = LLVMGetNextInstruction(instruction)) {
+        switch(step.action) {
+            case(build_stmt): {
+                if(valid) {
+                    valid = buildStatement_fused(step.node, steps);
+                } else {
+                    semanticAnalysis_opt(step.node);
+                }
+                break;
+            }
 
-            // if we have hit a branch or return, delete deadcode
-            if(terminatorReached) {
-                instructionsToErase.push_back(instruction);
+            case(build_branch): {
+                if(valid) {
+                    LLVMBuildBr(builder, step.block);
+                }
+                break;
             }
 
-            // if we have a branch or return, enable flag to delete deadcode
-            if(LLVMIsATerminatorInst(instruction)) {
-                terminatorReached = true;
+            case(build_position): {
+                if(valid) {
+                    LLVMPositionBuilderAtEnd(builder, step.block);
+                }
+                break;
             }
-        }
 
-        // special case where no instructions in a block - add a return 0
-        if(!LLVMGetFirstInstruction(bb)) {
-            builder = LLVMCreateBuilder();
-            LLVMPositionBuilderAtEnd(builder, bb);
-            LLVMValueRef zero = LLVMConstInt(LLVMInt32Type(), 0, false);
-            LLVMBuildRet(builder, zero);
-            LLVMDisposeBuilder(builder);
+            case(build_close): {
+                closeScope(semanticSymbols());
+                break;
+            }
 
+            // blocks are only sealed by an SSA build
+            case(build_seal): {
+                assert(false && "a fused build never seals blocks");
+                break;
+            }
         }
     }
 
-    // delete the instructions
-    vector<LLVMValueRef>::iterator it = instructionsToErase.begin();
-    while(it != instructionsToErase.end()) {
-        assert(*it != NULL);
-        LLVMInstructionEraseFromParent(*it);
-        it++;
-    }
+    return valid;
 }
 
-/* runs through the blocks and finds the set of 'reachable' blocks
- * deletes all blocks present in the function that are not 'reachable'
-*/
-void deadBlockElimination(LLVMValueRef function) {
-    assert(function != NULL);
+/* checks a single statement, then builds it with buildStatement
+ * declarations are allocated instead, and blocks open a scope that is closed once their statements are built
+ * if a check fails, the statement's bodies are pushed to be checked without building anything
+ */
+bool buildStatement_fused(astNode* node, vector<buildStep>& steps) {
+    assert(node != NULL);
 
-    vector<LLVMBasicBlockRef> blocksToDelete; // basic blocks to eventually delete
-    set<LLVMBasicBlockRef> visitedBlocks; // all 'reachable' blocks
-    deque<LLVMBasicBlockRef> queue; // queue for BFS
+    bool valid = true;
+    assert(node->type == ast_stmt);
+    switch(node->stmt.type) {
+
+        case(ast_decl): {
+            // every declaration has a slot of its own even if it shadows another
+            if(!checkDeclaration(node)) {
+                return false;
+            }
+            allocateVariable_fused(node->stmt.decl.slot, node->stmt.decl.id);
+            return true;
+        }
 
-    // initialize queue
-    if(!LLVMGetFirstBasicBlock(function)) return;
-    queue.push_back(LLVMGetEntryBasicBlock(function));
+        case(ast_call): {
+            if(node->stmt.call.param != NULL) {
+                valid &= checkExpression(node->stmt.call.param);
+            }
+            break;
+        }
 
-    // bfs
-    while(queue.size() != 0) {
-        LLVMBasicBlockRef block = queue.back();
-        queue.pop_back();
-        visitedBlocks.insert(block);
+        case(ast_ret): {
+            assert(node->stmt.ret.expr != NULL);
+            valid &= checkExpression(node->stmt.ret.expr);
+            break;
+        }
 
-        if(bbOutGraph.count(block) == 0) continue;
+        case(ast_while): {
+            assert(node->stmt.whilen.cond != NULL);
+            if(!checkExpression(node->stmt.whilen.cond)) {
+                assert(node->stmt.whilen.body != NULL);
+                steps.push_back({ build_stmt, node->stmt.whilen.body, NULL });
+                return false;
+            }
+            break;
+        }
 
-        // loop through successors
-        set<LLVMBasicBlockRef> successors = bbOutGraph[block];
-        set<LLVMBasicBlockRef>::iterator it = successors.begin();
-        while(it != successors.end()) {
-            LLVMBasicBlockRef successor = *it;
-            if(visitedBlocks.count(successor) == 0) {
-                queue.push_back(successor);
+        case(ast_if): {
+            assert(node->stmt.ifn.cond != NULL);
+            if(!checkExpression(node->stmt.ifn.cond)) {
+                if(node->stmt.ifn.else_body != NULL) {
+                    steps.push_back({ build_stmt, node->stmt.ifn.else_body, NULL });
+                }
+                assert(node->stmt.ifn.if_body != NULL);
+                steps.push_back({ build_stmt, node->stmt.ifn.if_body, NULL });
+                return false;
             }
+            break;
+        }
 
-            it++;
+        case(ast_asgn): {
+            // the variable assigned is checked before the expression, as in semanticAnalysis_opt
+            assert(node->stmt.asgn.lhs != NULL && node->stmt.asgn.rhs != NULL);
+            valid &= checkVariable(node->stmt.asgn.lhs);
+            valid &= checkExpression(node->stmt.asgn.rhs);
+            break;
         }
-    }
 
-    // build list of unvisited blocks or blocks with no instructions
-    for(LLVMBasicBlockRef bb = LLVMGetFirstBasicBlock(function); 
-        bb; 
-        bb = LLVMGetNextBasicBlock(bb)) {
-        
-        if(visitedBlocks.count(bb) == 0) {
-            blocksToDelete.push_back(bb);
+        case(ast_block): {
+            openScope(semanticSymbols());
+            steps.push_back({ build_close, NULL, NULL });
+            break;
         }
 
     }
 
-    deleteBasicBlocks(blocksToDelete);
+    if(valid) {
+        buildStatement(node, steps);
+    }
+    return valid;
 }
 
-/* merges two blocks if they are both their unique successor and predecessor */
-void mergeLinearBlocks(LLVMValueRef function) {
-    assert(function != NULL);
-
-    vector<LLVMBasicBlockRef> blocksToDelete;
+/* allocates a variable in the first block, after the allocations made before it,
+ * so the allocations end up in the same order as those of getDeclarations
+ */
+LLVMValueRef allocateVariable_fused(int slot, int id) {
+    LLVMValueRef next = LLVMGetNextInstruction(lastAllocation);
+    if(next != NULL) {
+        LLVMPositionBuilderBefore(entryBuilder, next);
+    } else {
+        LLVMPositionBuilderAtEnd(entryBuilder, LLVMGetInstructionParent(lastAllocation));
+    }
 
-    // loop through all of the basic blocks
-    
-    LLVMBasicBlockRef nextBlock;
-    for(LLVMBasicBlockRef bb = LLVMGetFirstBasicBlock(function);
-        bb;
-        bb = nextBlock) {
-        
-        nextBlock = bb;
-        
-        // skip bbs without successors
-        if(bbOutGraph.count(bb) == 0) {
-            nextBlock = LLVMGetNextBasicBlock(bb);
-            continue;
-        }
+    // allocateVariable builds at the position of the builder
+    LLVMBuilderRef bodyBuilder = builder;
+    builder = entryBuilder;
+    lastAllocation = allocateVariable(slot, id);
+    builder = bodyBuilder;
+    return lastAllocation;
+}
 
-        set<LLVMBasicBlockRef> successors = bbOutGraph[bb];
 
-        // skip bbs with more than one successor
-        if(successors.size() != 1) {
-            nextBlock = LLVMGetNextBasicBlock(bb);
-            continue;
-        }
 
-        LLVMBasicBlockRef successor = *(successors.begin());
-        assert(bbInGraph.count(successor) != 0);
+/* FLAT AST BUILD METHODS */
+/* ---------------------- */
 
-        // skip bbs whose successor has more than one predecessor
-        if(bbInGraph[successor].size() != 1) {
-            nextBlock = LLVMGetNextBasicBlock(bb);
-            continue;
-        }
+/* builds the same module as createLLVMModelFromASTInContext from a flat AST,
+ * walking its arrays instead of chasing the tree's pointers
+ */
+LLVMModuleRef createLLVMModelFromFlatAST(flatAST* ast, char* filename, LLVMContextRef llvmContext) {
+    assert(ast != NULL);
+    assert(llvmContext != NULL);
+    context = llvmContext;
+    flat = ast;
+
+    // create the module, externs and function
+    int32_t root = ast->root;
+    assert(ast->kinds[root] == flat_prog);
+    int32_t function = ast->third[root];
+    int32_t param = ast->second[function];
+    int32_t body = ast->third[function];
+    LLVMModuleRef mod = buildModuleShell(filename, ast->first[ast->first[root]], ast->first[ast->second[root]],
+        ast->first[function], param != FLAT_NONE, false);
 
-        // merge
-        mergeBlocks(bb, successor);
-        blocksToDelete.push_back(successor);
+    // allocate
+    if(param != FLAT_NONE) {
+        LLVMValueRef paramVar = allocateVariable(ast->second[param], ast->first[param]);
+        getDeclarations_flat(body);
+        LLVMBuildStore(builder, LLVMGetParam(func, 0), paramVar);
+    } else {
+        getDeclarations_flat(body);
+    }
 
-        // update graph
-        bbOutGraph[bb].clear();
-        
-        set<LLVMBasicBlockRef> nextSuccessors = bbOutGraph[successor];
-        set<LLVMBasicBlockRef>::iterator it = nextSuccessors.begin();
-        while(it != nextSuccessors.end()) {
-            bbOutGraph[bb].insert(*it);
-            bbInGraph[*it].erase(successor);
-            bbInGraph[*it].insert(bb);
-            it++; 
-        }
+    // traverse the ast
+    traverseAST_flat(body);
+    LLVMDisposeBuilder(builder);
 
-        bbOutGraph.erase(successor);
-        bbInGraph.erase(successor);
-    }
+    LLVMMoveBasicBlockAfter(returnBlock, LLVMGetLastBasicBlock(func));
+    flat = NULL;
 
-    deleteBasicBlocks(blocksToDelete);
+    return mod;
 }
 
-/* merges two blocks together */
-void mergeBlocks(LLVMBasicBlockRef first, LLVMBasicBlockRef second) {
+/* traverses the statements of a flat ast and 
+ * builds the basic blocks accordingly
+ * the work left after a statement's children is kept as steps on a heap stack, as in traverseAST
+ */
+void traverseAST_flat(int32_t node) {
+    assert(node != FLAT_NONE);
 
-    // delete all of the br instructions from the end of the first block
-    vector<LLVMValueRef> instructionsToDelete;
-    for(LLVMValueRef instruction = LLVMGetFirstInstruction(first);
-        instruction;
-        instruction = LLVMGetNextInstruction(instruction)) {
+    vector<flatStep> steps;
+    steps.push_back({ build_stmt, node, NULL });
 
-        if(LLVMGetInstructionOpcode(instruction) == LLVMBr) { // if br, add to list of instructions to delete
-            instructionsToDelete.push_back(instruction);
+    while(!steps.empty()) {
+        flatStep step = steps.back();
+        steps.pop_back();
+
+        switch(step.action) {
+            case(build_stmt): {
+                buildStatement_flat(step.node, steps);
+                break;
+            }
+
+            case(build_branch): {
+                LLVMBuildBr(builder, step.block);
+                break;
+            }
+
+            case(build_position): {
+                LLVMPositionBuilderAtEnd(builder, step.block);
+                break;
+            }
+
+            // scopes and sealing are not tracked by a flat build
+            default:
+                break;
         }
     }
+}
 
-    // delete
-    vector<LLVMValueRef>::iterator it = instructionsToDelete.begin();
-    while(it != instructionsToDelete.end()) {
-        assert(*it != NULL);
-        LLVMInstructionRemoveFromParent(*it);
-        it++;
-    }
+/* builds a single statement of a flat ast, pushing its bodies and whatever follows them
+ * onto the steps in reverse order
+ */
+void buildStatement_flat(int32_t node, vector<flatStep>& steps) {
+    assert(node != FLAT_NONE);
+
+    switch(flat->kinds[node]) {
+
+        case(flat_call): {
+            // if a lone PRINT instruction, build it (READ handled in expressions)
+            if(flat->first[node] == id_print) {
+                assert(flat->second[node] != FLAT_NONE);
+                LLVMValueRef args[] = { getLLVMExpression_flat(flat->second[node]) };
+                LLVMBuildCall2(builder, printType, printFunc, args, 1, "");
+            }
+            break;
+        }
+
+        case(flat_ret): {
+            // build a new basic block for the return
+            LLVMBasicBlockRef assignRetVal_BB = LLVMAppendBasicBlockInContext(context, func, "");
+            LLVMBuildBr(builder, assignRetVal_BB);
+
+            // assign proper return value and branch to return block
+            LLVMPositionBuilderAtEnd(builder, assignRetVal_BB);
+            LLVMValueRef expr = getLLVMExpression_flat(flat->first[node]);
+            LLVMBuildStore(builder, expr, returnVar);
+            LLVMBuildBr(builder, returnBlock);
+            break;
+        }
+
+        case(flat_while): {
+            // create basic blocks
+            LLVMBasicBlockRef condition_BB = LLVMAppendBasicBlockInContext(context, func, "");
+            LLVMBasicBlockRef body_BB = LLVMAppendBasicBlockInContext(context, func, "");
+            LLVMBasicBlockRef final = LLVMAppendBasicBlockInContext(context, func, "");
+
+            // create condition and looping structure
+            LLVMBuildBr(builder, condition_BB);
+            LLVMPositionBuilderAtEnd(builder, condition_BB);
+            LLVMValueRef condition = getLLVMCondition_flat(flat->first[node]);
+            LLVMBuildCondBr(builder, condition, body_BB, final);
+
+            // build the body, then branch back to the condition and continue in the final block
+            LLVMPositionBuilderAtEnd(builder, body_BB);
+            steps.push_back({ build_position, FLAT_NONE, final });
+            steps.push_back({ build_branch, FLAT_NONE, condition_BB });
+            steps.push_back({ build_stmt, flat->second[node], NULL });
+            break;
+        }
+
+        case(flat_if): {
+            // the blocks are appended in the same order as the tree builder's
+            LLVMBasicBlockRef if_BB = LLVMAppendBasicBlockInContext(context, func, "");
+            LLVMBasicBlockRef else_BB = NULL;
+            if(flat->third[node] != FLAT_NONE) {
+                else_BB = LLVMAppendBasicBlockInContext(context, func, "");
+            }
+            LLVMBasicBlockRef final = LLVMAppendBasicBlockInContext(context, func, "");
+
+            // create condition
+            LLVMValueRef condition = getLLVMCondition_flat(flat->first[node]);
+            LLVMBuildCondBr(builder, condition, if_BB, (else_BB != NULL) ? else_BB : final);
+
+            // traverse through bodies of if, else, and final block
+            LLVMPositionBuilderAtEnd(builder, if_BB);
+            steps.push_back({ build_position, FLAT_NONE, final });
+            if(else_BB != NULL) {
+                steps.push_back({ build_branch, FLAT_NONE, final });
+                steps.push_back({ build_stmt, flat->third[node], NULL });
+                steps.push_back({ build_position, FLAT_NONE, else_BB });
+            }
+            steps.push_back({ build_branch, FLAT_NONE, final });
+            steps.push_back({ build_stmt, flat->second[node], NULL });
+            break;
+        }
+
+        case(flat_asgn): {
+            // create an instruction for the given assignment statement
+            LLVMValueRef rhs = getLLVMExpression_flat(flat->second[node]);
+            LLVMBuildStore(builder, rhs, vars[flat->second[flat->first[node]]]);
+            break;
+        }
+
+        case(flat_block): {
+            // the statements of a block are next to each other in children, push the last first
+            const int32_t* begin = flat->children + flat->first[node];
+            const int32_t* stmt = begin + flat->second[node];
+            while(stmt != begin) {
+                stmt--;
+                steps.push_back({ build_stmt, *stmt, NULL });
+            }
+            break;
+        }
+
+        default: // declarations already handled before calling the method
+            break;
+    }
+}
+
+/* allocates every variable declared under the given statement of a flat ast, 
+ * in the same order as getDeclarations, keeping the statements still to visit on a heap stack
+ */
+void getDeclarations_flat(int32_t node) {
+    assert(node != FLAT_NONE);
+
+    vector<int32_t> pending;
+    pending.push_back(node);
+
+    while(!pending.empty()) {
+        int32_t next = pending.back();
+        pending.pop_back();
+
+        switch(flat->kinds[next]) {
+
+            case(flat_block): {
+                // push statements, the last first
+                const int32_t* begin = flat->children + flat->first[next];
+                const int32_t* stmt = begin + flat->second[next];
+                while(stmt != begin) {
+                    stmt--;
+                    pending.push_back(*stmt);
+                }
+                break;
+            }
+
+            case(flat_if): {
+                // handle if and else bodies
+                if(flat->third[next] != FLAT_NONE) {
+                    pending.push_back(flat->third[next]);
+                }
+                pending.push_back(flat->second[next]);
+                break;
+            }
+
+            case(flat_while): {
+                pending.push_back(flat->second[next]);
+                break;
+            }
+
+            case(flat_decl): {
+                allocateVariable(flat->second[next], flat->first[next]);
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+}
+
+/* builds a condition of a flat ast and returns a value ref that corresponds
+ * to said condition
+ */
+LLVMValueRef getLLVMCondition_flat(int32_t node) {
+    assert(flat->kinds[node] == flat_rexpr);
+
+    // build the left and right hand side
+    LLVMValueRef lhs = getTerm_flat(flat->first[node], false);
+    LLVMValueRef rhs = getTerm_flat(flat->second[node], false);
+
+    // set the appropriate condition by operation
+    LLVMIntPredicate predicate;
+    switch(flat->ops[node]) {
+        case(lt): { predicate = LLVMIntSLT; break; }
+        case(gt): { predicate = LLVMIntSGT; break; }
+        case(le): { predicate = LLVMIntSLE; break; }
+        case(ge): { predicate = LLVMIntSGE; break; }
+        case(eq): { predicate = LLVMIntEQ; break; }
+        default: { predicate = LLVMIntNE; break; }
+    }
+
+    return LLVMBuildICmp(builder, predicate, lhs, rhs, "");
+}
+
+/* builds an expression of a flat ast and returns a value ref that corresponds
+ * to said expression
+ */
+LLVMValueRef getLLVMExpression_flat(int32_t node) {
+    assert(node != FLAT_NONE);
+
+    switch(flat->kinds[node]) {
+
+        case(flat_var):
+        case(flat_cnst):
+            return getTerm_flat(node, false);
+
+        case(flat_bexpr): {
+            // build the left and right hand side
+            LLVMValueRef lhs = getTerm_flat(flat->first[node], false);
+            LLVMValueRef rhs = getTerm_flat(flat->second[node], false);
+
+            // build the arithmetic operator
+            switch(flat->ops[node]) {
+                case(add): return LLVMBuildAdd(builder, lhs, rhs, "");
+                case(sub): return LLVMBuildSub(builder, lhs, rhs, "");
+                case(divide): return LLVMBuildSDiv(builder, lhs, rhs, "");
+                case(mul): return LLVMBuildMul(builder, lhs, rhs, "");
+                default: return NULL;
+            }
+        }
+
+        case(flat_uexpr): {
+            // if the uexpr is operating on a variable, multiply the variable by -1
+            int32_t expr = flat->first[node];
+            if(flat->kinds[expr] == flat_var) {
+                LLVMValueRef term = getTerm_flat(expr, false);
+                LLVMValueRef neg1 = LLVMConstInt(LLVMInt32TypeInContext(context), -1, false);
+                return LLVMBuildMul(builder, term, neg1, "");
+            }
+            // otherwise just set the term as negative
+            return getTerm_flat(expr, true);
+        }
+
+        case(flat_call): { // must be an extern call
+            if(flat->first[node] == id_read) {
+                LLVMValueRef args[] = {};
+                return LLVMBuildCall2(builder, readType, readFunc, args, 0, "");
+            }
+            return LLVMConstInt(LLVMInt32TypeInContext(context), 1, false);
+        }
+
+        default:
+            return NULL;
+    }
+}
+
+/* gets a term of a flat ast as a value ref
+ * will be either a constint or retrieving a variable using a load
+ */
+LLVMValueRef getTerm_flat(int32_t node, bool negative) {
+    if(flat->kinds[node] == flat_var) { // variable - load
+        return LLVMBuildLoad2(builder, LLVMInt32TypeInContext(context), vars[flat->second[node]], "");
+    }
+
+    // constant
+    assert(flat->kinds[node] == flat_cnst);
+    int value = negative ? -1 * flat->first[node] : flat->first[node];
+    return LLVMConstInt(LLVMInt32TypeInContext(context), value, false);
+}
+
+/* SSA BUILD METHODS */
+/* ----------------- */
+
+/* builds the function of a checked tree straight into SSA form, as in Braun et al.'s
+ * "Simple and Efficient Construction of Static Single Assignment Form": instead of
+ * allocating each variable and loading and storing it, an assignment records the value
+ * as the variable's current definition in its block, and a read looks the definition up
+ * through the predecessors, adding a phi where several of them meet
+ * a block is sealed once all of its predecessors are built, only then are the operands
+ * of the phis read in it before added, and phis that turn out to choose a single value are removed
+ * lookups in sealed blocks only add a phi where the predecessors' values differ or a loop
+ * leads back to the block (the paper's marker algorithm), rather than adding one and removing it
+ * statements after a return, which no path reaches, are not built
+ */
+LLVMModuleRef createLLVMModelFromAST_ssa(astNode* root, char* filename, LLVMContextRef llvmContext) {
+    assert(root != NULL);
+    assert(llvmContext != NULL);
+    context = llvmContext;
+
+    // create the module, externs and function
+    assert(root->prog.ext1 != NULL && root->prog.ext2 != NULL);
+    assert(root->prog.func != NULL && root->prog.func->func.body != NULL);
+    astNode* param = root->prog.func->func.param;
+    LLVMModuleRef mod = buildModuleShell(filename, root->prog.ext1->ext.id, root->prog.ext2->ext.id,
+        root->prog.func->func.id, param != NULL, true);
+
+    // forget the blocks of any previously built module
+    ssaBlocks.clear();
+    ssaDefs.clear();
+    unfilledPhis.clear();
+    replacedPhis.clear();
+    loopAssignments.clear();
+    findLoopAssignments_ssa(root->prog.func->func.body);
+    phiBuilder = LLVMCreateBuilderInContext(context);
+    buildSSA = true;
+
+    // the entry has no predecessors, the parameter is its first definition
+    LLVMBasicBlockRef entry = LLVMGetEntryBasicBlock(func);
+    sealBlock_ssa(entry);
+    if(param != NULL) {
+        assert(param->var.slot >= 0); // set by semantic analysis
+        writeVariable_ssa(param->var.slot, entry, LLVMGetParam(func, 0));
+    }
+
+    // traverse the ast
+    traverseAST_ssa(root->prog.func->func.body);
+
+    // every return has been built, so the return block can read the return value
+    sealBlock_ssa(returnBlock);
+    LLVMPositionBuilderAtEnd(builder, returnBlock);
+    LLVMValueRef toReturn = useVariable_ssa(SSA_RETURN_SLOT);
+    LLVMBuildRet(builder, toReturn);
+    assert(unfilledPhis.empty());
+
+    // the trivial phis no longer have uses
+    for(unordered_map<LLVMValueRef, LLVMValueRef>::iterator it = replacedPhis.begin(); it != replacedPhis.end(); it++) {
+        LLVMInstructionEraseFromParent(it->first);
+    }
+    replacedPhis.clear();
+    loopAssignments.clear();
+    ssaBlocks.clear();
+    ssaDefs.clear();
+    buildSSA = false;
+    LLVMDisposeBuilder(phiBuilder);
+    LLVMDisposeBuilder(builder);
+
+    LLVMMoveBasicBlockAfter(returnBlock, LLVMGetLastBasicBlock(func));
+
+    return mod;
+}
+
+/* traverses the statements of an ast and builds their SSA form,
+ * skipping the statements of blocks no path reaches
+ */
+void traverseAST_ssa(astNode* node) {
+    assert(node != NULL);
+
+    vector<buildStep> steps;
+    steps.push_back({ build_stmt, node, NULL });
+
+    while(!steps.empty()) {
+        buildStep step = steps.back();
+        steps.pop_back();
+
+        switch(step.action) {
+            case(build_stmt): {
+                if(isLiveBlock_ssa(LLVMGetInsertBlock(builder))) {
+                    buildStatement_ssa(step.node, steps);
+                }
+                break;
+            }
+
+            case(build_branch): {
+                branch_ssa(step.block);
+                break;
+            }
+
+            // every block is positioned at once all of its predecessors are built
+            case(build_position): {
+                sealBlock_ssa(step.block);
+                LLVMPositionBuilderAtEnd(builder, step.block);
+                break;
+            }
+
+            case(build_seal): {
+                sealBlock_ssa(step.block);
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+}
+
+/* records the slots each while's body assigns (the return value included), so a loop's condition
+ * only gets phis for those before its body is built, the others keep their value from before the loop
+ * each body's slots are gathered once, from the assignments in it and the loops nested in it
+ */
+void findLoopAssignments_ssa(astNode* node) {
+    assert(node != NULL);
+
+    vector<pair<astNode*, bool>> stack; // node, and whether its statements have been visited
+    vector<vector<int>> open; // slots assigned so far in each while being visited, the innermost last
+    stack.push_back({ node, false });
+
+    while(!stack.empty()) {
+        astNode* stmt = stack.back().first;
+        bool visited = stack.back().second;
+        stack.pop_back();
+        assert(stmt != NULL && stmt->type == ast_stmt);
+
+        switch(stmt->stmt.type) {
+            case(ast_asgn):
+            case(ast_ret):
+                if(!open.empty()) {
+                    open.back().push_back((stmt->stmt.type == ast_asgn) ? stmt->stmt.asgn.lhs->var.slot : SSA_RETURN_SLOT);
+                }
+                break;
+
+            case(ast_while):
+                if(!visited) {
+                    open.push_back({});
+                    stack.push_back({ stmt, true });
+                    stack.push_back({ stmt->stmt.whilen.body, false });
+                } else {
+                    vector<int>& slots = loopAssignments[stmt];
+                    slots.swap(open.back());
+                    open.pop_back();
+                    sort(slots.begin(), slots.end());
+                    slots.erase(unique(slots.begin(), slots.end()), slots.end());
+                    if(!open.empty()) {
+                        open.back().insert(open.back().end(), slots.begin(), slots.end());
+                    }
+                }
+                break;
+
+            case(ast_if):
+                stack.push_back({ stmt->stmt.ifn.if_body, false });
+                if(stmt->stmt.ifn.else_body != NULL) {
+                    stack.push_back({ stmt->stmt.ifn.else_body, false });
+                }
+                break;
+
+            case(ast_block):
+                for(astNodeList::iterator it = stmt->stmt.block.stmt_list->begin(); it != stmt->stmt.block.stmt_list->end(); it++) {
+                    stack.push_back({ *it, false });
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+/* builds a single statement as buildStatement does, defining variables instead of storing them
+ * the blocks whose predecessors are all known when they are created are sealed at once,
+ * a loop's condition block only once the branch back to it from the end of the body is built
+ */
+void buildStatement_ssa(astNode* node, vector<buildStep>& steps) {
+    assert(node != NULL);
+
+    assert(node->type == ast_stmt);
+    switch(node->stmt.type) {
+
+        case(ast_decl): {
+            // a declaration only gives the variable a slot
+            break;
+        }
+
+        case(ast_call): {
+            assert(node->stmt.call.name != NULL);
+            if(node->stmt.call.id == id_print) {
+                assert(node->stmt.call.param != NULL);
+                LLVMValueRef args[] = { getLLVMExpression(node->stmt.call.param) };
+                LLVMBuildCall2(builder, printType, printFunc, args, 1, "");
+            }
+            break;
+        }
+
+        case(ast_ret): {
+            // define the return value in a block of its own and branch to the return block,
+            // leaving the builder in a terminated block so the statements after it are skipped
+            LLVMBasicBlockRef assignRetVal_BB = LLVMAppendBasicBlockInContext(context, func, "");
+            branch_ssa(assignRetVal_BB);
+            sealBlock_ssa(assignRetVal_BB);
+            LLVMPositionBuilderAtEnd(builder, assignRetVal_BB);
+            assert(node->stmt.ret.expr != NULL);
+            LLVMValueRef expr = getLLVMExpression(node->stmt.ret.expr);
+            writeVariable_ssa(SSA_RETURN_SLOT, assignRetVal_BB, expr);
+            branch_ssa(returnBlock);
+            break;
+        }
+
+        case(ast_while): {
+            LLVMBasicBlockRef condition_BB = LLVMAppendBasicBlockInContext(context, func, "");
+            LLVMBasicBlockRef body_BB = LLVMAppendBasicBlockInContext(context, func, "");
+            LLVMBasicBlockRef final = LLVMAppendBasicBlockInContext(context, func, "");
+
+            // the condition is reached from before the loop and from the end of the body, not built yet
+            branch_ssa(condition_BB);
+            blockState_ssa(condition_BB).assigned = &loopAssignments[node];
+            LLVMPositionBuilderAtEnd(builder, condition_BB);
+            assert(node->stmt.whilen.cond != NULL);
+            LLVMValueRef condition = getLLVMCondition(node->stmt.whilen.cond);
+            condBranch_ssa(condition, body_BB, final);
+
+            sealBlock_ssa(body_BB);
+            LLVMPositionBuilderAtEnd(builder, body_BB);
+            assert(node->stmt.whilen.body != NULL);
+            steps.push_back({ build_position, NULL, final });
+            steps.push_back({ build_seal, NULL, condition_BB });
+            steps.push_back({ build_branch, NULL, condition_BB });
+            steps.push_back({ build_stmt, node->stmt.whilen.body, NULL });
+            break;
+        }
+
+        case(ast_if): {
+            assert(node->stmt.ifn.cond != NULL);
+            assert(node->stmt.ifn.if_body != NULL);
+            if(node->stmt.ifn.else_body != NULL) {
+                LLVMBasicBlockRef if_BB = LLVMAppendBasicBlockInContext(context, func, "");
+                LLVMBasicBlockRef else_BB = LLVMAppendBasicBlockInContext(context, func, "");
+                LLVMBasicBlockRef final = LLVMAppendBasicBlockInContext(context, func, "");
+
+                LLVMValueRef condition = getLLVMCondition(node->stmt.ifn.cond);
+                condBranch_ssa(condition, if_BB, else_BB);
+
+                sealBlock_ssa(if_BB);
+                sealBlock_ssa(else_BB);
+                LLVMPositionBuilderAtEnd(builder, if_BB);
+                steps.push_back({ build_position, NULL, final });
+                steps.push_back({ build_branch, NULL, final });
+                steps.push_back({ build_stmt, node->stmt.ifn.else_body, NULL });
+                steps.push_back({ build_position, NULL, else_BB });
+                steps.push_back({ build_branch, NULL, final });
+                steps.push_back({ build_stmt, node->stmt.ifn.if_body, NULL });
+            } else {
+                LLVMBasicBlockRef if_BB = LLVMAppendBasicBlockInContext(context, func, "");
+                LLVMBasicBlockRef final = LLVMAppendBasicBlockInContext(context, func, "");
+
+                LLVMValueRef condition = getLLVMCondition(node->stmt.ifn.cond);
+                condBranch_ssa(condition, if_BB, final);
+
+                sealBlock_ssa(if_BB);
+                LLVMPositionBuilderAtEnd(builder, if_BB);
+                steps.push_back({ build_position, NULL, final });
+                steps.push_back({ build_branch, NULL, final });
+                steps.push_back({ build_stmt, node->stmt.ifn.if_body, NULL });
+            }
+            break;
+        }
+
+        case(ast_asgn): {
+            assert(node->stmt.asgn.rhs != NULL);
+            LLVMValueRef rhs = getLLVMExpression(node->stmt.asgn.rhs);
+            assert(node->stmt.asgn.lhs != NULL);
+            writeVariable_ssa(node->stmt.asgn.lhs->var.slot, LLVMGetInsertBlock(builder), rhs);
+            break;
+        }
+
+        case(ast_block): {
+            assert(node->stmt.block.stmt_list != NULL);
+            astNodeList* slist = node->stmt.block.stmt_list;
+            astNodeList::reverse_iterator it = slist->rbegin();
+            while(it != slist->rend()) {
+                assert(*it != NULL);
+                steps.push_back({ build_stmt, *it, NULL });
+                it++;
+            }
+            break;
+        }
+
+    }
+
+}
+
+/* returns what the build knows of the block, numbering it if it is new */
+ssaBlock& blockState_ssa(LLVMBasicBlockRef block) {
+    unordered_map<LLVMBasicBlockRef, ssaBlock>::iterator it = ssaBlocks.find(block);
+    if(it == ssaBlocks.end()) {
+        ssaBlock state = { (int) ssaBlocks.size(), {}, false, {}, false, NULL, NULL };
+        it = ssaBlocks.emplace(block, state).first;
+    }
+    return it->second;
+}
+
+/* checks if statements can still be built in a block: some path reaches it
+ * (it is the entry or a reached block branches to it) and it has not returned yet
+ */
+bool isLiveBlock_ssa(LLVMBasicBlockRef block) {
+    if(LLVMGetBasicBlockTerminator(block) != NULL) {
+        return false;
+    }
+    return block == LLVMGetEntryBasicBlock(func) || !blockState_ssa(block).preds.empty();
+}
+
+/* branches from the builder's block to the target, recording it as a predecessor,
+ * unless the block is not reached or has returned
+ */
+void branch_ssa(LLVMBasicBlockRef target) {
+    LLVMBasicBlockRef block = LLVMGetInsertBlock(builder);
+    if(!isLiveBlock_ssa(block)) {
+        return;
+    }
+    LLVMBuildBr(builder, target);
+    blockState_ssa(target).preds.push_back(block);
+}
+
+/* branches from the builder's block on the condition, recording it as a predecessor of both targets */
+void condBranch_ssa(LLVMValueRef condition, LLVMBasicBlockRef then, LLVMBasicBlockRef otherwise) {
+    LLVMBasicBlockRef block = LLVMGetInsertBlock(builder);
+    assert(isLiveBlock_ssa(block));
+    LLVMBuildCondBr(builder, condition, then, otherwise);
+    blockState_ssa(then).preds.push_back(block);
+    blockState_ssa(otherwise).preds.push_back(block);
+}
+
+/* marks that no more predecessors of the block will be built
+ * and adds the operands of the phis read in it so far, their slot's value in each predecessor,
+ * then removes those that turned out trivial
+ */
+void sealBlock_ssa(LLVMBasicBlockRef block) {
+    ssaBlock& state = blockState_ssa(block);
+    if(state.sealed) {
+        return;
+    }
+    state.sealed = true;
+    vector<pair<int, LLVMValueRef>> incomplete;
+    incomplete.swap(state.incompletePhis);
+    vector<LLVMBasicBlockRef> preds = state.preds;
+
+    vector<LLVMValueRef> filled;
+    for(size_t p = 0; p < incomplete.size(); p++) {
+        LLVMValueRef phi = incomplete[p].second;
+        for(size_t i = 0; i < preds.size(); i++) {
+            LLVMValueRef incoming = readVariable_ssa(incomplete[p].first, preds[i]);
+            LLVMBasicBlockRef pred = preds[i];
+            LLVMAddIncoming(phi, &incoming, &pred, 1);
+        }
+        unfilledPhis.erase(phi);
+        filled.push_back(phi);
+    }
+    removeTrivialPhis_ssa(filled);
+}
+
+/* makes the value the current definition of the slot in the block */
+void writeVariable_ssa(int slot, LLVMBasicBlockRef block, LLVMValueRef value) {
+    ssaDefs[ssaDefKey(blockState_ssa(block).number, slot)] = value;
+}
+
+/* returns the value of the slot at the builder's position, adding whatever phis it needs */
+LLVMValueRef useVariable_ssa(int slot) {
+    return readVariable_ssa(slot, LLVMGetInsertBlock(builder));
+}
+
+/* looks up the current definition of the slot at the end of the block
+ * a lookup reaching a sealed block with several predecessors looks in each of them in turn,
+ * with the lookups in progress kept on a heap stack rather than recursing, and the block
+ * marked as visited so a lookup coming back to it through a loop ends at a phi for it
+ */
+LLVMValueRef readVariable_ssa(int slot, LLVMBasicBlockRef block) {
+    vector<ssaLookup> lookups;
+    LLVMValueRef value = findDefinition_ssa(slot, block, lookups);
+
+    while(!lookups.empty()) {
+        // a found value belongs to the predecessor the innermost lookup looked in last
+        if(value != NULL) {
+            lookups.back().values.push_back(value);
+            value = NULL;
+        }
+
+        ssaLookup& lookup = lookups.back();
+        vector<LLVMBasicBlockRef>& preds = blockState_ssa(lookup.block).preds;
+        if(lookup.values.size() < preds.size()) {
+            value = findDefinition_ssa(slot, preds[lookup.values.size()], lookups);
+        } else {
+            value = joinDefinitions_ssa(slot, lookup);
+            lookups.pop_back();
+        }
+    }
+
+    return value;
+}
+
+/* walks up from the block through blocks with a single predecessor to the slot's definition,
+ * returning it and recording it in every block walked through so it is not looked up again
+ * adds an incomplete phi to a block not yet sealed, and returns the phi of a block
+ * a lookup is already in (adding it if there is none yet)
+ * returns NULL if it reaches a sealed block with several predecessors, having pushed a lookup for it
+ */
+LLVMValueRef findDefinition_ssa(int slot, LLVMBasicBlockRef block, vector<ssaLookup>& lookups) {
+    vector<LLVMBasicBlockRef> walked;
+    LLVMValueRef value = NULL;
+
+    while(value == NULL) {
+        ssaBlock& state = blockState_ssa(block);
+        unordered_map<uint64_t, LLVMValueRef>::iterator def = ssaDefs.find(ssaDefKey(state.number, slot));
+        if(def != ssaDefs.end()) {
+            value = resolveValue_ssa(def->second);
+        } else if(state.visiting) {
+            // back at a block through a loop, its phi stands for its value until its lookup is done
+            if(state.cyclePhi == NULL) {
+                state.cyclePhi = addPhi_ssa(block);
+            }
+            value = state.cyclePhi;
+        } else if(!state.sealed && state.assigned != NULL && state.preds.size() == 1
+            && !binary_search(state.assigned->begin(), state.assigned->end(), slot)) {
+            // the loop does not assign the slot, so the branch back to its condition keeps its value
+            walked.push_back(block);
+            block = state.preds[0];
+        } else if(!state.sealed) {
+            // more predecessors may come, the phi's operands are added when the block is sealed
+            value = addPhi_ssa(block);
+            state.incompletePhis.push_back({ slot, value });
+            writeVariable_ssa(slot, block, value);
+        } else if(state.preds.empty()) {
+            // read before any assignment
+            value = LLVMGetUndef(LLVMInt32TypeInContext(context));
+        } else if(state.preds.size() == 1) {
+            walked.push_back(block);
+            block = state.preds[0];
+        } else {
+            state.visiting = true;
+            lookups.push_back({ block, walked, {} });
+            return NULL;
+        }
+    }
+
+    for(size_t i = 0; i < walked.size(); i++) {
+        writeVariable_ssa(slot, walked[i], value);
+    }
+    return value;
+}
+
+/* finishes the lookup of a block once the slot's value in each predecessor is known:
+ * the value is theirs if they all agree, otherwise a phi of them, and if a loop led the lookup
+ * back to the block, the phi it added there is given the values and removed if it is trivial
+ */
+LLVMValueRef joinDefinitions_ssa(int slot, ssaLookup& lookup) {
+    ssaBlock& state = blockState_ssa(lookup.block);
+    LLVMValueRef phi = state.cyclePhi;
+    state.visiting = false;
+    state.cyclePhi = NULL;
+
+    LLVMValueRef same = NULL;
+    bool agree = true;
+    for(size_t i = 0; i < lookup.values.size() && agree; i++) {
+        if(lookup.values[i] != same && lookup.values[i] != phi) {
+            agree = (same == NULL);
+            same = lookup.values[i];
+        }
+    }
+
+    LLVMValueRef value;
+    if(phi == NULL && agree) {
+        value = same;
+    } else {
+        if(phi == NULL) {
+            phi = addPhi_ssa(lookup.block);
+        }
+        for(size_t i = 0; i < lookup.values.size(); i++) {
+            LLVMBasicBlockRef pred = state.preds[i];
+            LLVMAddIncoming(phi, &lookup.values[i], &pred, 1);
+        }
+        unfilledPhis.erase(phi);
+        vector<LLVMValueRef> candidates(1, phi);
+        removeTrivialPhis_ssa(candidates);
+        value = resolveValue_ssa(phi);
+    }
+
+    writeVariable_ssa(slot, lookup.block, value);
+    for(size_t i = 0; i < lookup.walked.size(); i++) {
+        writeVariable_ssa(slot, lookup.walked[i], value);
+    }
+    return value;
+}
+
+/* adds a phi without operands to the top of the block */
+LLVMValueRef addPhi_ssa(LLVMBasicBlockRef block) {
+    LLVMValueRef first = LLVMGetFirstInstruction(block);
+    if(first != NULL) {
+        LLVMPositionBuilderBefore(phiBuilder, first);
+    } else {
+        LLVMPositionBuilderAtEnd(phiBuilder, block);
+    }
+    LLVMValueRef phi = LLVMBuildPhi(phiBuilder, LLVMInt32TypeInContext(context), "");
+    unfilledPhis.insert(phi);
+    return phi;
+}
+
+/* replaces every phi whose operands are all the same value or the phi itself by that value
+ * (undef if there is none), then checks the phis that used it, which may have become trivial too
+ * the replaced phis are only erased once the build is done, as blocks may still name them as definitions
+ */
+void removeTrivialPhis_ssa(vector<LLVMValueRef>& candidates) {
+    while(!candidates.empty()) {
+        LLVMValueRef phi = candidates.back();
+        candidates.pop_back();
+        if(replacedPhis.count(phi) > 0 || unfilledPhis.count(phi) > 0) {
+            continue;
+        }
+
+        // find the single value other than itself
+        LLVMValueRef same = NULL;
+        bool trivial = true;
+        unsigned count = LLVMCountIncoming(phi);
+        for(unsigned i = 0; i < count && trivial; i++) {
+            LLVMValueRef incoming = LLVMGetIncomingValue(phi, i);
+            if(incoming == same || incoming == phi) {
+                continue;
+            }
+            trivial = (same == NULL);
+            same = incoming;
+        }
+        if(!trivial) {
+            continue;
+        }
+        if(same == NULL) { // only reached from itself, or not at all
+            same = LLVMGetUndef(LLVMInt32TypeInContext(context));
+        }
+
+        for(LLVMUseRef use = LLVMGetFirstUse(phi); use; use = LLVMGetNextUse(use)) {
+            LLVMValueRef user = LLVMGetUser(use);
+            if(user != phi && LLVMIsAPHINode(user)) {
+                candidates.push_back(user);
+            }
+        }
+        LLVMReplaceAllUsesWith(phi, same);
+        replacedPhis[phi] = same;
+    }
+}
+
+/* returns the value a definition stands for now, following the trivial phis replaced since
+ * and pointing every phi on the way straight at it, so chains of replacements are followed once
+ */
+LLVMValueRef resolveValue_ssa(LLVMValueRef value) {
+    vector<unordered_map<LLVMValueRef, LLVMValueRef>::iterator> chain;
+    unordered_map<LLVMValueRef, LLVMValueRef>::iterator replaced = replacedPhis.find(value);
+    while(replaced != replacedPhis.end()) {
+        chain.push_back(replaced);
+        value = replaced->second;
+        replaced = replacedPhis.find(value);
+    }
+    for(size_t i = 0; i + 1 < chain.size(); i++) {
+        chain[i]->second = value;
+    }
+    return value;
+}
+
+
+/* OPTIMIZATION FUNCTIONS */
+/* ---------------------- */
+
+/* optimizes the basic block from the generator */
+void optimizeLLVMBasicBlocks(LLVMModuleRef mod) {
+    context = LLVMGetModuleContext(mod);
+
+    // loop through the functions and optimize
+    for(LLVMValueRef function =  LLVMGetFirstFunction(mod); 
+        function; 
+        function = LLVMGetNextFunction(function)) {
+
+        deadTerminatorElimination(function);
+
+        // the blocks left are numbered before the unreachable ones, so deleting these keeps the graph valid
+        controlFlowGraph cfg = buildControlFlowGraph(function);
+        deadBlockElimination(function, cfg);
+        mergeLinearBlocks(function, cfg);
+
+    }
+}
+
+/* runs through all of the basic blocks
+ * once a terminator is reached, it deletes all instructions after that terminator
+*/
+void deadTerminatorElimination(LLVMValueRef function) {
+    assert(function != NULL);
+
+    vector<LLVMValueRef> instructionsToErase; // instructions to erase
+
+    for(LLVMBasicBlockRef bb = LLVMGetFirstBasicBlock(function);
+        bb;
+        bb = LLVMGetNextBasicBlock(bb)) {
+
+        bool terminatorReached = false;
+        // walk instructions
+        for (LLVMValueRef instruction = LLVMGetFirstInstruction(bb); 
+            instruction;
+            instruction = LLVMGetNextInstruction(instruction)) {
+
+            // if we have hit a branch or return, delete deadcode
+            if(terminatorReached) {
+                instructionsToErase.push_back(instruction);
+            }
+
+            // if we have a branch or return, enable flag to delete deadcode
+            if(LLVMIsATerminatorInst(instruction)) {
+                terminatorReached = true;
+            }
+        }
+
+        // special case where no instructions in a block - add a return 0
+        if(!LLVMGetFirstInstruction(bb)) {
+            builder = LLVMCreateBuilderInContext(context);
+            LLVMPositionBuilderAtEnd(builder, bb);
+            LLVMValueRef zero = LLVMConstInt(LLVMInt32TypeInContext(context), 0, false);
+            LLVMBuildRet(builder, zero);
+            LLVMDisposeBuilder(builder);
+
+        }
+    }
+
+    // delete the instructions
+    vector<LLVMValueRef>::iterator it = instructionsToErase.begin();
+    while(it != instructionsToErase.end()) {
+        assert(*it != NULL);
+        LLVMInstructionEraseFromParent(*it);
+        it++;
+    }
+}
+
+/* deletes all blocks present in the function that are not 'reachable' from the entry,
+ * which the CFG numbers after the reachable ones
+*/
+void deadBlockElimination(LLVMValueRef function, const controlFlowGraph& cfg) {
+    assert(function != NULL);
+
+    vector<LLVMBasicBlockRef> blocksToDelete(cfg.blocks.begin() + cfg.numReachable, cfg.blocks.end());
+    deleteBasicBlocks(blocksToDelete);
+}
+
+/* merges two blocks if they are both their unique successor and predecessor
+ * the blocks are visited in reverse postorder, so each chain of such blocks is merged
+ * into its first block, whose successors become those of the last block merged into it
+ * edges from unreachable blocks are ignored, as deadBlockElimination deletes them first
+ */
+void mergeLinearBlocks(LLVMValueRef function, const controlFlowGraph& cfg) {
+    assert(function != NULL);
+
+    vector<LLVMBasicBlockRef> blocksToDelete;
+    vector<bool> merged(cfg.numReachable, false);
+
+    for(int b = 0; b < cfg.numReachable; b++) {
+        if(merged[b]) {
+            continue;
+        }
+
+        int last = b; // last block of the chain merged into b
+        while(numEdges(cfg.successors, last) == 1) {
+            int successor = cfg.successors.targets[cfg.successors.offsets[last]];
+
+            // stop at the entry and at successors with more than one reachable predecessor
+            int predecessors = 0;
+            for(int e = cfg.predecessors.offsets[successor]; e < cfg.predecessors.offsets[successor + 1]; e++) {
+                predecessors += (cfg.predecessors.targets[e] < cfg.numReachable);
+            }
+            if(successor == 0 || predecessors != 1) {
+                break;
+            }
+
+            // merge
+            mergeBlocks(cfg.blocks[b], cfg.blocks[successor]);
+            blocksToDelete.push_back(cfg.blocks[successor]);
+            merged[successor] = true;
+            last = successor;
+        }
+    }
+
+    deleteBasicBlocks(blocksToDelete);
+}
+
+/* merges two blocks together */
+void mergeBlocks(LLVMBasicBlockRef first, LLVMBasicBlockRef second) {
+
+    // delete all of the br instructions from the end of the first block
+    vector<LLVMValueRef> instructionsToDelete;
+    for(LLVMValueRef instruction = LLVMGetFirstInstruction(first);
+        instruction;
+        instruction = LLVMGetNextInstruction(instruction)) {
+
+        if(LLVMGetInstructionOpcode(instruction) == LLVMBr) { // if br, add to list of instructions to delete
+            instructionsToDelete.push_back(instruction);
+        }
+    }
+
+    // delete, erasing rather than unlinking, so no stray branch still names a block
+    vector<LLVMValueRef>::iterator it = instructionsToDelete.begin();
+    while(it != instructionsToDelete.end()) {
+        assert(*it != NULL);
+        LLVMInstructionEraseFromParent(*it);
+        it++;
+    }
+
+    // the phis of the second block's successors now come from the first
+    LLVMReplaceAllUsesWith(LLVMBasicBlockAsValue(second), LLVMBasicBlockAsValue(first));
 
     // add all of the instructions of the second block to the end of the first
-    builder = LLVMCreateBuilder();
+    builder = LLVMCreateBuilderInContext(context);
     LLVMPositionBuilderAtEnd(builder, first);
     LLVMValueRef nextInstruction;
     for(LLVMValueRef instruction = LLVMGetFirstInstruction(second);
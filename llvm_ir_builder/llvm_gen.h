@@ -2,6 +2,7 @@
 #include <llvm-c/IRReader.h>
 #include <llvm-c/Types.h>
 #include "../lib/ast/ast.h"
+#include "../lib/ast/flat_ast.h"
 #include <unordered_map>
 #include <set>
 #include <array>
@@ -10,5 +11,9 @@
 /* --------- */
 
 LLVMModuleRef createLLVMModelFromAST(astNode* root, char* filename);
+LLVMModuleRef createLLVMModelFromASTInContext(astNode* root, char* filename, LLVMContextRef llvmContext);
+LLVMModuleRef createLLVMModelFromFlatAST(flatAST* ast, char* filename, LLVMContextRef llvmContext);
+LLVMModuleRef createLLVMModelFromAST_fused(astNode* root, char* filename, LLVMContextRef llvmContext);
+LLVMModuleRef createLLVMModelFromAST_ssa(astNode* root, char* filename, LLVMContextRef llvmContext);
 
 void optimizeLLVMBasicBlocks(LLVMModuleRef mod);
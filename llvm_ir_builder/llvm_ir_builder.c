@@ -11,21 +11,16 @@
 #include <llvm-c/IRReader.h>
 #include <llvm-c/Types.h>
 #include "../syntax_analyzer/semantic_analysis.h"
+#include "../syntax_analyzer/parser.h"
 #include "llvm_gen.h"
 using namespace std;
 
-/* EXTERNS */
-/* ------- */
-
-extern void yyparse();
-extern int yylex_destroy();
-extern FILE *yyin;
-extern char* yytext;
-
 /* GLOBAL VARIABLES */
 /* ---------------- */
 
 astNode* root; // root of the AST
+astArena* arena; // owns every node of the AST
+FILE* input = stdin; // source file, or stdin if none is given
 
 /* MAIN */
 /* ---- */
@@ -33,11 +28,19 @@ astNode* root; // root of the AST
 int main(int argc, char** argv){
 	
 	if (argc >= 2){
-		yyin = fopen(argv[1], "r");
+		input = fopen(argv[1], "r");
 	}
 
     // generate the AST
-	yyparse();
+	arena = createArena();
+	root = parseFile(input, arena);
+
+	// semantic analysis resolves every variable to the stack slot the builder allocates it in
+	if (root == NULL || !semanticAnalysis_opt(root)){
+		printf("FAILURE: Semantics Failed\n");
+		freeArena(arena);
+		return 1;
+	}
 
     LLVMModuleRef llvm_ir = createLLVMModelFromAST(root, argv[1]);
 	optimizeLLVMBasicBlocks(llvm_ir);
@@ -47,10 +50,9 @@ int main(int argc, char** argv){
 	}
 
     // close
-	if (yyin != stdin)
-		fclose(yyin);
-	yylex_destroy();
-    freeNode(root);
+	if (input != stdin)
+		fclose(input);
+    freeArena(arena);
 	
 	return 0;
 }
\ No newline at end of file
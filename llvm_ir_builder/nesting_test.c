@@ -0,0 +1,332 @@
+/*
+ * This is a stress test for the AST traversals which builds programs nested 100k levels deep
+ * and runs them through both parsers, semantic analysis, the IR builder, the fused and SSA builds, printNode and freeNode,
+ * and the flat AST through flattenAST, its semantic analysis, its IR builder and a cache round trip,
+ * then optimizes a built program, finds its loops and generates its assembly
+ * on a thread with a small stack, so any walker that recurses per nesting level overflows it
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string>
+#include <llvm-c/Core.h>
+#include "../syntax_analyzer/semantic_analysis.h"
+#include "../syntax_analyzer/parser.h"
+#include "llvm_gen.h"
+#include "../optimizer/llvm_optimizations.h"
+#include "../optimizer/pass_manager.h"
+#include "../assembly_generator/llvm_to_assembly.h"
+using namespace std;
+
+#define NESTING_DEPTH 100000
+#define PRINT_DEPTH 2000 // the printed tree is quadratic in the depth, as every level is indented further
+#define STACK_SIZE (512 * 1024)
+
+/* FUNCTION PROTOTYPES */
+/* ------------------- */
+
+typedef astNode* (*parserFunction)(char* buffer, size_t size, astArena* arena);
+
+void* runTests(void* failures);
+bool testPipeline(int depth, bool declared, parserFunction parse);
+bool testFlat(int depth, bool declared);
+bool testBackend(int depth);
+bool testPrint(int depth);
+bool testFree(int depth);
+string nestedSource(int depth, bool declared);
+astNode* nestedTree(int depth);
+
+
+/* MAIN */
+/* ---- */
+
+int main(int argc, char** argv){
+
+    // the tests run on their own thread, whose stack is far smaller than the recursion would need
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_setstacksize(&attributes, STACK_SIZE);
+
+    int failures = 0;
+    pthread_t thread;
+    if(pthread_create(&thread, &attributes, runTests, &failures) != 0) {
+        printf("Could not start the test thread\n");
+        return 1;
+    }
+    pthread_join(thread, NULL);
+    pthread_attr_destroy(&attributes);
+
+    printf("%d failed\n", failures);
+    return (failures == 0) ? 0 : 1;
+}
+
+void* runTests(void* failures) {
+    int* failed = (int*) failures;
+    *failed += !testPipeline(NESTING_DEPTH, true, parseBuffer);
+    *failed += !testPipeline(NESTING_DEPTH, false, parseBuffer);
+    *failed += !testPipeline(NESTING_DEPTH, true, parseBuffer_rd);
+    *failed += !testFlat(NESTING_DEPTH, true);
+    *failed += !testFlat(NESTING_DEPTH, false);
+    *failed += !testBackend(NESTING_DEPTH);
+    *failed += !testPrint(PRINT_DEPTH);
+    *failed += !testFree(NESTING_DEPTH);
+    return NULL;
+}
+
+/* parses a program of the given depth with the parser, then checks and builds it, checking that semantic analysis
+ * and the fused build catch the undeclared variable at the bottom if there is one, 
+ * and that every block was built
+ */
+bool testPipeline(int depth, bool declared, parserFunction parse) {
+    string source = nestedSource(depth, declared);
+    source.append(2, '\0'); // both parsers need the source followed by two NUL bytes
+
+    astArena* arena = createArena();
+    astNode* root = parse(&source[0], source.size() - 2, arena);
+    if(root == NULL) {
+        printf("FAIL: could not parse a program nested %d levels deep\n", depth);
+        freeArena(arena);
+        return false;
+    }
+
+    // the fused build checks the tree as it was parsed, the undeclared variable is reported on stderr
+    LLVMContextRef fusedContext = LLVMContextCreate();
+    LLVMModuleRef fused = createLLVMModelFromAST_fused(root, (char*) "nesting_test.c", fusedContext);
+    unsigned fusedBlocks = (fused != NULL) ? LLVMCountBasicBlocks(LLVMGetNamedFunction(fused, "func")) : 0;
+    if(fused != NULL) {
+        LLVMDisposeModule(fused);
+    }
+    LLVMContextDispose(fusedContext);
+    if((fused != NULL) != declared) {
+        printf("FAIL: the fused build of a program nested %d levels deep returned %s\n", depth, (fused != NULL) ? "a module" : "NULL");
+        freeArena(arena);
+        return false;
+    }
+
+    bool valid = semanticAnalysis_opt(root);
+    if(valid != declared) {
+        printf("FAIL: semantic analysis of a program nested %d levels deep returned %d\n", depth, valid);
+        freeArena(arena);
+        return false;
+    }
+    if(!declared) {
+        printf("PASS: undeclared variable found %d levels deep\n", depth);
+        freeArena(arena);
+        return true;
+    }
+
+    // entry and return blocks, three per while, two per if and one for the return statement
+    LLVMContextRef context = LLVMContextCreate();
+    LLVMModuleRef mod = createLLVMModelFromASTInContext(root, (char*) "nesting_test.c", context);
+    unsigned expected = 2 + 3 * ((depth + 1) / 2) + 2 * (depth / 2) + 1;
+    unsigned blocks = LLVMCountBasicBlocks(LLVMGetNamedFunction(mod, "func"));
+    LLVMDisposeModule(mod);
+    LLVMContextDispose(context);
+
+    // the SSA build looks the variables up through every level of the nesting
+    LLVMContextRef ssaContext = LLVMContextCreate();
+    LLVMModuleRef ssa = createLLVMModelFromAST_ssa(root, (char*) "nesting_test.c", ssaContext);
+    unsigned ssaBlocks = LLVMCountBasicBlocks(LLVMGetNamedFunction(ssa, "func"));
+    LLVMDisposeModule(ssa);
+    LLVMContextDispose(ssaContext);
+
+    bool passed = (blocks == expected && fusedBlocks == expected && ssaBlocks == expected);
+    if(passed) {
+        printf("PASS: built %u blocks for a program nested %d levels deep\n", blocks, depth);
+    } else {
+        printf("FAIL: built %u blocks (%u fused, %u ssa) for a program nested %d levels deep, expected %u\n",
+            blocks, fusedBlocks, ssaBlocks, depth, expected);
+    }
+
+    freeArena(arena);
+    return passed;
+}
+
+/* flattens the unchecked tree of a program of the given depth, checks the flat tree, 
+ * checking that the undeclared variable at the bottom is caught if there is one,
+ * then builds it both directly and after writing it to a cache file and loading it back
+ */
+bool testFlat(int depth, bool declared) {
+    string source = nestedSource(depth, declared);
+    source.append(2, '\0');
+
+    astArena* arena = createArena();
+    astNode* root = parseBuffer(&source[0], source.size() - 2, arena);
+    assert(root != NULL);
+    flatAST* flat = flattenAST(root);
+    freeArena(arena);
+
+    bool valid = semanticAnalysis_flat(flat);
+    if(valid != declared) {
+        printf("FAIL: semantic analysis of a flat tree nested %d levels deep returned %d\n", depth, valid);
+        freeFlatAST(flat);
+        return false;
+    }
+    if(!declared) {
+        printf("PASS: undeclared variable found %d levels deep in a flat tree\n", depth);
+        freeFlatAST(flat);
+        return true;
+    }
+
+    LLVMContextRef context = LLVMContextCreate();
+    LLVMModuleRef mod = createLLVMModelFromFlatAST(flat, (char*) "nesting_test.c", context);
+    unsigned expected = 2 + 3 * ((depth + 1) / 2) + 2 * (depth / 2) + 1;
+    unsigned blocks = LLVMCountBasicBlocks(LLVMGetNamedFunction(mod, "func"));
+    LLVMDisposeModule(mod);
+    LLVMContextDispose(context);
+
+    // the cache is only checked against the size and hash it was written with
+    char cachePath[] = "/tmp/nesting_testXXXXXX";
+    int cacheFile = mkstemp(cachePath);
+    assert(cacheFile >= 0);
+    close(cacheFile);
+    bool written = writeFlatASTCache(cachePath, flat, source.size(), depth);
+    freeFlatAST(flat);
+    flatAST* cached = written ? loadFlatASTCache(cachePath, source.size(), depth) : NULL;
+    unlink(cachePath);
+    unsigned cachedBlocks = 0;
+    if(cached != NULL) {
+        LLVMContextRef cacheContext = LLVMContextCreate();
+        LLVMModuleRef cacheModule = createLLVMModelFromFlatAST(cached, (char*) "nesting_test.c", cacheContext);
+        cachedBlocks = LLVMCountBasicBlocks(LLVMGetNamedFunction(cacheModule, "func"));
+        LLVMDisposeModule(cacheModule);
+        LLVMContextDispose(cacheContext);
+        freeFlatAST(cached);
+    }
+
+    bool passed = (blocks == expected && cachedBlocks == expected);
+    if(passed) {
+        printf("PASS: built %u blocks for a flat tree nested %d levels deep, before and after caching it\n", blocks, depth);
+    } else {
+        printf("FAIL: built %u blocks (%u from the cache) for a flat tree nested %d levels deep, expected %u\n",
+            blocks, cachedBlocks, depth, expected);
+    }
+    return passed;
+}
+
+/* builds a program of the given depth, optimizes it and checks that its whiles were found as loops
+ * each inside the one before, then generates its assembly to /dev/null
+ */
+bool testBackend(int depth) {
+    string source = nestedSource(depth, true);
+    source.append(2, '\0');
+
+    astArena* arena = createArena();
+    astNode* root = parseBuffer(&source[0], source.size() - 2, arena);
+    assert(root != NULL);
+    bool valid = semanticAnalysis_opt(root);
+    assert(valid);
+    LLVMContextRef context = LLVMContextCreate();
+    LLVMModuleRef mod = createLLVMModelFromASTInContext(root, (char*) "nesting_test.c", context);
+    freeArena(arena);
+
+    optimizeLLVMBasicBlocks(mod);
+    optimizeLLVM(mod);
+
+    // the innermost while is as deep as the number of whiles
+    functionAnalyses* analyses = requireAnalysis(LLVMGetNamedFunction(mod, "func"), analysis_loops);
+    int loopDepth = 0;
+    for(int b = 0; b < (int) analyses->loopDepth.size(); b++) {
+        loopDepth = max(loopDepth, analyses->loopDepth[b]);
+    }
+    int numLoops = analyses->loops.size();
+
+    codegen(mod, (char*) "/dev/null");
+    LLVMDisposeModule(mod);
+    LLVMContextDispose(context);
+
+    int expected = (depth + 1) / 2;
+    bool passed = (numLoops == expected && loopDepth == expected);
+    if(passed) {
+        printf("PASS: optimized and generated a program with %d loops nested %d levels deep\n", numLoops, depth);
+    } else {
+        printf("FAIL: found %d loops up to %d deep in a program nested %d levels deep, expected %d\n",
+            numLoops, loopDepth, depth, expected);
+    }
+    return passed;
+}
+
+/* prints a deeply nested tree to /dev/null */
+bool testPrint(int depth) {
+    astNode* root = nestedTree(depth);
+
+    fflush(stdout);
+    int out = dup(STDOUT_FILENO);
+    int null = open("/dev/null", O_WRONLY);
+    dup2(null, STDOUT_FILENO);
+    printNode(root);
+    fflush(stdout);
+    dup2(out, STDOUT_FILENO);
+    close(null);
+    close(out);
+
+    freeNode(root);
+    printf("PASS: printed a tree nested %d levels deep\n", depth);
+    return true;
+}
+
+/* frees a deeply nested tree allocated from the heap */
+bool testFree(int depth) {
+    astNode* root = nestedTree(depth);
+    freeNode(root);
+    printf("PASS: freed a tree nested %d levels deep\n", depth);
+    return true;
+}
+
+/* returns a valid program of alternately nested whiles and ifs, each body a block
+ * holding the next level, with a declaration and assignments at the bottom
+ * if declared is false, the bottom uses a variable that is never declared
+ */
+string nestedSource(int depth, bool declared) {
+    string source = "extern void print(int);\nextern int read();\n\nint func(int p){\n\tint a;\n\ta = 0;\n";
+    for(int i = 0; i < depth; i++) {
+        source += (i % 2 == 0) ? "while (a < p) {\n" : "if (a > 1) {\n";
+    }
+    source += "int b;\nb = a + 1;\n";
+    source += declared ? "a = b;\n" : "a = c;\n";
+    source += "print(a);\n";
+    for(int i = 0; i < depth; i++) {
+        source += "}\n";
+    }
+    source += "\treturn a;\n}\n";
+    return source;
+}
+
+/* returns the tree of nestedSource built with the create* functions, so it lives on the heap */
+astNode* nestedTree(int depth) {
+    astNodeList* bottom = createNodeList();
+    bottom->push_back(createDecl("b"));
+    bottom->push_back(createAsgn(createVar("b"), createBExpr(createVar("a"), createCnst(1), add)));
+    bottom->push_back(createAsgn(createVar("a"), createVar("b")));
+    bottom->push_back(createCall("print", createVar("a")));
+    astNode* body = createBlock(bottom);
+
+    // wrap the bottom in every level, innermost first, each level but the outermost in a block
+    astNode* stmt = NULL;
+    for(int i = depth - 1; i >= 0; i--) {
+        if(stmt != NULL) {
+            astNodeList* level = createNodeList();
+            level->push_back(stmt);
+            body = createBlock(level);
+        }
+        if(i % 2 == 0) {
+            stmt = createWhile(createRExpr(createVar("a"), createVar("p"), lt), body);
+        } else {
+            stmt = createIf(createRExpr(createVar("a"), createCnst(1), gt), body);
+        }
+    }
+
+    astNodeList* outer = createNodeList();
+    outer->push_back(createDecl("a"));
+    outer->push_back(createAsgn(createVar("a"), createCnst(0)));
+    outer->push_back(stmt);
+    outer->push_back(createRet(createVar("a")));
+
+    astNode* func = createFunc("func", createVar("p"), createBlock(outer));
+    return createProg(createExtern("print"), createExtern("read"), func);
+}
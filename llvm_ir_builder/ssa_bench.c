@@ -0,0 +1,170 @@
+/*
+ * This is a benchmark program for the SSA build of the IR builder which, for each given source,
+ * builds its module with the variables in memory and in SSA form, then prints the instructions
+ * of both (in all, and the allocas, loads, stores and phis among them) as built and once optimized,
+ * and the best time of each over the repeats to build, optimize and generate assembly
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <time.h>
+#include <llvm-c/Core.h>
+#include "../syntax_analyzer/semantic_analysis.h"
+#include "../syntax_analyzer/parser.h"
+#include "../optimizer/llvm_optimizations.h"
+#include "../assembly_generator/llvm_to_assembly.h"
+#include "llvm_gen.h"
+#include "../helper/elapsed_time.h"
+using namespace std;
+
+/* what is counted and timed for a build */
+typedef struct {
+        int built[5]; // instructions, allocas, loads, stores and phis as built
+        int optimized[5]; // the same once optimized
+        double ms[3]; // best time to build, optimize and generate assembly
+    } buildStats;
+
+/* FUNCTION PROTOTYPES */
+/* ------------------- */
+
+bool benchFile(const char* path, int repeats, buildStats* memory, buildStats* ssa);
+void benchBuild(astNode* root, const char* path, bool ssa, int repeats, buildStats* stats);
+void countInstructions(LLVMModuleRef mod, int counts[5]);
+void printStats(const char* name, const char* build, buildStats* stats);
+
+
+/* MAIN */
+/* ---- */
+
+int main(int argc, char** argv){
+
+    // ssa_bench [repeats] [sources]
+    int repeats = (argc > 1) ? atoi(argv[1]) : 100;
+    assert(repeats > 0);
+
+    buildStats totals[2];
+    memset(totals, 0, sizeof(totals));
+    printf("%-12s %-7s %27s %27s %10s %10s %10s\n", "source", "build", "built (all/alloca/ld/st/phi)",
+        "optimized (all/alloca/ld/st/phi)", "build us", "opt us", "asm us");
+
+    for(int i = 2; i < argc; i++) {
+        const char* name = strrchr(argv[i], '/') ? strrchr(argv[i], '/') + 1 : argv[i];
+        buildStats stats[2];
+        if(!benchFile(argv[i], repeats, &stats[0], &stats[1])) {
+            printf("%-12s skipped, it does not parse and check\n", name);
+            continue;
+        }
+
+        for(int b = 0; b < 2; b++) {
+            printStats(name, (b == 0) ? "memory" : "ssa", &stats[b]);
+            for(int k = 0; k < 5; k++) {
+                totals[b].built[k] += stats[b].built[k];
+                totals[b].optimized[k] += stats[b].optimized[k];
+            }
+            for(int k = 0; k < 3; k++) {
+                totals[b].ms[k] += stats[b].ms[k];
+            }
+        }
+    }
+
+    printStats("total", "memory", &totals[0]);
+    printStats("total", "ssa", &totals[1]);
+    return 0;
+}
+
+/* parses and checks the source, then benchmarks both builds of it
+ * returns false if it does not parse or check
+ */
+bool benchFile(const char* path, int repeats, buildStats* memory, buildStats* ssa) {
+    FILE* input = fopen(path, "r");
+    if(input == NULL) {
+        return false;
+    }
+    astArena* arena = createArena();
+    astNode* root = parseFile(input, arena);
+    fclose(input);
+    if(root == NULL || !semanticAnalysis_opt(root)) {
+        freeArena(arena);
+        return false;
+    }
+
+    benchBuild(root, path, false, repeats, memory);
+    benchBuild(root, path, true, repeats, ssa);
+    freeArena(arena);
+    return true;
+}
+
+/* builds, optimizes and generates assembly (thrown away) for the checked tree the given number
+ * of times, each in a context of its own, counting the instructions of the first module
+ */
+void benchBuild(astNode* root, const char* path, bool ssa, int repeats, buildStats* stats) {
+    for(int k = 0; k < 3; k++) {
+        stats->ms[k] = -1;
+    }
+
+    for(int r = 0; r < repeats; r++) {
+        // each phase is timed from its start to its end, the counting in between is not
+        struct timespec times[6];
+        LLVMContextRef context = LLVMContextCreate();
+        clock_gettime(CLOCK_MONOTONIC, &times[0]);
+        LLVMModuleRef mod = ssa ? createLLVMModelFromAST_ssa(root, (char*) path, context)
+            : createLLVMModelFromASTInContext(root, (char*) path, context);
+        clock_gettime(CLOCK_MONOTONIC, &times[1]);
+        if(r == 0) {
+            countInstructions(mod, stats->built);
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &times[2]);
+        optimizeLLVMBasicBlocks(mod);
+        optimizeLLVM(mod);
+        clock_gettime(CLOCK_MONOTONIC, &times[3]);
+        if(r == 0) {
+            countInstructions(mod, stats->optimized);
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &times[4]);
+        codegen(mod, (char*) "/dev/null");
+        clock_gettime(CLOCK_MONOTONIC, &times[5]);
+        LLVMDisposeModule(mod);
+        LLVMContextDispose(context);
+
+        for(int k = 0; k < 3; k++) {
+            double ms = elapsedMs(times[2 * k], times[2 * k + 1]);
+            if(stats->ms[k] < 0 || ms < stats->ms[k]) {
+                stats->ms[k] = ms;
+            }
+        }
+    }
+}
+
+/* counts the instructions of the module's functions, and the allocas, loads, stores and phis among them */
+void countInstructions(LLVMModuleRef mod, int counts[5]) {
+    memset(counts, 0, 5 * sizeof(int));
+    for(LLVMValueRef func = LLVMGetFirstFunction(mod); func; func = LLVMGetNextFunction(func)) {
+        for(LLVMBasicBlockRef bb = LLVMGetFirstBasicBlock(func); bb; bb = LLVMGetNextBasicBlock(bb)) {
+            for(LLVMValueRef instruction = LLVMGetFirstInstruction(bb); instruction; instruction = LLVMGetNextInstruction(instruction)) {
+                counts[0]++;
+                switch(LLVMGetInstructionOpcode(instruction)) {
+                    case LLVMAlloca: counts[1]++; break;
+                    case LLVMLoad: counts[2]++; break;
+                    case LLVMStore: counts[3]++; break;
+                    case LLVMPHI: counts[4]++; break;
+                    default: break;
+                }
+            }
+        }
+    }
+}
+
+void printStats(const char* name, const char* build, buildStats* stats) {
+    char built[64];
+    char optimized[64];
+    snprintf(built, sizeof(built), "%d/%d/%d/%d/%d", stats->built[0], stats->built[1], stats->built[2],
+        stats->built[3], stats->built[4]);
+    snprintf(optimized, sizeof(optimized), "%d/%d/%d/%d/%d", stats->optimized[0], stats->optimized[1],
+        stats->optimized[2], stats->optimized[3], stats->optimized[4]);
+    printf("%-12s %-7s %27s %27s %10.1f %10.1f %10.1f\n", name, build, built, optimized,
+        stats->ms[0] * 1000, stats->ms[1] * 1000, stats->ms[2] * 1000);
+}
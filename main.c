@@ -1,94 +1,438 @@
-/* 
+/*
  * This is the main program for the miniC compiler, which links together all of the individual compiler components.
  * It takes a single input with a miniC file, which then tokenizes, analyzes, optimizes and turns into machine code
  * to be executed.
+ *
+ * Passing --time-report (or --time-report=json) prints the wall time, peak memory and
+ * instruction counts of every phase to stderr.
+ *
+ * Sources are memory-mapped and scanned in place; an input path of "-" reads the source from stdin.
+ *
+ * Passing --ast-cache saves the checked AST of each source next to it as [source].ast, in a binary
+ * format tagged with a hash of the source, and loads it instead of parsing while the source is unchanged.
+ *
+ * Passing --fused checks the AST and builds the LLVM IR from it in a single traversal,
+ * instead of one traversal for semantic analysis and two for the IR builder.
+ *
+ * Passing --rd-parser parses with the hand-written recursive-descent parser instead of the bison one.
+ *
+ * Passing --ssa builds the LLVM IR of a parsed source straight into SSA form, keeping variables in
+ * registers joined by phis instead of allocating, loading and storing them (it does not apply
+ * to --fused builds, and with --ast-cache it parses the source rather than load the cached AST,
+ * which is only built with its variables in memory).
+ *
+ * Passing --batch compiles every listed source (and every line of a --manifest file) in one
+ * process, writing each to the source path with a .s extension unless the manifest names
+ * the output, and reports the throughput in files per second. With --jobs N the files are
+ * compiled on N threads (all cores if N is 0), each with its own LLVM context - the modules
+ * keep their working state in thread_local globals and the parser is reentrant.
 */
 
 #include<stdio.h>
 #include<stdlib.h>
 #include<assert.h>
 #include<string.h>
+#include<time.h>
+#include<string>
+#include<vector>
+#include<mutex>
 #include "syntax_analyzer/semantic_analysis.h"
+#include "syntax_analyzer/parser.h"
+#include "syntax_analyzer/source_buffer.h"
 #include "llvm_ir_builder/llvm_gen.h"
 #include "optimizer/llvm_optimizations.h"
 #include "helper/helper_functions.h"
+#include "helper/time_report.h"
+#include "helper/thread_pool.h"
 #include "assembly_generator/llvm_to_assembly.h"
 
 using namespace std;
 
-/* EXTERNS */
-/* ------- */
+/* TYPES */
+/* ----- */
 
-extern void yyparse();
-extern int yylex_destroy();
-extern FILE *yyin;
-extern char* yytext;
+// everything one compilation reads and produces, so that compilations can run on any thread
+typedef struct {
+		char* source;
+		char* dest;
+		LLVMContextRef llvmContext; // owns the module built from the source
+		bool success;
+	} compilationContext;
 
 /* GLOBAL VARS */
 /* ----------- */
 
-astNode* root; // root of the AST
+bool verbose = true; // print the progress of each compilation
+bool jsonReport = false; // print the time report as JSON, so nothing else may go to stderr
+bool astCache = false; // load and save the checked AST of each source in [source].ast
+bool fused = false; // check the AST while building the IR from it
+bool rdParser = false; // parse with the hand-written parser instead of the bison one
+bool ssa = false; // build the IR in SSA form
+
+mutex reportLock; // guards workerReports
+vector<vector<timeReportEntry>> workerReports; // time reports of the finished worker threads
+thread_local LLVMContextRef threadContext; // LLVM context of a worker thread
 
 
 /* FUNCTION PROTOTYPES */
 /* ------------------- */
-void endProgram();
+bool compileFile(compilationContext* compilation);
+LLVMModuleRef buildFromASTCache(compilationContext* compilation, const char* cachePath, size_t sourceSize, uint64_t sourceHash);
+int compileBatch(vector<pair<string, string>>* jobs, int numThreads);
+void compileTask(void* arg);
+void startWorker();
+void exitWorker();
+bool readManifest(char* filename, vector<pair<string, string>>* jobs);
+string defaultDestination(string source);
 
 /* MAIN */
 /* ------- */
 
 int main(int argc, char** argv){
 
-    char source[256];
-    char dest[256];
-    strcpy(source, argv[1]);
-    strcpy(dest, argv[2]);
+    bool batch = false;
+    int numThreads = 1;
+    char* manifest = NULL;
+    vector<char*> paths;
 
-	if (argc == 3){
-		yyin = fopen(source, "r");
-	} else {
-        printf("Please run the file as so: ./[source].out [input filepath] [output filepath]");
-        return 1;
+    // separate the options from the input and output paths
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--time-report") == 0) {
+            enableTimeReport(true);
+        } else if(strcmp(argv[i], "--time-report=json") == 0) {
+            enableTimeReport(true);
+            jsonReport = true;
+        } else if(strcmp(argv[i], "--ast-cache") == 0) {
+            astCache = true;
+        } else if(strcmp(argv[i], "--fused") == 0) {
+            fused = true;
+        } else if(strcmp(argv[i], "--rd-parser") == 0) {
+            rdParser = true;
+        } else if(strcmp(argv[i], "--ssa") == 0) {
+            ssa = true;
+        } else if(strcmp(argv[i], "--batch") == 0) {
+            batch = true;
+        } else if(strcmp(argv[i], "--manifest") == 0 && i + 1 < argc) {
+            batch = true;
+            manifest = argv[++i];
+        } else if(strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            batch = true;
+            numThreads = atoi(argv[++i]);
+            if(numThreads <= 0) {
+                numThreads = defaultThreadCount();
+            }
+        } else {
+            paths.push_back(argv[i]);
+        }
     }
 
-    // generate the AST
-	yyparse();
-    printf("SUCCESS: AST Generated\n");
+    bool success;
+    if(batch) {
+        // every path is a source, followed by the entries of the manifest
+        vector<pair<string, string>> jobs;
+        vector<char*>::iterator it = paths.begin();
+        while(it != paths.end()) {
+            jobs.push_back(make_pair(string(*it), defaultDestination(string(*it))));
+            it++;
+        }
+        if(manifest != NULL && !readManifest(manifest, &jobs)) {
+            return 1;
+        }
+        if(jobs.size() == 0) {
+            printf("Please run the file as so: ./[source].out --batch [input filepaths] [--manifest [manifest filepath]] [--jobs [threads]]");
+            return 1;
+        }
 
+        verbose = false;
+        success = (compileBatch(&jobs, numThreads) == 0);
 
-    // check semantics of the program
-    bool valid_semantics = semanticAnalysis_opt(root); // run with or without _opt extension - _opt trades memory for runtime
+    } else if(paths.size() == 2) {
+        compilationContext compilation;
+        compilation.source = paths[0];
+        compilation.dest = paths[1];
+        compilation.llvmContext = LLVMGetGlobalContext();
+        success = compileFile(&compilation);
 
-    if(!valid_semantics) {
-        freeNode(root);
-        printf("FAILURE: Semantics Failed\n");
+    } else {
+        printf("Please run the file as so: ./[source].out [input filepath] [output filepath] [--time-report[=json]] [--ast-cache] [--fused] [--rd-parser] [--ssa]");
         return 1;
     }
-    printf("SUCCESS: Semantics Checked\n"); 
 
-    // convert to LLVM IR
-    LLVMModuleRef llvm_ir = createLLVMModelFromAST(root, source);
-    optimizeLLVMBasicBlocks(llvm_ir);
-    printf("SUCCESS: LLVM IR Built\n");
+    if(timeReportEnabled()) {
+        printTimeReport(stderr, jsonReport);
+    }
+
+	return success ? 0 : 1;
+}
+
+/* runs the whole compiler on one source file, writing the assembly to dest
+ * every module resets its own state on entry, so this can be called once per file,
+ * and at the same time on other threads as long as each uses its own LLVM context
+ * a source of "-" is read from stdin
+ * returns false if the file could not be read or failed to parse or type check
+ */
+bool compileFile(compilationContext* compilation) {
+    assert(compilation != NULL);
+    assert(compilation->source != NULL && compilation->dest != NULL && compilation->llvmContext != NULL);
+    char* source = compilation->source;
+    char* dest = compilation->dest;
+
+    // map the source (or read it, for stdin) so the scanner lexes it in place
+    sourceBuffer buffer;
+    if(!loadSource(source, &buffer)) {
+        printf("FAILURE: Could not open %s\n", source);
+        return false;
+    }
+
+    // a cached AST of this exact source skips lexing, parsing and semantic analysis
+    bool cached = astCache && strcmp(source, "-") != 0;
+    string cachePath = string(source) + ".ast";
+    uint64_t sourceHash = cached ? hashSource(&buffer) : 0;
+    LLVMModuleRef llvm_ir = NULL;
+    if(cached && !ssa) { // the cached AST only builds with variables in memory, so an SSA build parses
+        llvm_ir = buildFromASTCache(compilation, cachePath.c_str(), buffer.size, sourceHash);
+    }
+    size_t sourceSize = buffer.size;
+    if(llvm_ir != NULL) {
+        releaseSource(&buffer);
+    }
+
+    if(llvm_ir == NULL) {
+        // generate the AST, all of it in one arena
+        astArena* arena = createArena();
+        startPhase("yyparse", NULL);
+        astNode* ast = rdParser ? parseBuffer_rd(buffer.data, buffer.size, arena) : parseBuffer(buffer.data, buffer.size, arena);
+        endPhase(NULL);
+        releaseSource(&buffer);
+
+        if(ast == NULL) {
+            freeArena(arena);
+            printf("FAILURE: Syntax Failed\n");
+            return false;
+        }
+        if(verbose && timeReportEnabled() && !jsonReport) {
+            printArenaStatistics(stderr, arena);
+        }
+        if(verbose) {
+            printf("SUCCESS: AST Generated\n");
+        }
+
 
-    freeNode(root);
+        // check semantics of the program, building the LLVM IR at the same time if fused
+        bool valid_semantics;
+        if(fused) {
+            startPhase("createLLVMModelFromAST_fused", NULL);
+            llvm_ir = createLLVMModelFromAST_fused(ast, source, compilation->llvmContext);
+            endPhase(llvm_ir);
+            valid_semantics = (llvm_ir != NULL);
+        } else {
+            startPhase("semanticAnalysis_opt", NULL);
+            valid_semantics = semanticAnalysis_opt(ast); // run with or without _opt extension - _opt trades memory for runtime
+            endPhase(NULL);
+        }
+
+        if(!valid_semantics) {
+            freeArena(arena);
+            printf("FAILURE: Semantics Failed\n");
+            return false;
+        }
+        if(verbose) {
+            printf("SUCCESS: Semantics Checked\n");
+        }
+
+        // cache the checked AST for the next build of the same source, a failure only costs the next build
+        if(cached) {
+            startPhase("writeFlatASTCache", NULL);
+            flatAST* flat = flattenAST(ast);
+            if(!writeFlatASTCache(cachePath.c_str(), flat, sourceSize, sourceHash) && verbose) {
+                printf("WARNING: Could not write %s\n", cachePath.c_str());
+            }
+            freeFlatAST(flat);
+            endPhase(NULL);
+        }
+
+        // convert to LLVM IR
+        if(llvm_ir == NULL && ssa) {
+            startPhase("createLLVMModelFromAST_ssa", NULL);
+            llvm_ir = createLLVMModelFromAST_ssa(ast, source, compilation->llvmContext);
+            endPhase(llvm_ir);
+        } else if(llvm_ir == NULL) {
+            startPhase("createLLVMModelFromAST", NULL);
+            llvm_ir = createLLVMModelFromASTInContext(ast, source, compilation->llvmContext);
+            endPhase(llvm_ir);
+        }
+        freeArena(arena);
+    }
+
+    startPhase("optimizeLLVMBasicBlocks", llvm_ir);
+    optimizeLLVMBasicBlocks(llvm_ir);
+    endPhase(llvm_ir);
+    if(verbose) {
+        printf("SUCCESS: LLVM IR Built\n");
+    }
 
     // Optimize the LLVM IR
+    startPhase("optimizeLLVM", llvm_ir);
     optimizeLLVM(llvm_ir);
-    printf("SUCCESS: LLVM IR Optimized\n");
+    endPhase(llvm_ir);
+    if(verbose) {
+        printf("SUCCESS: LLVM IR Optimized\n");
+    }
 
     // Convert to machine code
+    startPhase("codegen", llvm_ir);
     codegen(llvm_ir, dest);
-    printf("SUCCESS: Assembly Generated\n");
+    endPhase(llvm_ir);
+    if(verbose) {
+        printf("SUCCESS: Assembly Generated\n");
+    }
 
-    endProgram();
+    LLVMDisposeModule(llvm_ir);
 
-	return 0;
+    return true;
 }
 
-void endProgram() {
-    if (yyin != stdin) {
-		fclose(yyin);
-	    yylex_destroy();
+/* builds the module from the AST cached at the path, if there is one for this version of the source
+ * returns NULL if there is not, for the caller to parse the source instead
+ */
+LLVMModuleRef buildFromASTCache(compilationContext* compilation, const char* cachePath, size_t sourceSize, uint64_t sourceHash) {
+    startPhase("loadFlatASTCache", NULL);
+    flatAST* flat = loadFlatASTCache(cachePath, sourceSize, sourceHash);
+    endPhase(NULL);
+    if(flat == NULL) {
+        return NULL;
+    }
+    if(verbose) {
+        printf("SUCCESS: AST Loaded From %s\n", cachePath);
+    }
+
+    startPhase("createLLVMModelFromFlatAST", NULL);
+    LLVMModuleRef llvm_ir = createLLVMModelFromFlatAST(flat, compilation->source, compilation->llvmContext);
+    endPhase(llvm_ir);
+    freeFlatAST(flat);
+    return llvm_ir;
+}
+
+/* compiles every (source, dest) pair in one process, on a pool of threads if there is more than one
+ * prints the number of files compiled per second and returns the number of failures
+ */
+int compileBatch(vector<pair<string, string>>* jobs, int numThreads) {
+    assert(jobs != NULL);
+    assert(numThreads > 0);
+
+    vector<compilationContext> compilations(jobs->size());
+    for(int i = 0; i < (int) jobs->size(); i++) {
+        compilations[i].source = (char*) (*jobs)[i].first.c_str();
+        compilations[i].dest = (char*) (*jobs)[i].second.c_str();
+        compilations[i].llvmContext = NULL;
+        compilations[i].success = false;
     }
-}
\ No newline at end of file
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if(numThreads == 1) {
+        // a single thread shares the global LLVM context across files
+        threadContext = LLVMGetGlobalContext();
+        for(int i = 0; i < (int) compilations.size(); i++) {
+            compileTask(&compilations[i]);
+        }
+    } else {
+        threadPool* pool = createThreadPool(numThreads, startWorker, exitWorker);
+        for(int i = 0; i < (int) compilations.size(); i++) {
+            submitTask(pool, compileTask, &compilations[i]);
+        }
+        waitForTasks(pool);
+        destroyThreadPool(pool);
+
+        // the workers timed their phases in their own reports
+        vector<vector<timeReportEntry>>::iterator it = workerReports.begin();
+        while(it != workerReports.end()) {
+            mergeTimeReport(*it);
+            it++;
+        }
+        workerReports.clear();
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = elapsedMs(start, end) / 1000.0;
+
+    int failures = 0;
+    for(int i = 0; i < (int) compilations.size(); i++) {
+        if(!compilations[i].success) {
+            failures++;
+        }
+    }
+
+    int compiled = jobs->size() - failures;
+    printf("SUCCESS: Compiled %d of %d files in %.3f s on %d thread%s (%.1f files/second)\n",
+        compiled, (int) jobs->size(), seconds, numThreads, (numThreads == 1) ? "" : "s",
+        (seconds > 0) ? jobs->size() / seconds : 0.0);
+
+    return failures;
+}
+
+/* compiles a single file of a batch in the LLVM context of the running thread */
+void compileTask(void* arg) {
+    compilationContext* compilation = (compilationContext*) arg;
+    compilation->llvmContext = threadContext;
+    compilation->success = compileFile(compilation);
+    if(!compilation->success) {
+        printf("FAILURE: %s\n", compilation->source);
+    }
+}
+
+/* gives a worker thread its own LLVM context */
+void startWorker() {
+    threadContext = LLVMContextCreate();
+}
+
+/* hands the worker's time report to the main thread and frees its LLVM context */
+void exitWorker() {
+    if(timeReportEnabled()) {
+        lock_guard<mutex> guard(reportLock);
+        workerReports.push_back(getTimeReport());
+    }
+
+    LLVMContextDispose(threadContext);
+    threadContext = NULL;
+}
+
+/* appends the compilations listed in a manifest to the jobs
+ * each non-empty line holds a source path optionally followed by its output path,
+ * and lines starting with '#' are comments
+ * returns false if the manifest could not be read
+ */
+bool readManifest(char* filename, vector<pair<string, string>>* jobs) {
+    assert(filename != NULL && jobs != NULL);
+
+    FILE* manifest = fopen(filename, "r");
+    if(manifest == NULL) {
+        printf("FAILURE: Could not open manifest %s\n", filename);
+        return false;
+    }
+
+    char line[4096];
+    char source[4096];
+    char dest[4096];
+    while(fgets(line, sizeof(line), manifest) != NULL) {
+        int fields = sscanf(line, "%4095s %4095s", source, dest);
+        if(fields <= 0 || source[0] == '#') {
+            continue;
+        }
+
+        string destination = (fields == 2) ? string(dest) : defaultDestination(string(source));
+        jobs->push_back(make_pair(string(source), destination));
+    }
+
+    fclose(manifest);
+    return true;
+}
+
+/* returns the source path with its .c extension replaced by .s */
+string defaultDestination(string source) {
+    if(source.size() > 2 && source.compare(source.size() - 2, 2, ".c") == 0) {
+        return source.substr(0, source.size() - 2) + ".s";
+    }
+    return source + ".s";
+}
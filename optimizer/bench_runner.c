@@ -0,0 +1,46 @@
+/*
+ * This is the runner runtime_bench links the generated assembly of a source with, which calls
+ * func the given number of times and prints a checksum of everything it printed and returned,
+ * and the time per call in ns
+ * read gives the same sequence of small numbers on every run, so both builds see the same input
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+extern int func(int);
+
+unsigned checksum = 0;
+int reads = 0;
+
+void print(int n){
+	checksum = checksum * 31 + n;
+}
+
+int read(){
+	reads++;
+	return (reads * 37) % 23 - 5;
+}
+
+int main(int argc, char** argv){
+
+	// bench_runner [calls] [argument]
+	int calls = (argc > 1) ? atoi(argv[1]) : 1000;
+	int arg = (argc > 2) ? atoi(argv[2]) : 10;
+
+	// a program that loops on its input forever is given up on
+	alarm(10);
+
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(int i = 0; i < calls; i++) {
+		checksum = checksum * 31 + func(arg);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+	printf("%u %.1f\n", checksum, ns / calls);
+	return 0;
+}
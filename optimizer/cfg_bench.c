@@ -0,0 +1,208 @@
+/*
+ * This is a benchmark program for the control flow graph which builds a function with tens of
+ * thousands of blocks (diamonds, loops, chains of blocks to merge and unreachable blocks) and times
+ * building its CFG, the block optimizations of the IR builder, the analyses of the pass manager
+ * and the optimizer's dataflow on it
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <time.h>
+#include <llvm-c/Core.h>
+#include <vector>
+#include "../llvm_ir_builder/llvm_gen.h"
+#include "../helper/helper_functions.h"
+#include "../helper/cfg.h"
+#include "llvm_optimizations.h"
+#include "pass_manager.h"
+#include "../helper/elapsed_time.h"
+using namespace std;
+
+/* FUNCTION PROTOTYPES */
+/* ------------------- */
+LLVMModuleRef blockHeavyModule(LLVMContextRef context, int numUnits, int numVars);
+int countBlocks(LLVMModuleRef mod);
+int countInstructions(LLVMModuleRef mod);
+
+
+/* MAIN */
+/* ---- */
+
+int main(int argc, char** argv){
+
+    // cfg_bench [units of 5 blocks] [variables] [repeats]
+    int numUnits = (argc > 1) ? atoi(argv[1]) : 10000;
+    int numVars = (argc > 2) ? atoi(argv[2]) : 8;
+    int repeats = (argc > 3) ? atoi(argv[3]) : 5;
+    assert(numUnits > 0 && numVars > 0 && repeats > 0);
+
+    LLVMContextRef context = LLVMContextCreate();
+    LLVMModuleRef mod = blockHeavyModule(context, numUnits, numVars);
+    LLVMValueRef func = LLVMGetFirstFunction(mod);
+    printf("blocks: %d, instructions: %d\n", countBlocks(mod), countInstructions(mod));
+
+    // the best time of building the graphs of the function both ways
+    double setMs = -1;
+    double csrMs = -1;
+    for(int r = 0; r < repeats; r++) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        array<unordered_map<LLVMBasicBlockRef, set<LLVMBasicBlockRef>>, 2> graphs = generateGraphs(func);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if(setMs < 0 || elapsedMs(start, end) < setMs) {
+            setMs = elapsedMs(start, end);
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        controlFlowGraph cfg = buildControlFlowGraph(func);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if(csrMs < 0 || elapsedMs(start, end) < csrMs) {
+            csrMs = elapsedMs(start, end);
+        }
+        assert(cfg.blocks.size() == graphs[0].size());
+    }
+    printf("set graphs:              %10.2f ms\n", setMs);
+    printf("CSR graph:               %10.2f ms\n", csrMs);
+
+    // the unreachable blocks are removed and the chains merged
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    optimizeLLVMBasicBlocks(mod);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("optimizeLLVMBasicBlocks: %10.2f ms (%d blocks left)\n", elapsedMs(start, end), countBlocks(mod));
+
+    const char* names[] = { "cfg", "dominators", "frontiers", "postdominators", "loops" };
+    analysis_type types[] = { analysis_cfg, analysis_dominators, analysis_frontiers, analysis_postdominators, analysis_loops };
+    for(int i = 0; i < 5; i++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        requireAnalysis(func, types[i]);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        printf("analysis %-15s %10.2f ms\n", names[i], elapsedMs(start, end));
+    }
+    invalidateAnalyses(func);
+
+    // reaching definitions over every store of the function
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    constantPropagation(func);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("constantPropagation:     %10.2f ms\n", elapsedMs(start, end));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    optimizeLLVM(mod);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("optimizeLLVM:            %10.2f ms (%d instructions left)\n", elapsedMs(start, end), countInstructions(mod));
+
+    LLVMDisposeModule(mod);
+    LLVMContextDispose(context);
+    return 0;
+}
+
+/* builds a module with a single function made of units of five blocks: a diamond branching on
+ * a variable, whose join block leads to a chain block that can be merged into it, and a block
+ * nothing branches to. every sixteenth unit loops back to the one eight units before it
+ */
+LLVMModuleRef blockHeavyModule(LLVMContextRef context, int numUnits, int numVars) {
+    LLVMModuleRef mod = LLVMModuleCreateWithNameInContext("", context);
+    LLVMTypeRef int32 = LLVMInt32TypeInContext(context);
+    LLVMTypeRef param_types[] = { int32 };
+    LLVMValueRef func = LLVMAddFunction(mod, "bench", LLVMFunctionType(int32, param_types, 1, 0));
+
+    LLVMBasicBlockRef entry = LLVMAppendBasicBlockInContext(context, func, "");
+    LLVMBuilderRef builder = LLVMCreateBuilderInContext(context);
+    LLVMPositionBuilderAtEnd(builder, entry);
+
+    // allocate and initialize the variables
+    vector<LLVMValueRef> vars;
+    for(int i = 0; i < numVars; i++) {
+        LLVMValueRef var = LLVMBuildAlloca(builder, int32, "");
+        LLVMBuildStore(builder, LLVMConstInt(int32, i, false), var);
+        vars.push_back(var);
+    }
+
+    // create all of the blocks up front so back edges can be built
+    vector<LLVMBasicBlockRef> blocks;
+    for(int i = 0; i < numUnits * 5; i++) {
+        blocks.push_back(LLVMAppendBasicBlockInContext(context, func, ""));
+    }
+    LLVMBasicBlockRef exit = LLVMAppendBasicBlockInContext(context, func, "");
+    LLVMBuildBr(builder, blocks[0]);
+
+    for(int u = 0; u < numUnits; u++) {
+        LLVMBasicBlockRef* unit = &blocks[u * 5];
+        LLVMBasicBlockRef next = (u + 1 < numUnits) ? blocks[(u + 1) * 5] : exit;
+        LLVMValueRef var = vars[u % numVars];
+
+        // branch on the variable
+        LLVMPositionBuilderAtEnd(builder, unit[0]);
+        LLVMValueRef load = LLVMBuildLoad2(builder, int32, var, "");
+        LLVMValueRef cond = LLVMBuildICmp(builder, LLVMIntSLT, load, LLVMGetParam(func, 0), "");
+        LLVMBuildCondBr(builder, cond, unit[1], unit[2]);
+
+        // both sides store to it
+        for(int side = 1; side <= 2; side++) {
+            LLVMPositionBuilderAtEnd(builder, unit[side]);
+            LLVMValueRef value = LLVMBuildAdd(builder, load, LLVMConstInt(int32, side, false), "");
+            LLVMBuildStore(builder, value, var);
+            LLVMBuildBr(builder, unit[3]);
+        }
+
+        // the join falls through to the chain block
+        LLVMPositionBuilderAtEnd(builder, unit[3]);
+        LLVMBuildStore(builder, LLVMBuildLoad2(builder, int32, var, ""), vars[(u + 1) % numVars]);
+        LLVMBuildBr(builder, unit[4]);
+
+        LLVMPositionBuilderAtEnd(builder, unit[4]);
+        if(u % 16 == 15) {
+            LLVMValueRef counter = LLVMBuildLoad2(builder, int32, vars[0], "");
+            LLVMValueRef loop = LLVMBuildICmp(builder, LLVMIntSLT, counter, LLVMGetParam(func, 0), "");
+            LLVMBuildCondBr(builder, loop, blocks[(u - 8) * 5], next);
+        } else {
+            LLVMBuildBr(builder, next);
+        }
+    }
+
+    // blocks nothing branches to, placed among the others
+    for(int u = 0; u < numUnits; u++) {
+        LLVMBasicBlockRef unreachable = LLVMInsertBasicBlockInContext(context, blocks[u * 5 + 4], "");
+        LLVMPositionBuilderAtEnd(builder, unreachable);
+        LLVMBuildBr(builder, blocks[u * 5 + 4]);
+    }
+
+    LLVMPositionBuilderAtEnd(builder, exit);
+    LLVMBuildRet(builder, LLVMBuildLoad2(builder, int32, vars[0], ""));
+    LLVMDisposeBuilder(builder);
+
+    return mod;
+}
+
+/* counts all of the blocks in a module */
+int countBlocks(LLVMModuleRef mod) {
+    int count = 0;
+    for(LLVMValueRef function = LLVMGetFirstFunction(mod);
+        function;
+        function = LLVMGetNextFunction(function)) {
+        count += LLVMCountBasicBlocks(function);
+    }
+    return count;
+}
+
+/* counts all of the instructions in a module */
+int countInstructions(LLVMModuleRef mod) {
+    int count = 0;
+    for(LLVMValueRef function = LLVMGetFirstFunction(mod);
+        function;
+        function = LLVMGetNextFunction(function)) {
+        for(LLVMBasicBlockRef bb = LLVMGetFirstBasicBlock(function);
+            bb;
+            bb = LLVMGetNextBasicBlock(bb)) {
+            for(LLVMValueRef instruction = LLVMGetFirstInstruction(bb);
+                instruction;
+                instruction = LLVMGetNextInstruction(instruction)) {
+                count++;
+            }
+        }
+    }
+    return count;
+}
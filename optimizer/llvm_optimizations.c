@@ -5,135 +5,153 @@
 #include <stdio.h>
 #include <string.h>
 #include "llvm_optimizations.h"
-#include "../helper/helper_functions.h"
+#include "pass_manager.h"
+#include "../helper/bit_vector.h"
+#include "../helper/dataflow.h"
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <set>
+#include <algorithm>
 //#define NDEBUG
 #include <cassert>
 
 using namespace std;
 
+/* TYPES */
+/* ----- */
+
+// hashable form of a pure instruction - two instructions with the same key compute the same value
+struct expressionKey {
+    LLVMOpcode opcode;
+    int predicate; // -1 if not a compare
+    LLVMValueRef lhs;
+    LLVMValueRef rhs;
+
+    bool operator==(const expressionKey& other) const {
+        return opcode == other.opcode && predicate == other.predicate && lhs == other.lhs && rhs == other.rhs;
+    }
+};
+
+struct expressionKeyHash {
+    size_t operator()(const expressionKey& key) const {
+        size_t h = hash<int>()(key.opcode) * 31 + hash<int>()(key.predicate);
+        h = h * 1000003 ^ hash<LLVMValueRef>()(key.lhs);
+        h = h * 1000003 ^ hash<LLVMValueRef>()(key.rhs);
+        return h;
+    }
+};
+
 /* FUNCTION PROTOTYPES */
 /* ------------------- */
-void getAllFunctionGraphs(LLVMModuleRef mod);
-void getAllOperands(LLVMModuleRef mod);
-bool runLocalOptimizations(LLVMModuleRef mod, bool (*opt)(LLVMBasicBlockRef bb));
+void runOptimizer(LLVMModuleRef mod, bool promote, bool hoist);
 bool runGlobalOptimizations(LLVMModuleRef mod, bool (*opt)(LLVMValueRef func));
 bool eraseInstructions(vector<LLVMValueRef>* instructions);
 
-void generateStoreSet(LLVMValueRef func);
-void generateGen(LLVMValueRef func);
-void generateKill(LLVMValueRef func);
-void computeInOut(LLVMValueRef func);
-    void generateIn(LLVMBasicBlockRef bb);
-    void generateOut(LLVMBasicBlockRef bb);
-bool performConstantProp(LLVMValueRef func);
+bool trackAllInstructions(LLVMValueRef func);
+void replaceAllUses(LLVMValueRef instruction, LLVMValueRef value);
+void eraseInstruction(LLVMValueRef instruction);
+
+bool isPromotable(LLVMValueRef alloca);
+void findVariableAccesses();
+void computeLiveness();
+void placePhis(int var);
+void renameVariables(int root, vector<LLVMValueRef>* instructionsToErase);
+void removeTrivialPhis(vector<LLVMValueRef>& candidates);
+
+void valueNumberBlock(LLVMBasicBlockRef bb, vector<expressionKey>* scope, vector<LLVMValueRef>* instructionsToErase);
+expressionKey getExpressionKey(LLVMValueRef instruction);
+
+int findHoistTarget(LLVMValueRef instruction, int loop);
+bool isLoopInvariant(LLVMValueRef instruction, int loop);
+
+void generateStoreSet();
+void generateGen();
+void generateKill();
+void computeInOut();
+bool performConstantProp();
 
 /* GLOBAL VARIABLES */
 /* ---------------- */
-unordered_map<LLVMValueRef, int> allOperands;
-unordered_map<LLVMBasicBlockRef, set<LLVMValueRef>> gen;
-unordered_map<LLVMBasicBlockRef, set<LLVMValueRef>> kill;
-unordered_map<LLVMBasicBlockRef, set<LLVMValueRef>> in;
-unordered_map<LLVMBasicBlockRef, set<LLVMValueRef>> out;
-unordered_map<LLVMValueRef, set<LLVMValueRef>> storeSet;
-
-unordered_map<LLVMValueRef, array<unordered_map<LLVMBasicBlockRef, set<LLVMBasicBlockRef>>, 2>> graphs;
+// use tracking - per function, the instructions that lost a use (may now be dead)
+// or gained a constant operand (may now fold) since they were last visited
+thread_local unordered_map<LLVMValueRef, unordered_set<LLVMValueRef>> deadCandidates;
+thread_local unordered_map<LLVMValueRef, unordered_set<LLVMValueRef>> foldCandidates;
+
+// cached analyses of the function being optimized
+thread_local functionAnalyses* analyses;
+
+// promotion - the allocas being promoted (numbered as variables), the blocks storing to each and
+// loading it before any store, and the variable of each phi added
+thread_local vector<LLVMValueRef> promotedAllocas;
+thread_local unordered_map<LLVMValueRef, int> variableIndex;
+thread_local vector<vector<int>> definingBlocks;
+thread_local vector<vector<int>> usingBlocks;
+thread_local vector<bitVector> liveInSets; // per block, the variables live on entry to it
+thread_local unordered_map<LLVMValueRef, int> phiVariable;
+
+// value numbering - from expression to the instruction that first computed it in a dominating block
+thread_local unordered_map<expressionKey, LLVMValueRef, expressionKeyHash> valueNumbers;
+
+// reaching definitions - stores are numbered once per function
+// so that the sets are bit vectors indexed by store number
+thread_local vector<LLVMValueRef> stores;
+thread_local unordered_map<LLVMValueRef, int> storeIndex;
+thread_local unordered_map<LLVMValueRef, bitVector> storeSet; // from address to its stores
+thread_local vector<bitVector> genSets;
+thread_local vector<bitVector> killSets;
+thread_local vector<bitVector> inSets;
+thread_local vector<bitVector> outSets;
 
 /* FUNCTIONS */
 /* --------- */
 
 /* runs all of the necessary optimizations on the LLVMModule such that
- * as many unnecessary instructions as possible are eliminated
+ * as many unnecessary instructions as possible are eliminated,
+ * first promoting the variables the builder keeps in memory to registers
  */
 void optimizeLLVM(LLVMModuleRef mod) {
-    assert(mod != NULL);
-
-    getAllFunctionGraphs(mod);
-
-    // run constant folding and constant propagation until no more changes
-    bool changed = true;
-    while(changed) {
-        changed = false;
-        allOperands.clear();
-        getAllOperands(mod);
-        changed |= runLocalOptimizations(mod, deadCodeElimination);
-        changed |= runLocalOptimizations(mod, commonSubexpressionElimination);
-        changed |= runLocalOptimizations(mod, constantFolding);
-        changed |= runGlobalOptimizations(mod, constantPropagation);
-    }
-
+    runOptimizer(mod, true, false);
 }
 
-/* generate all of the graphs for each function and put it in a map */
-void getAllFunctionGraphs(LLVMModuleRef mod) {
-    // loop through all the functions
-    for(LLVMValueRef function = LLVMGetFirstFunction(mod);
-        function;
-        function = LLVMGetNextFunction(function)) {
-            // generate the graphs
-            graphs[function] = generateGraphs(function);
-    }
+/* runs the same optimizations as optimizeLLVM but leaves the variables in memory,
+ * to compare against the promoted code
+ */
+void optimizeLLVM_memory(LLVMModuleRef mod) {
+    runOptimizer(mod, false, false);
 }
 
-/* adds all instructions to the global set*/
-void getAllOperands(LLVMModuleRef mod) {
-    assert(mod != NULL);
-
-    // loop through all functions
-     for(LLVMValueRef function = LLVMGetFirstFunction(mod); 
-        function; 
-        function = LLVMGetNextFunction(function)) {
-
-        // loop through all basic blocks
-        for(LLVMBasicBlockRef basicBlock = LLVMGetFirstBasicBlock(function);
-            basicBlock;
-            basicBlock = LLVMGetNextBasicBlock(basicBlock)) {
-                
-            // loop through all instructions
-            for(LLVMValueRef instruction = LLVMGetFirstInstruction(basicBlock);
-                instruction;
-                instruction = LLVMGetNextInstruction(instruction)) {
-
-                // loop through operands and add to set
-                for(int i = 0; i < LLVMGetNumOperands(instruction); i++) {
-                    LLVMValueRef operand = LLVMGetOperand(instruction, i);
-
-                    // add to the count of that operand
-                    if(allOperands.count(operand) == 0) {
-                        allOperands[operand] = 0;
-                    }
-                    allOperands[operand]++;
-                }
-            }
-        }
-    }
+/* runs the same optimizations as optimizeLLVM and also hoists loop-invariant arithmetic
+ * out of loops, which only pays off for code that loops many times
+ */
+void optimizeLLVM_hoist(LLVMModuleRef mod) {
+    runOptimizer(mod, true, true);
 }
 
-/* iterates through all of the basic blocks in each function
- * runs the specified function and returns true if changes have been made
+/* runs the passes until they change nothing, promoting the allocas first
+ * and hoisting loop invariants if asked to
  */
-bool runLocalOptimizations(LLVMModuleRef mod, bool (*opt)(LLVMBasicBlockRef bb)) {
+void runOptimizer(LLVMModuleRef mod, bool promote, bool hoist) {
     assert(mod != NULL);
-    assert(opt != NULL);
 
-    bool changed = false; // bool to track if any changes have been made to instructions
+    // every instruction is visited by the first round, after that only changed ones are
+    deadCandidates.clear();
+    foldCandidates.clear();
+    runGlobalOptimizations(mod, trackAllInstructions);
 
-    // loop through functions
-    for(LLVMValueRef function =  LLVMGetFirstFunction(mod); 
-        function; 
-        function = LLVMGetNextFunction(function)) {
-
-        for(LLVMBasicBlockRef basicBlock = LLVMGetFirstBasicBlock(function);
-            basicBlock;
-            basicBlock = LLVMGetNextBasicBlock(basicBlock)) {
-                // run the passed optimization
-                changed |= (*opt)(basicBlock);
-        }
+    // run the passes until no more changes, skipping the functions a pass has nothing left to do on
+    clearPasses();
+    if(promote) {
+        addPass("promoteMemoryToRegisters", promoteMemoryToRegisters, {analysis_frontiers}, true);
     }
-
-    return changed;
+    addPass("deadCodeElimination", deadCodeElimination, {}, true);
+    addPass("commonSubexpressionElimination", commonSubexpressionElimination, {analysis_dominators}, true);
+    if(hoist) {
+        addPass("hoistLoopInvariants", hoistLoopInvariants, {analysis_loops}, true);
+    }
+    addPass("constantFolding", constantFolding, {}, true);
+    addPass("constantPropagation", constantPropagation, {analysis_cfg}, true);
+    runPasses(mod);
 }
 
 /* iterates through all of the basic blocks in each function
@@ -169,7 +187,7 @@ bool eraseInstructions(vector<LLVMValueRef>* instructions) {
         vector<LLVMValueRef>::iterator it = instructions->begin();
         while(it != instructions->end()) {
             assert(*it != NULL);
-            LLVMInstructionEraseFromParent(*it);
+            eraseInstruction(*it);
             it++;
         }
 
@@ -179,141 +197,104 @@ bool eraseInstructions(vector<LLVMValueRef>* instructions) {
     }
 }
 
-/* LOCAL OPTIMIZATION FUNCTIONS */
-/* ---------------------------- */
+/* USE TRACKING */
+/* ------------ */
 
-/* Finds pairs of instructions with the same opcode, and operands
- * If there is no modifier (store when opcode is load) of the operands between these instructions
- * then replace all uses of the second instruction with the first
+/* marks every instruction of the function to be visited by dead code elimination and folding
+ * and deletes any instructions that follow a return or branch
+ * returns true if any instructions were deleted
  */
-bool commonSubexpressionElimination(LLVMBasicBlockRef bb) {
-    assert(bb != NULL);
+bool trackAllInstructions(LLVMValueRef func) {
+    assert(func != NULL);
 
-    unordered_map<LLVMOpcode, vector<LLVMValueRef>> instructionsByOp; // from opcode to instruction
-    unordered_map<LLVMValueRef, LLVMValueRef> activeLoadInstructions; // from loaded var to load instruction
     vector<LLVMValueRef>* instructionsToErase = new vector<LLVMValueRef>(); // instructions to erase
 
-    // walk instructions
-    for (LLVMValueRef instruction = LLVMGetFirstInstruction(bb); 
-        instruction;
-  		instruction = LLVMGetNextInstruction(instruction)) {
-
-        // retrieve the opCode
-        LLVMOpcode opcode = LLVMGetInstructionOpcode(instruction);
-
-        // handle alloca case (don't do anything)
-        if(opcode == LLVMAlloca || opcode == LLVMCall) {
-            continue;
-        }
-
-        // handle store case (eliminate loads)
-        if(opcode == LLVMStore) {
-            assert(LLVMGetNumOperands(instruction) == 2);
-            LLVMValueRef addr = LLVMGetOperand(instruction, 1);
-
-            // if there is a load on the addr, erase it from the active loads
-            if(activeLoadInstructions.count(addr)) {
-                activeLoadInstructions.erase(addr);
-            }
-            continue;
-        }
+    for(LLVMBasicBlockRef bb = LLVMGetFirstBasicBlock(func);
+        bb;
+        bb = LLVMGetNextBasicBlock(bb)) {
 
-        // handle load case (check for common uses)
-        if(opcode == LLVMLoad) { // load instruction
-            assert(LLVMGetNumOperands(instruction) == 1);
-            LLVMValueRef addr = LLVMGetOperand(instruction, 0);
+        bool terminatorReached = false;
+        for (LLVMValueRef instruction = LLVMGetFirstInstruction(bb); 
+            instruction;
+            instruction = LLVMGetNextInstruction(instruction)) {
 
-            // if there is a load, use it
-            if(activeLoadInstructions.count(addr)) {
-                LLVMReplaceAllUsesWith(instruction, activeLoadInstructions[addr]);
+            // if we have hit a branch or return, delete deadcode
+            if(terminatorReached) {
                 instructionsToErase->push_back(instruction);
-            } else {
-                activeLoadInstructions[addr] = instruction;
+                continue;
             }
-            continue;
-        }
-
-        // check for common subexpressions
-
-        // if it is the first instruction of its opcode
-        if(!instructionsByOp.count(opcode)) {
-            vector<LLVMValueRef> instructions;
-            instructions.push_back(instruction);
-            instructionsByOp[opcode] = instructions;
-            continue;
-        }
 
-        // otherwise, loop through the instructions and look for common operands
-        vector<LLVMValueRef> instructions = instructionsByOp[opcode];
-        vector<LLVMValueRef>::iterator it = instructions.begin();
-        while(it != instructions.end()) {
-            assert(*it != NULL);
-            assert(LLVMGetInstructionOpcode(instruction) == LLVMGetInstructionOpcode(*it));
-            assert(LLVMGetNumOperands(instruction) == LLVMGetNumOperands(*it));
-
-            // check that all the operands are the same
-            bool sameOperands = true;
-            for(int i = 0; i < LLVMGetNumOperands(instruction); i++) {
-                if(LLVMGetOperand(instruction, i) != LLVMGetOperand(*it, i)) {
-                    sameOperands = false;
-                    break;
-                }
-            }
+            deadCandidates[func].insert(instruction);
+            foldCandidates[func].insert(instruction);
 
-            // if all the operands are the same, replace the uses
-            if(sameOperands) {
-                LLVMReplaceAllUsesWith(instruction, *it);
-                instructionsToErase->push_back(instruction);
-                break;
+            // if we have a branch or return, enable flag to delete deadcode
+            LLVMOpcode opcode = LLVMGetInstructionOpcode(instruction);
+            if(opcode == LLVMRet || opcode == LLVMBr) {
+                terminatorReached = true;
             }
-
-            it++;
         }
     }
 
-    // delete all marked instructions
     bool changed = eraseInstructions(instructionsToErase);
     delete(instructionsToErase);
 
     return changed;
 }
 
-/* Finds instructions that have no use
- * these instructions will follow a return or branch
- * or never be used in the instruction list
+/* replaces all uses of the instruction with the value
+ * when the value is a constant, the users may now fold so they are revisited
  */
-bool deadCodeElimination(LLVMBasicBlockRef bb) {
-    assert(bb != NULL);
+void replaceAllUses(LLVMValueRef instruction, LLVMValueRef value) {
+    assert(instruction != NULL && value != NULL);
 
-    bool terminatorReached = false;
-    vector<LLVMValueRef>* instructionsToErase = new vector<LLVMValueRef>(); // instructions to erase
-
-    // delete any instructions after terminators
-    for (LLVMValueRef instruction = LLVMGetFirstInstruction(bb); 
-        instruction;
-  		instruction = LLVMGetNextInstruction(instruction)) {
-
-        // if we have hit a branch or return, delete deadcode
-        if(terminatorReached) {
-            instructionsToErase->push_back(instruction);
+    if(LLVMIsAConstant(value)) {
+        LLVMValueRef func = LLVMGetBasicBlockParent(LLVMGetInstructionParent(instruction));
+        for(LLVMUseRef use = LLVMGetFirstUse(instruction); use; use = LLVMGetNextUse(use)) {
+            foldCandidates[func].insert(LLVMGetUser(use));
         }
+    }
 
-        // retrieve the opCode
-        LLVMOpcode opcode = LLVMGetInstructionOpcode(instruction);
+    LLVMReplaceAllUsesWith(instruction, value);
+}
 
-        // if we have a branch or return, enable flag to delete deadcode
-        if(opcode == LLVMRet || opcode == LLVMBr) {
-            terminatorReached = true;
+/* erases a single instruction, forgetting it in the use tracking
+ * its operands lose a use, so they may now be dead and are revisited
+ */
+void eraseInstruction(LLVMValueRef instruction) {
+    assert(instruction != NULL);
+
+    LLVMValueRef func = LLVMGetBasicBlockParent(LLVMGetInstructionParent(instruction));
+    deadCandidates[func].erase(instruction);
+    foldCandidates[func].erase(instruction);
+    recordErasedInstruction();
+
+    for(int i = 0; i < LLVMGetNumOperands(instruction); i++) {
+        LLVMValueRef operand = LLVMGetOperand(instruction, i);
+        if(operand != NULL && LLVMIsAInstruction(operand)) {
+            deadCandidates[func].insert(operand);
         }
     }
 
-    // delete all instructions that are not used - deadcode
+    LLVMInstructionEraseFromParent(instruction);
+}
 
-    // continue to delete deadcode created by deleting deadcode until no more
-    // walk the instructions backwards to do it in a single iteration
-    for (LLVMValueRef instruction = LLVMGetLastInstruction(bb); 
-        instruction;
-        instruction = LLVMGetPreviousInstruction(instruction)) {
+/* LOCAL OPTIMIZATION FUNCTIONS */
+/* ---------------------------- */
+
+/* Finds instructions that have no use, using LLVM's use lists
+ * only instructions that lost a use since they were last visited are checked,
+ * and deleting an instruction makes its operands candidates in turn
+ */
+bool deadCodeElimination(LLVMValueRef func) {
+    assert(func != NULL);
+
+    bool changed = false;
+    unordered_set<LLVMValueRef>& candidates = deadCandidates[func];
+
+    while(candidates.size() != 0) {
+        LLVMValueRef instruction = *candidates.begin();
+        candidates.erase(candidates.begin());
+        recordRevisitedInstructions(1);
 
         // retrieve the opCode
         LLVMOpcode opcode = LLVMGetInstructionOpcode(instruction);
@@ -322,41 +303,30 @@ bool deadCodeElimination(LLVMBasicBlockRef bb) {
             continue;
         }
 
-        // if we haven't used this operand
-        if(allOperands.count(instruction) == 0) {
-            // flag the instruction to delete
-            instructionsToErase->push_back(instruction);
-            for(int i = 0; i < LLVMGetNumOperands(instruction); i++) {
-                LLVMValueRef operandToUnuse = LLVMGetOperand(instruction, i);
-                assert(allOperands.count(operandToUnuse) != 0);
-
-                // remove its operands counts from the operand map
-                allOperands[operandToUnuse]--;
-                if(allOperands[operandToUnuse] == 0) {
-                    allOperands.erase(operandToUnuse);
-                }
-            }
+        // if nothing uses the instruction, delete it
+        if(LLVMGetFirstUse(instruction) == NULL) {
+            eraseInstruction(instruction);
+            changed = true;
         }
     }
 
-    bool changed = eraseInstructions(instructionsToErase);
-    delete(instructionsToErase);
-
     return changed;
 }
 
 /* Finds instructions with opcode +, -, * and all operands are constants
  * folds the operation into a single constant
+ * only instructions that gained a constant operand since they were last visited are checked
  */
-bool constantFolding(LLVMBasicBlockRef bb) {
-    assert(bb != NULL);
+bool constantFolding(LLVMValueRef func) {
+    assert(func != NULL);
 
-    vector<LLVMValueRef>* instructionsToErase = new vector<LLVMValueRef>(); // instructions to erase
+    bool changed = false;
+    unordered_set<LLVMValueRef>& candidates = foldCandidates[func];
 
-    // walk instructions
-    for (LLVMValueRef instruction = LLVMGetFirstInstruction(bb); 
-        instruction;
-  		instruction = LLVMGetNextInstruction(instruction)) {
+    while(candidates.size() != 0) {
+        LLVMValueRef instruction = *candidates.begin();
+        candidates.erase(candidates.begin());
+        recordRevisitedInstructions(1);
 
         // retrieve the opCode
         LLVMOpcode opcode = LLVMGetInstructionOpcode(instruction);
@@ -377,39 +347,540 @@ bool constantFolding(LLVMBasicBlockRef bb) {
         }
 
         // fold the constants
+        LLVMValueRef folded = NULL;
         switch(opcode) {
             case(LLVMAdd): {
-                LLVMValueRef add = LLVMConstAdd(op1, op2);
-                LLVMReplaceAllUsesWith(instruction, add);
-                instructionsToErase->push_back(instruction);
+                folded = LLVMConstAdd(op1, op2);
                 break;
             }
 
             case(LLVMSub): {
-                LLVMValueRef sub = LLVMConstSub(op1, op2);
-                LLVMReplaceAllUsesWith(instruction, sub);
-                instructionsToErase->push_back(instruction);
+                folded = LLVMConstSub(op1, op2);
                 break;
             }
 
             case(LLVMMul): {
-                LLVMValueRef mul = LLVMConstMul(op1, op2);
-                LLVMReplaceAllUsesWith(instruction, mul);
-                instructionsToErase->push_back(instruction);
+                folded = LLVMConstMul(op1, op2);
                 break;
             }
 
             case(LLVMICmp): {
                 LLVMIntPredicate pred = LLVMGetICmpPredicate(instruction);
-                LLVMValueRef cmp = LLVMConstICmp(pred, op1, op2);
-                LLVMReplaceAllUsesWith(instruction, cmp);
-                instructionsToErase->push_back(instruction);
+                folded = LLVMConstICmp(pred, op1, op2);
                 break;
             }
 
             default: {} // ignore div
         }
 
+        // replace and delete the folded instruction
+        if(folded != NULL) {
+            replaceAllUses(instruction, folded);
+            eraseInstruction(instruction);
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+/* GLOBAL OPTIMIZATION INSTRUCTIONS */
+/* -------------------------------- */
+
+/* promotes the scalar allocas of the entry block that are only loaded and stored to SSA values
+ * (mem2reg): a phi is placed in the iterated dominance frontier of the blocks storing to a variable,
+ * but only where the variable is live on entry, then a walk of the dominator tree replaces each
+ * load by the value last stored or the phi on the way to it, and the stores and allocas are erased
+ * a variable loaded before any store is undef there, and phis that only choose one value are removed
+ */
+bool promoteMemoryToRegisters(LLVMValueRef func) {
+    assert(func != NULL);
+
+    LLVMBasicBlockRef entry = LLVMGetFirstBasicBlock(func);
+    if(!entry) {
+        return false;
+    }
+
+    promotedAllocas.clear();
+    variableIndex.clear();
+    for(LLVMValueRef instruction = LLVMGetFirstInstruction(entry);
+        instruction;
+        instruction = LLVMGetNextInstruction(instruction)) {
+
+        if(isPromotable(instruction)) {
+            variableIndex[instruction] = promotedAllocas.size();
+            promotedAllocas.push_back(instruction);
+        }
+    }
+    if(promotedAllocas.empty()) {
+        return false;
+    }
+
+    analyses = requireAnalysis(func, analysis_frontiers);
+    findVariableAccesses();
+    computeLiveness();
+
+    phiVariable.clear();
+    for(int var = 0; var < (int) promotedAllocas.size(); var++) {
+        placePhis(var);
+    }
+
+    // the entry's tree first, then the unreachable blocks, which root trees of their own
+    vector<LLVMValueRef>* instructionsToErase = new vector<LLVMValueRef>(); // loads and stores to erase
+    for(int b = 0; b < (int) analyses->blocks.size(); b++) {
+        if(analyses->idom[b] == -1) {
+            renameVariables(b, instructionsToErase);
+        }
+    }
+    eraseInstructions(instructionsToErase);
+    delete(instructionsToErase);
+
+    vector<LLVMValueRef>::iterator it = promotedAllocas.begin();
+    while(it != promotedAllocas.end()) {
+        eraseInstruction(*it);
+        it++;
+    }
+
+    // the phis may be left unused, and are checked for removal as any other instruction
+    vector<LLVMValueRef> candidates;
+    for(unordered_map<LLVMValueRef, int>::iterator phi = phiVariable.begin(); phi != phiVariable.end(); phi++) {
+        candidates.push_back(phi->first);
+        deadCandidates[func].insert(phi->first);
+    }
+    removeTrivialPhis(candidates);
+
+    promotedAllocas.clear();
+    variableIndex.clear();
+    phiVariable.clear();
+    liveInSets.clear();
+    return true;
+}
+
+/* checks if an alloca holds a single integer that is only loaded and stored to,
+ * so that nothing can reach it but the loads and stores being replaced
+ */
+bool isPromotable(LLVMValueRef alloca) {
+    if(LLVMGetInstructionOpcode(alloca) != LLVMAlloca) {
+        return false;
+    }
+    LLVMTypeRef type = LLVMGetAllocatedType(alloca);
+    if(LLVMGetTypeKind(type) != LLVMIntegerTypeKind) {
+        return false;
+    }
+
+    for(LLVMUseRef use = LLVMGetFirstUse(alloca); use; use = LLVMGetNextUse(use)) {
+        LLVMValueRef user = LLVMGetUser(use);
+        LLVMOpcode opcode = LLVMGetInstructionOpcode(user);
+        if(opcode == LLVMLoad) {
+            if(LLVMTypeOf(user) != type) {
+                return false;
+            }
+        } else if(opcode == LLVMStore) {
+            // storing the address itself lets it escape
+            if(LLVMGetOperand(user, 0) == alloca || LLVMTypeOf(LLVMGetOperand(user, 0)) != type) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* records for every variable the blocks that store to it, and the blocks that load it
+ * before storing to it, which is where it can be live on entry
+ */
+void findVariableAccesses() {
+    int numVariables = promotedAllocas.size();
+    definingBlocks.assign(numVariables, vector<int>());
+    usingBlocks.assign(numVariables, vector<int>());
+    vector<int> storedIn(numVariables, -1); // last block each variable was stored in
+    vector<int> usedIn(numVariables, -1); // last block each variable was recorded as used in
+
+    for(int b = 0; b < (int) analyses->blocks.size(); b++) {
+        for(LLVMValueRef instruction = LLVMGetFirstInstruction(analyses->blocks[b]);
+            instruction;
+            instruction = LLVMGetNextInstruction(instruction)) {
+
+            LLVMOpcode opcode = LLVMGetInstructionOpcode(instruction);
+            if(opcode != LLVMLoad && opcode != LLVMStore) {
+                continue;
+            }
+            LLVMValueRef addr = LLVMGetOperand(instruction, (opcode == LLVMLoad) ? 0 : 1);
+            unordered_map<LLVMValueRef, int>::iterator var = variableIndex.find(addr);
+            if(var == variableIndex.end()) {
+                continue;
+            }
+
+            int v = var->second;
+            if(opcode == LLVMStore && storedIn[v] != b) {
+                storedIn[v] = b;
+                definingBlocks[v].push_back(b);
+            } else if(opcode == LLVMLoad && storedIn[v] != b && usedIn[v] != b) {
+                usedIn[v] = b;
+                usingBlocks[v].push_back(b);
+            }
+        }
+    }
+}
+
+/* solves liveness of the variables as a backward dataflow problem, where a block generates
+ * the variables it loads before storing to and kills the ones it stores to
+ */
+void computeLiveness() {
+    int numBlocks = analyses->blocks.size();
+    int numVariables = promotedAllocas.size();
+    vector<bitVector> loadsFirst(numBlocks, createBitVector(numVariables));
+    vector<bitVector> storesTo(numBlocks, createBitVector(numVariables));
+    for(int var = 0; var < numVariables; var++) {
+        vector<int>::iterator it = usingBlocks[var].begin();
+        while(it != usingBlocks[var].end()) {
+            setBit(&loadsFirst[*it], var);
+            it++;
+        }
+        it = definingBlocks[var].begin();
+        while(it != definingBlocks[var].end()) {
+            setBit(&storesTo[*it], var);
+            it++;
+        }
+    }
+
+    dataflowProblem liveness;
+    liveness.direction = dataflow_backward;
+    liveness.entry = 0;
+    liveness.predecessors = &analyses->predecessors;
+    liveness.successors = &analyses->successors;
+    liveness.gen = &loadsFirst;
+    liveness.kill = &storesTo;
+    solveDataflow(&liveness);
+
+    liveInSets.swap(liveness.in);
+}
+
+/* adds an empty phi for the variable to every block of the iterated dominance frontier
+ * of its stores where it is live on entry
+ */
+void placePhis(int var) {
+    int numBlocks = analyses->blocks.size();
+    if(definingBlocks[var].empty() || usingBlocks[var].empty()) {
+        return;
+    }
+
+    vector<bool> defines(numBlocks, false);
+    vector<int>::iterator it = definingBlocks[var].begin();
+    while(it != definingBlocks[var].end()) {
+        defines[*it] = true;
+        it++;
+    }
+
+    // a phi is a store too, so its block's frontier gets phis in turn
+    vector<bool> hasPhi(numBlocks, false);
+    LLVMTypeRef type = LLVMGetAllocatedType(promotedAllocas[var]);
+    LLVMBuilderRef builder = LLVMCreateBuilderInContext(LLVMGetTypeContext(type));
+    vector<int> worklist(definingBlocks[var]);
+    while(!worklist.empty()) {
+        int b = worklist.back();
+        worklist.pop_back();
+
+        vector<int>::iterator frontierIt = analyses->frontiers[b].begin();
+        while(frontierIt != analyses->frontiers[b].end()) {
+            int f = *frontierIt;
+            frontierIt++;
+            if(hasPhi[f] || !testBit(&liveInSets[f], var)) {
+                continue;
+            }
+            hasPhi[f] = true;
+
+            LLVMBasicBlockRef block = analyses->blocks[f];
+            LLVMValueRef first = LLVMGetFirstInstruction(block);
+            if(first != NULL) {
+                LLVMPositionBuilderBefore(builder, first);
+            } else {
+                LLVMPositionBuilderAtEnd(builder, block);
+            }
+            phiVariable[LLVMBuildPhi(builder, type, "")] = var;
+
+            if(!defines[f]) {
+                worklist.push_back(f);
+            }
+        }
+    }
+    LLVMDisposeBuilder(builder);
+}
+
+/* walks the dominator tree from the root with an explicit stack, replacing each load of a variable
+ * by its current value and marking it and the stores for erasure, and gives the phis of the
+ * successors of each block the values the variables have at its end
+ * a block's values are undone when the walk leaves it, so its siblings see those of their dominators
+ */
+void renameVariables(int root, vector<LLVMValueRef>* instructionsToErase) {
+    vector<LLVMValueRef> values;
+    for(int var = 0; var < (int) promotedAllocas.size(); var++) {
+        values.push_back(LLVMGetUndef(LLVMGetAllocatedType(promotedAllocas[var])));
+    }
+    vector<pair<int, LLVMValueRef>> undoLog; // variable and the value it had before a block changed it
+
+    // each entry holds a block, the index of its next child to visit and the undo log size on entering it
+    vector<pair<int, pair<size_t, size_t>>> stack;
+    stack.push_back(make_pair(root, make_pair((size_t) 0, (size_t) 0)));
+    bool entering = true;
+
+    while(stack.size() != 0) {
+        pair<int, pair<size_t, size_t>>& top = stack.back();
+        int b = top.first;
+
+        if(entering) {
+            top.second.second = undoLog.size();
+            LLVMBasicBlockRef block = analyses->blocks[b];
+
+            for(LLVMValueRef instruction = LLVMGetFirstInstruction(block);
+                instruction;
+                instruction = LLVMGetNextInstruction(instruction)) {
+
+                LLVMOpcode opcode = LLVMGetInstructionOpcode(instruction);
+                if(opcode == LLVMPHI) {
+                    unordered_map<LLVMValueRef, int>::iterator var = phiVariable.find(instruction);
+                    if(var != phiVariable.end()) {
+                        undoLog.push_back(make_pair(var->second, values[var->second]));
+                        values[var->second] = instruction;
+                    }
+                } else if(opcode == LLVMLoad) {
+                    unordered_map<LLVMValueRef, int>::iterator var = variableIndex.find(LLVMGetOperand(instruction, 0));
+                    if(var != variableIndex.end()) {
+                        replaceAllUses(instruction, values[var->second]);
+                        instructionsToErase->push_back(instruction);
+                    }
+                } else if(opcode == LLVMStore) {
+                    unordered_map<LLVMValueRef, int>::iterator var = variableIndex.find(LLVMGetOperand(instruction, 1));
+                    if(var != variableIndex.end()) {
+                        undoLog.push_back(make_pair(var->second, values[var->second]));
+                        values[var->second] = LLVMGetOperand(instruction, 0);
+                        instructionsToErase->push_back(instruction);
+                    }
+                }
+            }
+
+            // one incoming value per edge, so a block branching twice to a successor gives it two
+            LLVMValueRef terminator = LLVMGetBasicBlockTerminator(block);
+            unsigned numSuccessors = (terminator != NULL) ? LLVMGetNumSuccessors(terminator) : 0;
+            for(unsigned i = 0; i < numSuccessors; i++) {
+                for(LLVMValueRef phi = LLVMGetFirstInstruction(LLVMGetSuccessor(terminator, i));
+                    phi && LLVMGetInstructionOpcode(phi) == LLVMPHI;
+                    phi = LLVMGetNextInstruction(phi)) {
+
+                    unordered_map<LLVMValueRef, int>::iterator var = phiVariable.find(phi);
+                    if(var != phiVariable.end()) {
+                        LLVMAddIncoming(phi, &values[var->second], &block, 1);
+                    }
+                }
+            }
+        }
+
+        // enter the next child
+        if(top.second.first < analyses->domTree[b].size()) {
+            int child = analyses->domTree[b][top.second.first];
+            top.second.first++;
+            stack.push_back(make_pair(child, make_pair((size_t) 0, (size_t) 0)));
+            entering = true;
+            continue;
+        }
+
+        // leave the block - its values no longer reach anything
+        while(undoLog.size() > top.second.second) {
+            values[undoLog.back().first] = undoLog.back().second;
+            undoLog.pop_back();
+        }
+        stack.pop_back();
+        entering = false;
+    }
+}
+
+/* replaces every phi whose incoming values are all the same value or the phi itself by that value,
+ * then checks the phis that used it, which may have become trivial too
+ */
+void removeTrivialPhis(vector<LLVMValueRef>& candidates) {
+    unordered_set<LLVMValueRef> removed;
+
+    while(!candidates.empty()) {
+        LLVMValueRef phi = candidates.back();
+        candidates.pop_back();
+        if(removed.count(phi) != 0) {
+            continue;
+        }
+
+        LLVMValueRef same = NULL;
+        bool trivial = true;
+        unsigned count = LLVMCountIncoming(phi);
+        for(unsigned i = 0; i < count && trivial; i++) {
+            LLVMValueRef incoming = LLVMGetIncomingValue(phi, i);
+            if(incoming == same || incoming == phi) {
+                continue;
+            }
+            trivial = (same == NULL);
+            same = incoming;
+        }
+        if(!trivial) {
+            continue;
+        }
+        if(same == NULL) { // only reached from itself
+            same = LLVMGetUndef(LLVMTypeOf(phi));
+        }
+
+        for(LLVMUseRef use = LLVMGetFirstUse(phi); use; use = LLVMGetNextUse(use)) {
+            LLVMValueRef user = LLVMGetUser(use);
+            if(user != phi && LLVMIsAPHINode(user)) {
+                candidates.push_back(user);
+            }
+        }
+        replaceAllUses(phi, same);
+        eraseInstruction(phi);
+        removed.insert(phi);
+    }
+}
+
+/* moves the arithmetic of each loop whose operands are all computed outside it to the end of
+ * the preheader of the outermost loop it can leave, so that it runs once instead of on every iteration
+ * the blocks are visited in reverse postorder, so an instruction is hoisted before those using it
+ * and those can leave the loops it left, and whether a loop contains a block takes constant time,
+ * so nothing is paid for the depth of a loop the instruction does not leave
+ * arithmetic cannot trap, so it may run even when the loop would not have reached it
+ */
+bool hoistLoopInvariants(LLVMValueRef func) {
+    assert(func != NULL);
+
+    if(!LLVMGetFirstBasicBlock(func)) {
+        return false;
+    }
+
+    analyses = requireAnalysis(func, analysis_loops);
+    bool changed = false;
+    LLVMBuilderRef builder = LLVMCreateBuilderInContext(LLVMGetModuleContext(LLVMGetGlobalParent(func)));
+
+    for(int b = 0; b < (int) analyses->blocks.size(); b++) {
+        if(analyses->innermostLoop[b] == -1) {
+            continue;
+        }
+
+        LLVMValueRef nextInstruction;
+        for(LLVMValueRef instruction = LLVMGetFirstInstruction(analyses->blocks[b]);
+            instruction;
+            instruction = nextInstruction) {
+
+            nextInstruction = LLVMGetNextInstruction(instruction);
+            int target = findHoistTarget(instruction, analyses->innermostLoop[b]);
+            if(target != -1) {
+                LLVMBasicBlockRef preheader = analyses->blocks[analyses->loops[target].preheader];
+                LLVMPositionBuilderBefore(builder, LLVMGetBasicBlockTerminator(preheader));
+                LLVMInstructionRemoveFromParent(instruction);
+                LLVMInsertIntoBuilder(builder, instruction);
+                changed = true;
+            }
+        }
+    }
+
+    LLVMDisposeBuilder(builder);
+    return changed;
+}
+
+/* returns the outermost loop with a preheader, going out from the given one, that an add, sub or mul
+ * is invariant in and every loop inside it too, or -1 if there is none
+ */
+int findHoistTarget(LLVMValueRef instruction, int loop) {
+    LLVMOpcode opcode = LLVMGetInstructionOpcode(instruction);
+    if(opcode != LLVMAdd && opcode != LLVMSub && opcode != LLVMMul) {
+        return -1;
+    }
+
+    int target = -1;
+    while(loop != -1 && isLoopInvariant(instruction, loop)) {
+        if(analyses->loops[loop].preheader != -1) {
+            target = loop;
+        }
+        loop = analyses->loops[loop].parent;
+    }
+    return target;
+}
+
+/* checks if the operands of an instruction are all constants, the parameter or instructions outside the loop */
+bool isLoopInvariant(LLVMValueRef instruction, int loop) {
+    for(int i = 0; i < LLVMGetNumOperands(instruction); i++) {
+        LLVMValueRef operand = LLVMGetOperand(instruction, i);
+        if(LLVMIsAInstruction(operand)) {
+            assert(analyses->blockIndex.count(LLVMGetInstructionParent(operand)) != 0);
+            int block = analyses->blockIndex[LLVMGetInstructionParent(operand)];
+            if(loopContains(analyses->loops, analyses->innermostLoop, loop, block)) {
+                return false;
+            }
+        } else if(!LLVMIsAConstant(operand) && !LLVMIsAArgument(operand)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Finds instructions with the same opcode, predicate and operands using a hashed table of
+ * value numbers, walking the dominator tree so an instruction can be replaced by an
+ * identical one in any block that dominates it. Loads are only reused within a block
+ * while no store to their address comes between them
+ */
+bool commonSubexpressionElimination(LLVMValueRef func) {
+    assert(func != NULL);
+
+    if(!LLVMGetFirstBasicBlock(func)) {
+        return false;
+    }
+
+    analyses = requireAnalysis(func, analysis_dominators);
+    vector<LLVMBasicBlockRef>& blocks = analyses->blocks;
+    vector<int>& idom = analyses->idom;
+    vector<vector<int>>& domTree = analyses->domTree;
+
+    valueNumbers.clear();
+    vector<LLVMValueRef>* instructionsToErase = new vector<LLVMValueRef>(); // instructions to erase
+
+    // unreachable blocks are not dominated by the entry, so they root their own trees
+    vector<int> roots;
+    for(int b = 0; b < (int) analyses->blocks.size(); b++) {
+        if(idom[b] == -1) {
+            roots.push_back(b);
+        }
+    }
+
+    vector<int>::iterator rootIt = roots.begin();
+    while(rootIt != roots.end()) {
+
+        // depth first walk of the dominator tree with an explicit stack - each entry holds a block,
+        // the index of its next child to visit and the expressions it added to the table
+        vector<pair<int, size_t>> stack;
+        vector<vector<expressionKey>> scopes;
+        stack.push_back(make_pair(*rootIt, 0));
+        scopes.push_back(vector<expressionKey>());
+        valueNumberBlock(blocks[*rootIt], &scopes.back(), instructionsToErase);
+
+        while(stack.size() != 0) {
+            pair<int, size_t>& top = stack.back();
+
+            // enter the next child
+            if(top.second < domTree[top.first].size()) {
+                int child = domTree[top.first][top.second];
+                top.second++;
+                stack.push_back(make_pair(child, 0));
+                scopes.push_back(vector<expressionKey>());
+                valueNumberBlock(blocks[child], &scopes.back(), instructionsToErase);
+                continue;
+            }
+
+            // leave the block - its expressions no longer dominate anything
+            vector<expressionKey>::iterator it = scopes.back().begin();
+            while(it != scopes.back().end()) {
+                valueNumbers.erase(*it);
+                it++;
+            }
+            scopes.pop_back();
+            stack.pop_back();
+        }
+
+        rootIt++;
     }
 
     // delete all marked instructions
@@ -419,75 +890,186 @@ bool constantFolding(LLVMBasicBlockRef bb) {
     return changed;
 }
 
-/* GLOBAL OPTIMIZATION INSTRUCTIONS */
-/* -------------------------------- */
+/* value numbers the instructions of a single block against the table of its dominators,
+ * recording the expressions it adds in scope
+ */
+void valueNumberBlock(LLVMBasicBlockRef bb, vector<expressionKey>* scope, vector<LLVMValueRef>* instructionsToErase) {
+    assert(bb != NULL);
+
+    unordered_map<LLVMValueRef, LLVMValueRef> activeLoadInstructions; // from loaded var to load instruction
+
+    // walk instructions
+    for (LLVMValueRef instruction = LLVMGetFirstInstruction(bb); 
+        instruction;
+  		instruction = LLVMGetNextInstruction(instruction)) {
+
+        // retrieve the opCode
+        LLVMOpcode opcode = LLVMGetInstructionOpcode(instruction);
+
+        // handle store case (eliminate loads)
+        if(opcode == LLVMStore) {
+            assert(LLVMGetNumOperands(instruction) == 2);
+            LLVMValueRef addr = LLVMGetOperand(instruction, 1);
+
+            // if there is a load on the addr, erase it from the active loads
+            activeLoadInstructions.erase(addr);
+            continue;
+        }
+
+        // handle load case (check for common uses)
+        if(opcode == LLVMLoad) { // load instruction
+            assert(LLVMGetNumOperands(instruction) == 1);
+            LLVMValueRef addr = LLVMGetOperand(instruction, 0);
+
+            // if there is a load, use it
+            if(activeLoadInstructions.count(addr)) {
+                replaceAllUses(instruction, activeLoadInstructions[addr]);
+                instructionsToErase->push_back(instruction);
+            } else {
+                activeLoadInstructions[addr] = instruction;
+            }
+            continue;
+        }
+
+        // only arithmetic and compares are pure (allocas, calls, branches are not)
+        if(!LLVMIsABinaryOperator(instruction) && !LLVMIsAICmpInst(instruction)) {
+            continue;
+        }
+
+        // if the expression is already computed in a dominating block, replace the uses
+        expressionKey key = getExpressionKey(instruction);
+        unordered_map<expressionKey, LLVMValueRef, expressionKeyHash>::iterator found = valueNumbers.find(key);
+        if(found != valueNumbers.end()) {
+            replaceAllUses(instruction, found->second);
+            instructionsToErase->push_back(instruction);
+        } else {
+            valueNumbers[key] = instruction;
+            scope->push_back(key);
+        }
+    }
+}
+
+/* builds the key of an arithmetic or compare instruction
+ * operands of commutative operations are ordered so that a + b and b + a share a key,
+ * and compares are flipped with their predicate so that a < b and b > a share a key
+ */
+expressionKey getExpressionKey(LLVMValueRef instruction) {
+    assert(LLVMGetNumOperands(instruction) == 2);
+
+    expressionKey key;
+    key.opcode = LLVMGetInstructionOpcode(instruction);
+    key.predicate = -1;
+    key.lhs = LLVMGetOperand(instruction, 0);
+    key.rhs = LLVMGetOperand(instruction, 1);
+
+    bool ordered = less<LLVMValueRef>()(key.lhs, key.rhs) || key.lhs == key.rhs;
+
+    switch(key.opcode) {
+        case(LLVMAdd):
+        case(LLVMMul):
+        case(LLVMAnd):
+        case(LLVMOr):
+        case(LLVMXor): {
+            if(!ordered) {
+                swap(key.lhs, key.rhs);
+            }
+            break;
+        }
+
+        case(LLVMICmp): {
+            LLVMIntPredicate pred = LLVMGetICmpPredicate(instruction);
+            if(!ordered) {
+                swap(key.lhs, key.rhs);
+                switch(pred) {
+                    case(LLVMIntSGT): pred = LLVMIntSLT; break;
+                    case(LLVMIntSLT): pred = LLVMIntSGT; break;
+                    case(LLVMIntSGE): pred = LLVMIntSLE; break;
+                    case(LLVMIntSLE): pred = LLVMIntSGE; break;
+                    case(LLVMIntUGT): pred = LLVMIntULT; break;
+                    case(LLVMIntULT): pred = LLVMIntUGT; break;
+                    case(LLVMIntUGE): pred = LLVMIntULE; break;
+                    case(LLVMIntULE): pred = LLVMIntUGE; break;
+                    default: break; // eq and ne are symmetric
+                }
+            }
+            key.predicate = pred;
+            break;
+        }
+
+        default: {} // sub and div are not commutative
+    }
+
+    return key;
+}
 
 /* performs constant propagation, an optimization technique that 
  * replaces all variables with the constant its value is defined as, assuming
  * it is constant across all of its reaches
  */
 bool constantPropagation(LLVMValueRef func) {
-    generateStoreSet(func);
-    generateGen(func);
-    generateKill(func);
-    computeInOut(func);
-    return performConstantProp(func);
+    if(!LLVMGetFirstBasicBlock(func)) {
+        return false;
+    }
+
+    analyses = requireAnalysis(func, analysis_cfg);
+    generateStoreSet();
+    generateGen();
+    generateKill();
+    computeInOut();
+    return performConstantProp();
 }
 
-/* generates the 'storeSet' map, which maps addresses to 
- * its store instructions across all basic blocks
+/* numbers the store instructions of the function once, 
+ * then generates the 'storeSet' map, which maps addresses to 
+ * the bit vector of its store instructions across all basic blocks
  */
-void generateStoreSet(LLVMValueRef func) {
+void generateStoreSet() {
+    stores.clear();
+    storeIndex.clear();
     storeSet.clear();
 
-    // loop through all basic blocks
-    for(LLVMBasicBlockRef basicBlock = LLVMGetFirstBasicBlock(func);
-        basicBlock;
-        basicBlock = LLVMGetNextBasicBlock(basicBlock)) {
+    // loop through all basic blocks and number the stores
+    for(int b = 0; b < (int) analyses->blocks.size(); b++) {
 
         // loop through all instructions
-        for(LLVMValueRef instruction = LLVMGetFirstInstruction(basicBlock);
+        for(LLVMValueRef instruction = LLVMGetFirstInstruction(analyses->blocks[b]);
             instruction;
             instruction = LLVMGetNextInstruction(instruction)) {
 
-            // if we have a store instruction
             if(LLVMGetInstructionOpcode(instruction) == LLVMStore) {
-                LLVMValueRef addr = LLVMGetOperand(instruction, 1);
-
-                // store the instruction in its address bucket
-                if(storeSet.count(addr) == 0) { // create bucket if doesn't exist
-                    set<LLVMValueRef> storeAddr;
-                    storeSet[addr] = storeAddr;
-                }
-                storeSet[addr].insert(instruction);
+                storeIndex[instruction] = stores.size();
+                stores.push_back(instruction);
             }
+        }
+    }
 
+    // store each instruction in its address bucket
+    for(int i = 0; i < (int) stores.size(); i++) {
+        LLVMValueRef addr = LLVMGetOperand(stores[i], 1);
+
+        if(storeSet.count(addr) == 0) { // create bucket if doesn't exist
+            storeSet[addr] = createBitVector(stores.size());
         }
+        setBit(&storeSet[addr], i);
     }
 }
 
-/* generates the 'gen' map, which maps each basic block
+/* generates the 'gen' vectors, which map each basic block
  * to its set of 'gen' instructions, or store instructions
  * that are not overwritten and escape the basic block
  */
-void generateGen(LLVMValueRef func) {
-    gen.clear();
+void generateGen() {
+    genSets.assign(analyses->blocks.size(), createBitVector(stores.size()));
 
     // loop through basic blocks
-    for(LLVMBasicBlockRef basicBlock = LLVMGetFirstBasicBlock(func);
-        basicBlock;
-        basicBlock = LLVMGetNextBasicBlock(basicBlock)) {
-
-        // create bucket for basic block
-        set<LLVMValueRef> genBucket;
-        gen[basicBlock] = genBucket;
+    for(int b = 0; b < (int) analyses->blocks.size(); b++) {
 
         // keeps track of the store instructions to each addr iterated over in the
         // current basic block
-        unordered_map<LLVMValueRef, LLVMValueRef> activeStores;
+        unordered_map<LLVMValueRef, int> activeStores;
 
         // loop over instructions
-        for(LLVMValueRef instruction = LLVMGetFirstInstruction(basicBlock);
+        for(LLVMValueRef instruction = LLVMGetFirstInstruction(analyses->blocks[b]);
             instruction;
             instruction = LLVMGetNextInstruction(instruction)) {
             
@@ -497,178 +1079,87 @@ void generateGen(LLVMValueRef func) {
 
                 // if we have already seen this instruction address in this block, erase it from gen
                 if(activeStores.count(addr) != 0) {
-                    assert(gen[basicBlock].count(activeStores[addr]) != 0);
-                    gen[basicBlock].erase(activeStores[addr]);
+                    assert(testBit(&genSets[b], activeStores[addr]));
+                    resetBit(&genSets[b], activeStores[addr]);
                 }
 
                 // add current instruction to gen
-                gen[basicBlock].insert(instruction);
-                activeStores[addr] = instruction;
+                int index = storeIndex[instruction];
+                setBit(&genSets[b], index);
+                activeStores[addr] = index;
             }
         }
     }
 }
 
-/* generates the 'kill' map, which maps each basic block
+/* generates the 'kill' vectors, which map each basic block
  * to its set of 'kill' instructions, or store instructions
  * killed by its own stores
  */
-void generateKill(LLVMValueRef func) {
-    kill.clear();
+void generateKill() {
+    killSets.assign(analyses->blocks.size(), createBitVector(stores.size()));
 
     // loop through all basic blocks
-    for(LLVMBasicBlockRef basicBlock = LLVMGetFirstBasicBlock(func);
-        basicBlock;
-        basicBlock = LLVMGetNextBasicBlock(basicBlock)) {
+    for(int b = 0; b < (int) analyses->blocks.size(); b++) {
 
-        // create bucket for basic block
-        set<LLVMValueRef> killBucket;
-        kill[basicBlock] = killBucket;
+        // count the stores to each address in this block, remembering the last one
+        unordered_map<LLVMValueRef, pair<int, int>> blockStores;
 
-        // loop through instructions
-        for(LLVMValueRef instruction = LLVMGetFirstInstruction(basicBlock);
+        for(LLVMValueRef instruction = LLVMGetFirstInstruction(analyses->blocks[b]);
             instruction;
             instruction = LLVMGetNextInstruction(instruction)) {
 
-            // if we have a store instruction
             if(LLVMGetInstructionOpcode(instruction) == LLVMStore) {
                 LLVMValueRef addr = LLVMGetOperand(instruction, 1);
-                assert(storeSet.count(addr) != 0);
-                
-                // iterate through all instructions with same address and add to kill set
-                set<LLVMValueRef> addrSet = storeSet[addr];
-                set<LLVMValueRef>::iterator it = addrSet.begin();
-                while(it != addrSet.end()) {
-                    if(*it != instruction) { // ensure not the same instruction
-                        kill[basicBlock].insert(*it);
-                    }
-                    it++;
-                }
+                pair<int, int>& entry = blockStores[addr];
+                entry.first++;
+                entry.second = storeIndex[instruction];
             }
         }
-    }
-}
-
-/* iteratively compute the 'in' and 'out' blocks for each basic block */
-void computeInOut(LLVMValueRef func) {
-    in.clear();
-    out.clear();
 
-    // set out to in
-    for(LLVMBasicBlockRef basicBlock = LLVMGetFirstBasicBlock(func);
-        basicBlock;
-        basicBlock = LLVMGetNextBasicBlock(basicBlock)) {
-
-        out[basicBlock] = gen[basicBlock];
-    }
-
-    // iterate in and out as long as there are changes
-    bool changed = true;
-    while(changed) {
-        changed = false;
-
-        // loop through all the basic blocks
-        for(LLVMBasicBlockRef basicBlock = LLVMGetFirstBasicBlock(func);
-            basicBlock;
-            basicBlock = LLVMGetNextBasicBlock(basicBlock)) {
-
-            // generate in and out
-            generateIn(basicBlock);
-            set<LLVMValueRef> oldout = out[basicBlock];
-            generateOut(basicBlock);
-
-            // if no changes, we are done
-            if(out[basicBlock] != oldout) {
-                changed = true;
+        // every store kills all other stores to the same address, so a block kills
+        // the whole address bucket unless it stores to the address only once
+        for(auto& entry : blockStores) {
+            assert(storeSet.count(entry.first) != 0);
+            unionBitVector(&killSets[b], &storeSet[entry.first]);
+            if(entry.second.first == 1) {
+                resetBit(&killSets[b], entry.second.second);
             }
         }
     }
 }
 
-/* generate 'in' for the particular basic block -
+/* compute the 'in' and 'out' blocks for each basic block - 
  * in[bb] = union(out[p1], out[p2], ..., out[pn]) where pi is a predecessor
- */
-void generateIn(LLVMBasicBlockRef bb) {
-    in[bb].clear();
-
-    // get the parent function, graph, and set of predecessors
-    LLVMValueRef function = LLVMGetBasicBlockParent(bb);
-    unordered_map<LLVMBasicBlockRef, set<LLVMBasicBlockRef>> inGraph = graphs[function][1];
-    
-    // if first basic block (no predecessors, skip in)
-    if(inGraph.count(bb) == 0) {
-        return;
-    }
-
-    set<LLVMBasicBlockRef> predecessors = inGraph[bb];
-
-    // loop through the predecessors and all of their outs
-    set<LLVMBasicBlockRef>::iterator it = predecessors.begin();
-    while(it != predecessors.end()) {
-        assert(out.count(*it) != 0);
-
-        // loop through all of the outs of the predecessors
-        set<LLVMValueRef>::iterator outIt = out[*it].begin();
-        while(outIt != out[*it].end()) {
-            // insert instructions into in
-            in[bb].insert(*outIt);
-            outIt++;
-        }
-
-        it++;
-    }
-}
-
-/* generate 'out' for the particular basic block -
  * out[bb] = gen[bb] U (in[bb] - kill[bb])
  */
-void generateOut(LLVMBasicBlockRef bb) {
-    out[bb].clear();
-
-    // copy in
-    set<LLVMValueRef> inDiffKill = in[bb];
-
-    // calculate in[bb] - kill[bb]
-    set<LLVMValueRef>::iterator killIt = kill[bb].begin();
-    while(killIt != kill[bb].end()) {
-        // if in[bb] contains the item from kill, remove it
-        if(inDiffKill.count(*killIt) != 0) {
-            inDiffKill.erase(*killIt);
-        }
-
-        killIt++;
-    }
-
-    // add all of gen[bb] to out[bb]
-    set<LLVMValueRef>::iterator genIt = gen[bb].begin();
-    while(genIt != gen[bb].end()) {
-        out[bb].insert(*genIt);
-        genIt++;
-    }
-    
-    // add all of inDiffKill to out[bb]
-    set<LLVMValueRef>::iterator inDiffKillIt = inDiffKill.begin();
-    while(inDiffKillIt != inDiffKill.end()) {
-        out[bb].insert(*inDiffKillIt);
-        inDiffKillIt++;
-    }
+void computeInOut() {
+    dataflowProblem reachingDefinitions;
+    reachingDefinitions.direction = dataflow_forward;
+    reachingDefinitions.entry = 0;
+    reachingDefinitions.predecessors = &analyses->predecessors;
+    reachingDefinitions.successors = &analyses->successors;
+    reachingDefinitions.gen = &genSets;
+    reachingDefinitions.kill = &killSets;
+    solveDataflow(&reachingDefinitions);
+
+    inSets.swap(reachingDefinitions.in);
+    outSets.swap(reachingDefinitions.out);
 }
 
 /* edit the instruction set according to the in, out, kill, and gen sets */
-bool performConstantProp(LLVMValueRef func) {
+bool performConstantProp() {
     
     vector<LLVMValueRef>* instructionsToErase = new vector<LLVMValueRef>(); // instructions to erase
     
     // loop over all of the basic blocks
-    for(LLVMBasicBlockRef bb = LLVMGetFirstBasicBlock(func);
-        bb;
-        bb = LLVMGetNextBasicBlock(bb)) {
+    for(int b = 0; b < (int) analyses->blocks.size(); b++) {
 
         // set r as in[bb]
-        set<LLVMValueRef> r = in[bb];
+        bitVector r = inSets[b];
 
         // loop over all instructions
-        for(LLVMValueRef instruction = LLVMGetFirstInstruction(bb);
+        for(LLVMValueRef instruction = LLVMGetFirstInstruction(analyses->blocks[b]);
             instruction;
             instruction = LLVMGetNextInstruction(instruction)) {
 
@@ -677,55 +1168,34 @@ bool performConstantProp(LLVMValueRef func) {
             // case 1: store
             if(op == LLVMStore) { 
 
-                r.insert(instruction);
+                // the store kills every other store to its address in r
                 LLVMValueRef addr = LLVMGetOperand(instruction, 1); // store address
-
-                // loop over all instructions in r
-                set<LLVMValueRef>::iterator rIt = r.begin();
-                vector<LLVMValueRef> toErase;
-                while(rIt != r.end()) {
-                    assert(LLVMGetInstructionOpcode(*rIt) == LLVMStore);
-                    if(*rIt == instruction) {
-                        rIt++;
-                        continue;
-                    }
-
-                    // if it has the same store address, killed by instruction, flag to remove from r
-                    if(addr == LLVMGetOperand(*rIt, 1)) {
-                        toErase.push_back(*rIt);
-                    }
-
-                    rIt++;
-                }
-
-                // remove all killed instructions from r
-                vector<LLVMValueRef>::iterator vIt = toErase.begin();
-                while(vIt != toErase.end()) {
-                    r.erase(*vIt);
-                    vIt++;
-                }
+                assert(storeSet.count(addr) != 0);
+                differenceBitVector(&r, &storeSet[addr]);
+                setBit(&r, storeIndex[instruction]);
                 
             // case 2: load
             } else if(op == LLVMLoad) { 
                 LLVMValueRef addr = LLVMGetOperand(instruction, 0); // load address
 
-                // loop over all instructions in r and keep track of constant int values
+                // nothing reaches a load from an address that is never stored to
+                if(storeSet.count(addr) == 0) {
+                    continue;
+                }
+
+                // loop over all instructions in r that store to addr and keep track of constant int values
                 bool propagate = true; // if true at end of while loop, we can propagate the constant int value
                 bool firstConstFound = false; // checks for first constant to be set as constValue
                 LLVMValueRef constValue; // store the constant value
 
-                set<LLVMValueRef>::iterator rIt = r.begin();
-                while(rIt != r.end()) {
-                    assert(LLVMGetInstructionOpcode(*rIt) == LLVMStore);
-
-                    // ignore stores to other addresses
-                    if(addr != LLVMGetOperand(*rIt, 1)) {
-                        rIt++;
-                        continue;
-                    }
+                const bitVector* addrStores = &storeSet[addr];
+                for(int i = nextSetBitInBoth(&r, addrStores, 0);
+                    i != -1;
+                    i = nextSetBitInBoth(&r, addrStores, i + 1)) {
+                    assert(LLVMGetInstructionOpcode(stores[i]) == LLVMStore);
 
                     // get the value that is stored
-                    LLVMValueRef storedValue = LLVMGetOperand(*rIt, 0);
+                    LLVMValueRef storedValue = LLVMGetOperand(stores[i], 0);
 
                     // if it isn't a constant, we cannot propagate
                     if(!LLVMIsAConstantInt(storedValue)) {
@@ -744,13 +1214,11 @@ bool performConstantProp(LLVMValueRef func) {
                         propagate = false;
                         break;
                     }
-
-                    rIt++;
                 }
 
                 // if we have a constant value to propagate
                 if(propagate && firstConstFound) {
-                    LLVMReplaceAllUsesWith(instruction, constValue);
+                    replaceAllUses(instruction, constValue);
                     instructionsToErase->push_back(instruction);
                 }
             }
@@ -2,12 +2,19 @@
 #include <llvm-c/IRReader.h>
 #include <llvm-c/Types.h>
 #include <stdbool.h>
+#include <vector>
+
+using namespace std;
 
 /* FUNCTIONS */
 /* --------- */
 
 void optimizeLLVM(LLVMModuleRef mod);
-bool commonSubexpressionElimination(LLVMBasicBlockRef bb);
-bool deadCodeElimination(LLVMBasicBlockRef bb);
-bool constantFolding(LLVMBasicBlockRef bb);
+void optimizeLLVM_memory(LLVMModuleRef mod);
+void optimizeLLVM_hoist(LLVMModuleRef mod);
+bool promoteMemoryToRegisters(LLVMValueRef func);
+bool deadCodeElimination(LLVMValueRef func);
+bool constantFolding(LLVMValueRef func);
+bool commonSubexpressionElimination(LLVMValueRef func);
+bool hoistLoopInvariants(LLVMValueRef func);
 bool constantPropagation(LLVMValueRef func);
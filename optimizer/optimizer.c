@@ -13,23 +13,17 @@
 #include <llvm-c/Types.h>
 #include "../helper/helper_functions.h"
 #include "../syntax_analyzer/semantic_analysis.h"
+#include "../syntax_analyzer/parser.h"
 #include "../llvm_ir_builder/llvm_gen.h"
 #include "llvm_optimizations.h"
 using namespace std;
 
-/* EXTERNS */
-/* ------- */
-
-extern void yyparse();
-extern int yylex_destroy();
-extern FILE *yyin;
-extern char* yytext;
-
-
 /* GLOBAL VARIABLES */
 /* ---------------- */
 
 astNode* root; // root of the AST
+astArena* arena; // owns every node of the AST
+FILE* input = stdin; // source file, or stdin if none is given
 
 /* MAIN */
 /* ---- */
@@ -37,13 +31,21 @@ astNode* root; // root of the AST
 int main(int argc, char** argv){
 	
 	if (argc >= 3){
-		yyin = fopen(argv[2], "r");
+		input = fopen(argv[2], "r");
 	}
 
 	LLVMModuleRef llvm_ir;
 	if(strcmp("build", argv[1]) == 0) {
 		// generate the AST
-		yyparse();
+		arena = createArena();
+		root = parseFile(input, arena);
+
+		// semantic analysis resolves every variable to the stack slot the builder allocates it in
+		if(root == NULL || !semanticAnalysis_opt(root)) {
+			freeArena(arena);
+			printf("FAILURE: Semantics Failed\n");
+			return 1;
+		}
 		llvm_ir = createLLVMModelFromAST(root, argv[2]);
 
 		optimizeLLVMBasicBlocks(llvm_ir);
@@ -55,7 +57,7 @@ int main(int argc, char** argv){
     		LLVMPrintModuleToFile(llvm_ir, argv[3], NULL);
 		}
 
-		freeNode(root);
+		freeArena(arena);
 
 	} else {
 		llvm_ir = createLLVMModel(argv[2]);
@@ -69,9 +71,8 @@ int main(int argc, char** argv){
 	}
 
 	// close
-	if (yyin != stdin) {
-		fclose(yyin);
-		yylex_destroy();
+	if (input != stdin) {
+		fclose(input);
 	}
 	
 	return 0;
@@ -0,0 +1,224 @@
+/*
+ * This is a benchmark program for the optimizer which builds large synthetic LLVM modules
+ * and times the optimization passes on them
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <time.h>
+#include <llvm-c/Core.h>
+#include <llvm-c/IRReader.h>
+#include <llvm-c/Types.h>
+#include <vector>
+#include "llvm_optimizations.h"
+#include "pass_manager.h"
+#include "../helper/elapsed_time.h"
+using namespace std;
+
+/* FUNCTION PROTOTYPES */
+/* ------------------- */
+LLVMModuleRef storeHeavyModule(int numBlocks, int storesPerBlock, int numVars);
+void benchAnalyses(LLVMModuleRef mod);
+int countInstructions(LLVMModuleRef mod);
+
+
+/* MAIN */
+/* ---- */
+
+int main(int argc, char** argv){
+
+    // sizes can be overriden as [blocks] [stores per block] [variables]
+    int numBlocks = (argc > 1) ? atoi(argv[1]) : 400;
+    int storesPerBlock = (argc > 2) ? atoi(argv[2]) : 25;
+    int numVars = (argc > 3) ? atoi(argv[3]) : 64;
+
+    printf("blocks: %d, stores per block: %d, variables: %d\n", numBlocks, storesPerBlock, numVars);
+
+    // time the dominance analyses, computed and then cached
+    LLVMModuleRef mod = storeHeavyModule(numBlocks, storesPerBlock, numVars);
+    benchAnalyses(mod);
+    LLVMDisposeModule(mod);
+
+    // time constant propagation by itself (a single pass over each function)
+    mod = storeHeavyModule(numBlocks, storesPerBlock, numVars);
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(LLVMValueRef function = LLVMGetFirstFunction(mod);
+        function;
+        function = LLVMGetNextFunction(function)) {
+        constantPropagation(function);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("constantPropagation: %10.2f ms\n", elapsedMs(start, end));
+    LLVMDisposeModule(mod);
+
+    // time the full optimizer until its fixpoint
+    mod = storeHeavyModule(numBlocks, storesPerBlock, numVars);
+    int before = countInstructions(mod);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    optimizeLLVM(mod);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("optimizeLLVM:        %10.2f ms (%d -> %d instructions)\n", elapsedMs(start, end), before, countInstructions(mod));
+    LLVMDisposeModule(mod);
+
+    // report how much of the module each fixpoint round had to look at again
+    vector<int> revisitCounts = getRevisitCounts();
+    for(int i = 0; i < (int) revisitCounts.size(); i++) {
+        printf("round %d: %d instructions revisited\n", i + 1, revisitCounts[i]);
+    }
+    printPassStatistics(stdout);
+
+    return 0;
+}
+
+/* builds a module with a single function made of a chain of blocks,
+ * where every block stores to and loads from a pool of stack variables
+ * every eighth block loops back to create nested back edges for the dataflow
+ */
+LLVMModuleRef storeHeavyModule(int numBlocks, int storesPerBlock, int numVars) {
+    assert(numBlocks > 0 && storesPerBlock > 0 && numVars > 0);
+
+    LLVMModuleRef mod = LLVMModuleCreateWithName("");
+    LLVMSetTarget(mod, "x86_64-pc-linux-gnu");
+
+    LLVMTypeRef param_types[] = { LLVMInt32Type() };
+    LLVMTypeRef ret_type = LLVMFunctionType(LLVMInt32Type(), param_types, 1, 0);
+    LLVMValueRef func = LLVMAddFunction(mod, "bench", ret_type);
+
+    LLVMBasicBlockRef entry = LLVMAppendBasicBlock(func, "");
+    LLVMBuilderRef builder = LLVMCreateBuilder();
+    LLVMPositionBuilderAtEnd(builder, entry);
+
+    // allocate and initialize the variables
+    vector<LLVMValueRef> vars;
+    for(int i = 0; i < numVars; i++) {
+        LLVMValueRef var = LLVMBuildAlloca(builder, LLVMInt32Type(), "");
+        LLVMSetAlignment(var, 4);
+        LLVMBuildStore(builder, LLVMConstInt(LLVMInt32Type(), i % 7, false), var);
+        vars.push_back(var);
+    }
+
+    // create all of the blocks up front so back edges can be built
+    vector<LLVMBasicBlockRef> blocks;
+    for(int i = 0; i < numBlocks; i++) {
+        blocks.push_back(LLVMAppendBasicBlock(func, ""));
+    }
+    LLVMBasicBlockRef exit = LLVMAppendBasicBlock(func, "");
+    LLVMBuildBr(builder, blocks[0]);
+
+    unsigned int seed = 57;
+    for(int i = 0; i < numBlocks; i++) {
+        LLVMPositionBuilderAtEnd(builder, blocks[i]);
+
+        for(int j = 0; j < storesPerBlock; j++) {
+            LLVMValueRef dest = vars[rand_r(&seed) % numVars];
+            if(rand_r(&seed) % 3 == 0) { // store a computed value
+                LLVMValueRef src = vars[rand_r(&seed) % numVars];
+                LLVMValueRef load = LLVMBuildLoad2(builder, LLVMInt32Type(), src, "");
+                LLVMValueRef add = LLVMBuildAdd(builder, load, LLVMConstInt(LLVMInt32Type(), j, false), "");
+                LLVMBuildStore(builder, add, dest);
+            } else { // store a constant
+                LLVMBuildStore(builder, LLVMConstInt(LLVMInt32Type(), rand_r(&seed) % 4, false), dest);
+            }
+        }
+
+        // branch to the next block, looping back every eighth block
+        LLVMBasicBlockRef next = (i + 1 < numBlocks) ? blocks[i + 1] : exit;
+        if(i % 8 == 7) {
+            LLVMValueRef load = LLVMBuildLoad2(builder, LLVMInt32Type(), vars[i % numVars], "");
+            LLVMValueRef cond = LLVMBuildICmp(builder, LLVMIntSLT, load, LLVMGetParam(func, 0), "");
+            LLVMBuildCondBr(builder, cond, blocks[i - 7], next);
+        } else {
+            LLVMBuildBr(builder, next);
+        }
+    }
+
+    LLVMPositionBuilderAtEnd(builder, exit);
+    LLVMBuildRet(builder, LLVMBuildLoad2(builder, LLVMInt32Type(), vars[0], ""));
+    LLVMDisposeBuilder(builder);
+
+    return mod;
+}
+
+/* times each dominance analysis of the module's function when it is computed and when it
+ * is cached, and checks the constant time dominance query against walking up the tree
+ */
+void benchAnalyses(LLVMModuleRef mod) {
+    LLVMValueRef func = LLVMGetFirstFunction(mod);
+    const char* names[] = { "cfg", "dominators", "frontiers", "postdominators", "loops" };
+    analysis_type types[] = { analysis_cfg, analysis_dominators, analysis_frontiers, analysis_postdominators, analysis_loops };
+
+    functionAnalyses* analyses = NULL;
+    for(int i = 0; i < 5; i++) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        analyses = requireAnalysis(func, types[i]);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double computed = elapsedMs(start, end);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        analyses = requireAnalysis(func, types[i]);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        printf("analysis %-15s %10.3f ms computed, %10.3f ms cached\n", names[i], computed, elapsedMs(start, end));
+    }
+
+    // every block but the entry is dominated by the entry and reached from it
+    int numBlocks = analyses->blocks.size();
+    int frontierSize = 0;
+    for(int b = 0; b < numBlocks; b++) {
+        assert(blockDominates(analyses, 0, b));
+        frontierSize += analyses->frontiers[b].size();
+
+        // a block dominates another exactly when it is on its way up the dominator tree
+        unsigned int seed = b;
+        int other = rand_r(&seed) % numBlocks;
+        bool onPath = false;
+        for(int runner = other; runner != -1; runner = analyses->idom[runner]) {
+            onPath |= (runner == b);
+        }
+        assert(blockDominates(analyses, b, other) == onPath);
+    }
+
+    // only the virtual exit post-dominates the return block
+    for(int b = 0; b < numBlocks; b++) {
+        assert(numEdges(analyses->successors, b) != 0 || analyses->ipdom[b] == numBlocks);
+    }
+    // the loops a loop contains are numbered right after it, and its header is in it
+    for(int l = 0; l < (int) analyses->loops.size(); l++) {
+        naturalLoop& loop = analyses->loops[l];
+        assert(loop.depth == ((loop.parent == -1) ? 1 : analyses->loops[loop.parent].depth + 1));
+        assert(loop.parent < l && (loop.parent == -1 || loop.end <= analyses->loops[loop.parent].end));
+        assert(!loop.latches.empty() && !loop.exits.empty());
+        assert(loopContains(analyses->loops, analyses->innermostLoop, l, loop.header));
+    }
+    // the header of the innermost loop of a block dominates it, and the block is as deep as the loop
+    for(int b = 0; b < numBlocks; b++) {
+        int l = analyses->innermostLoop[b];
+        assert(analyses->loopDepth[b] == ((l == -1) ? 0 : analyses->loops[l].depth));
+        assert(l == -1 || blockDominates(analyses, analyses->loops[l].header, b));
+    }
+
+    printf("blocks: %d, frontier entries: %d, loops: %d\n", numBlocks, frontierSize, (int) analyses->loops.size());
+    invalidateAnalyses(func);
+}
+
+/* counts all of the instructions in a module */
+int countInstructions(LLVMModuleRef mod) {
+    int count = 0;
+    for(LLVMValueRef function = LLVMGetFirstFunction(mod);
+        function;
+        function = LLVMGetNextFunction(function)) {
+        for(LLVMBasicBlockRef bb = LLVMGetFirstBasicBlock(function);
+            bb;
+            bb = LLVMGetNextBasicBlock(bb)) {
+            for(LLVMValueRef instruction = LLVMGetFirstInstruction(bb);
+                instruction;
+                instruction = LLVMGetNextInstruction(instruction)) {
+                count++;
+            }
+        }
+    }
+    return count;
+}
@@ -21,6 +21,8 @@ using namespace std;
 LLVMModuleRef testModule1();
 LLVMModuleRef testModule2();
 LLVMModuleRef testModule3();
+LLVMModuleRef testModule4();
+LLVMModuleRef testModule5();
 
 
 /* MAIN */
@@ -28,13 +30,25 @@ LLVMModuleRef testModule3();
 
 int main(int argc, char** argv){
 
+	// the test module can be picked with a second argument
+	LLVMModuleRef llvm_ir;
+	int test = (argc == 3) ? atoi(argv[2]) : 3;
+	switch(test) {
+		case 1: llvm_ir = testModule1(); break;
+		case 2: llvm_ir = testModule2(); break;
+		case 4: llvm_ir = testModule4(); break;
+		case 5: llvm_ir = testModule5(); break;
+		default: llvm_ir = testModule3(); break;
+	}
 
-	LLVMModuleRef llvm_ir = testModule3();
-
-    // add optimizations here
-	optimizeLLVM(llvm_ir);
+    // add optimizations here, the loop module also hoists its invariants
+	if(test == 5) {
+		optimizeLLVM_hoist(llvm_ir);
+	} else {
+		optimizeLLVM(llvm_ir);
+	}
 
-	if(argc == 2) {
+	if(argc >= 2) {
     	LLVMPrintModuleToFile(llvm_ir, argv[1], NULL);
 	}
 	
@@ -186,3 +200,122 @@ LLVMModuleRef testModule3() {
     return mod;
 }
 
+/* test module that tests:
+ * common subexpressions across dominating blocks
+ */
+LLVMModuleRef testModule4() {
+    //Creating a module 
+    LLVMModuleRef mod = LLVMModuleCreateWithName("");
+    LLVMSetTarget(mod, "x86_64-pc-linux-gnu");
+
+    //Creating a function with a parameter
+    LLVMTypeRef param_types[] = { LLVMInt32Type() };
+    LLVMTypeRef ret_type = LLVMFunctionType(LLVMInt32Type(), param_types, 1, 0);
+    LLVMValueRef func = LLVMAddFunction(mod, "test", ret_type);
+    LLVMValueRef param = LLVMGetParam(func, 0);
+
+    LLVMBasicBlockRef first = LLVMAppendBasicBlock(func, "");
+    LLVMBasicBlockRef ifBlock = LLVMAppendBasicBlock(func, "");
+    LLVMBasicBlockRef elseBlock = LLVMAppendBasicBlock(func, "");
+    LLVMBasicBlockRef final = LLVMAppendBasicBlock(func, "");
+
+    LLVMBuilderRef builder = LLVMCreateBuilder();
+    LLVMPositionBuilderAtEnd(builder, first);
+    LLVMValueRef m = LLVMBuildAlloca(builder, LLVMInt32Type(), "m"); 
+    LLVMSetAlignment(m, 4);
+
+    // computed in the entry, which dominates every other block
+    LLVMValueRef num = LLVMConstInt(LLVMInt32Type(), 12, false);
+    LLVMValueRef mul1 = LLVMBuildMul(builder, param, num, "");
+    LLVMValueRef cmp1 = LLVMBuildICmp(builder, LLVMIntSLT, param, mul1, "");
+    LLVMBuildCondBr(builder, cmp1, ifBlock, elseBlock);
+
+    // same multiply with its operands swapped and the mirrored compare - both should go
+    LLVMPositionBuilderAtEnd(builder, ifBlock);
+    LLVMValueRef mul2 = LLVMBuildMul(builder, num, param, "");
+    LLVMValueRef cmp2 = LLVMBuildICmp(builder, LLVMIntSGT, mul2, param, "");
+    LLVMValueRef add1 = LLVMBuildAdd(builder, mul2, param, "");
+    LLVMBuildStore(builder, add1, m);
+    LLVMBuildCondBr(builder, cmp2, final, elseBlock);
+
+    // the add in the sibling if block does not dominate this one - should stay
+    LLVMPositionBuilderAtEnd(builder, elseBlock);
+    LLVMValueRef add2 = LLVMBuildAdd(builder, mul1, param, "");
+    LLVMBuildStore(builder, add2, m);
+    LLVMBuildBr(builder, final);
+
+    LLVMPositionBuilderAtEnd(builder, final);
+    LLVMValueRef mVal = LLVMBuildLoad2(builder, LLVMInt32Type(), m, "");
+    LLVMBuildRet(builder, mVal);
+
+    return mod;
+}
+
+/* test module that tests:
+ * loop-invariant code motion out of nested loops
+ */
+LLVMModuleRef testModule5() {
+    //Creating a module 
+    LLVMModuleRef mod = LLVMModuleCreateWithName("");
+    LLVMSetTarget(mod, "x86_64-pc-linux-gnu");
+
+    //Creating a function with a parameter
+    LLVMTypeRef param_types[] = { LLVMInt32Type() };
+    LLVMTypeRef ret_type = LLVMFunctionType(LLVMInt32Type(), param_types, 1, 0);
+    LLVMValueRef func = LLVMAddFunction(mod, "test", ret_type);
+    LLVMValueRef param = LLVMGetParam(func, 0);
+
+    LLVMBasicBlockRef first = LLVMAppendBasicBlock(func, "");
+    LLVMBasicBlockRef outerCond = LLVMAppendBasicBlock(func, "");
+    LLVMBasicBlockRef outerBody = LLVMAppendBasicBlock(func, "");
+    LLVMBasicBlockRef innerCond = LLVMAppendBasicBlock(func, "");
+    LLVMBasicBlockRef innerBody = LLVMAppendBasicBlock(func, "");
+    LLVMBasicBlockRef outerLatch = LLVMAppendBasicBlock(func, "");
+    LLVMBasicBlockRef final = LLVMAppendBasicBlock(func, "");
+
+    LLVMBuilderRef builder = LLVMCreateBuilder();
+    LLVMPositionBuilderAtEnd(builder, first);
+    LLVMValueRef i = LLVMBuildAlloca(builder, LLVMInt32Type(), "i");
+    LLVMValueRef j = LLVMBuildAlloca(builder, LLVMInt32Type(), "j");
+    LLVMValueRef s = LLVMBuildAlloca(builder, LLVMInt32Type(), "s");
+    LLVMValueRef zero = LLVMConstInt(LLVMInt32Type(), 0, false);
+    LLVMValueRef one = LLVMConstInt(LLVMInt32Type(), 1, false);
+    LLVMBuildStore(builder, zero, i);
+    LLVMBuildStore(builder, zero, s);
+    LLVMBuildBr(builder, outerCond);
+
+    LLVMPositionBuilderAtEnd(builder, outerCond);
+    LLVMValueRef iVal = LLVMBuildLoad2(builder, LLVMInt32Type(), i, "");
+    LLVMBuildCondBr(builder, LLVMBuildICmp(builder, LLVMIntSLT, iVal, param, ""), outerBody, final);
+
+    LLVMPositionBuilderAtEnd(builder, outerBody);
+    LLVMBuildStore(builder, zero, j);
+    LLVMBuildBr(builder, innerCond);
+
+    LLVMPositionBuilderAtEnd(builder, innerCond);
+    LLVMValueRef jVal = LLVMBuildLoad2(builder, LLVMInt32Type(), j, "");
+    LLVMBuildCondBr(builder, LLVMBuildICmp(builder, LLVMIntSLT, jVal, param, ""), innerBody, outerLatch);
+
+    // the multiply only uses the parameter - should leave both loops
+    // the add uses i - should leave the inner loop only
+    LLVMPositionBuilderAtEnd(builder, innerBody);
+    LLVMValueRef mul = LLVMBuildMul(builder, param, LLVMConstInt(LLVMInt32Type(), 3, false), "");
+    LLVMValueRef iVal2 = LLVMBuildLoad2(builder, LLVMInt32Type(), i, "");
+    LLVMValueRef add = LLVMBuildAdd(builder, iVal2, mul, "");
+    LLVMValueRef sVal = LLVMBuildLoad2(builder, LLVMInt32Type(), s, "");
+    LLVMBuildStore(builder, LLVMBuildAdd(builder, sVal, add, ""), s);
+    LLVMValueRef jVal2 = LLVMBuildLoad2(builder, LLVMInt32Type(), j, "");
+    LLVMBuildStore(builder, LLVMBuildAdd(builder, jVal2, one, ""), j);
+    LLVMBuildBr(builder, innerCond);
+
+    LLVMPositionBuilderAtEnd(builder, outerLatch);
+    LLVMValueRef iVal3 = LLVMBuildLoad2(builder, LLVMInt32Type(), i, "");
+    LLVMBuildStore(builder, LLVMBuildAdd(builder, iVal3, one, ""), i);
+    LLVMBuildBr(builder, outerCond);
+
+    LLVMPositionBuilderAtEnd(builder, final);
+    LLVMValueRef sVal2 = LLVMBuildLoad2(builder, LLVMInt32Type(), s, "");
+    LLVMBuildRet(builder, sVal2);
+
+    return mod;
+}
@@ -0,0 +1,341 @@
+/*
+ * Library that schedules the function passes of the optimizer, rerunning a pass
+ * on a function only when the function changed since the pass last left it unchanged,
+ * and caches the analyses the passes depend on
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "pass_manager.h"
+#include "../helper/dominators.h"
+#include "../helper/loops.h"
+#include "../helper/time_report.h"
+//#define NDEBUG
+#include <cassert>
+
+using namespace std;
+
+/* FUNCTION PROTOTYPES */
+/* ------------------- */
+bool runPass(optimizerPass* pass, LLVMValueRef func);
+void computeCFG(LLVMValueRef func, functionAnalyses* analyses);
+void computeDominators(functionAnalyses* analyses);
+void computeFrontiers(functionAnalyses* analyses);
+void computePostDominators(functionAnalyses* analyses);
+void computeLoops(functionAnalyses* analyses);
+
+/* GLOBAL VARIABLES */
+/* ---------------- */
+thread_local vector<optimizerPass> passes; // in the order they run each round
+thread_local unordered_map<LLVMValueRef, int> functionVersion; // bumped every time a pass changes the function
+thread_local unordered_map<LLVMValueRef, functionAnalyses> analysisCache;
+
+thread_local int erasedInstructions; // erased by all passes so far
+thread_local int instructionsRevisited; // in the current round
+thread_local vector<int> revisitCounts; // instructions revisited in each round of the last runPasses
+
+/* FUNCTIONS */
+/* --------- */
+
+/* removes all passes and their statistics */
+void clearPasses() {
+    passes.clear();
+}
+
+/* appends a pass to the end of each round
+ * the required analyses are up to date when the pass runs, and stay cached
+ * across changes as long as the pass preserves the CFG
+ */
+void addPass(const char* name, bool (*run)(LLVMValueRef func), vector<analysis_type> required, bool preservesCFG) {
+    assert(name != NULL && run != NULL);
+
+    optimizerPass pass;
+    pass.name = name;
+    pass.run = run;
+    pass.required = required;
+    pass.preservesCFG = preservesCFG;
+    pass.runs = 0;
+    pass.skips = 0;
+    pass.removed = 0;
+    pass.ms = 0;
+    pass.peakRSS = 0;
+
+    passes.push_back(pass);
+}
+
+/* runs the passes in rounds until a round changes nothing
+ * a pass is skipped on a function that has not changed since the pass last ran on it
+ * without effect, so functions that have settled are not revisited by later rounds
+ * returns the number of rounds
+ */
+int runPasses(LLVMModuleRef mod) {
+    assert(mod != NULL);
+
+    // functions of a previous module may share addresses with this one's
+    functionVersion.clear();
+    analysisCache.clear();
+    revisitCounts.clear();
+    vector<optimizerPass>::iterator passIt = passes.begin();
+    while(passIt != passes.end()) {
+        passIt->cleanVersion.clear();
+        passIt++;
+    }
+
+    int rounds = 0;
+    bool changed = true;
+    while(changed) {
+        changed = false;
+        instructionsRevisited = 0;
+        rounds++;
+
+        passIt = passes.begin();
+        while(passIt != passes.end()) {
+
+            for(LLVMValueRef function = LLVMGetFirstFunction(mod);
+                function;
+                function = LLVMGetNextFunction(function)) {
+
+                // declarations have nothing to optimize
+                if(!LLVMGetFirstBasicBlock(function)) {
+                    continue;
+                }
+
+                changed |= runPass(&(*passIt), function);
+            }
+
+            passIt++;
+        }
+
+        revisitCounts.push_back(instructionsRevisited);
+    }
+
+    analysisCache.clear();
+
+    // report each pass as part of the phase that ran them
+    passIt = passes.begin();
+    while(passIt != passes.end()) {
+        recordPhase(passIt->name, passIt->runs, passIt->ms, passIt->peakRSS, passIt->removed);
+        passIt++;
+    }
+
+    return rounds;
+}
+
+/* runs a single pass on a function if the function is dirty for it,
+ * updating the pass statistics and the function version
+ * returns true if the function changed
+ */
+bool runPass(optimizerPass* pass, LLVMValueRef func) {
+    int version = functionVersion[func];
+
+    // the function is exactly as the pass last left it with nothing to do
+    unordered_map<LLVMValueRef, int>::iterator clean = pass->cleanVersion.find(func);
+    if(clean != pass->cleanVersion.end() && clean->second == version) {
+        pass->skips++;
+        return false;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int erasedBefore = erasedInstructions;
+
+    vector<analysis_type>::iterator it = pass->required.begin();
+    while(it != pass->required.end()) {
+        requireAnalysis(func, *it);
+        it++;
+    }
+    bool changed = (*pass->run)(func);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    pass->ms += elapsedMs(start, end);
+    pass->removed += erasedInstructions - erasedBefore;
+    pass->runs++;
+    if(timeReportEnabled()) {
+        pass->peakRSS = getPeakRSS();
+    }
+
+    if(changed) {
+        // every pass, including this one, may find more to do
+        functionVersion[func] = version + 1;
+        pass->cleanVersion.erase(func);
+        if(!pass->preservesCFG) {
+            invalidateAnalyses(func);
+        }
+    } else {
+        pass->cleanVersion[func] = version;
+    }
+
+    return changed;
+}
+
+/* ANALYSES */
+/* -------- */
+
+/* returns the cached analyses of the function, computing the requested one
+ * (and the ones it depends on) if it is missing or was invalidated
+ */
+functionAnalyses* requireAnalysis(LLVMValueRef func, analysis_type type) {
+    assert(func != NULL);
+
+    unordered_map<LLVMValueRef, functionAnalyses>::iterator found = analysisCache.find(func);
+    if(found == analysisCache.end()) {
+        found = analysisCache.emplace(func, functionAnalyses()).first;
+        found->second.cfgValid = false;
+        found->second.dominatorsValid = false;
+        found->second.frontiersValid = false;
+        found->second.postDominatorsValid = false;
+        found->second.loopsValid = false;
+    }
+    functionAnalyses* analyses = &found->second;
+
+    switch(type) {
+        case(analysis_loops): {
+            if(!analyses->loopsValid) {
+                requireAnalysis(func, analysis_dominators);
+                computeLoops(analyses);
+            }
+            break;
+        }
+
+        case(analysis_postdominators): {
+            if(!analyses->postDominatorsValid) {
+                if(!analyses->cfgValid) {
+                    computeCFG(func, analyses);
+                }
+                computePostDominators(analyses);
+            }
+            break;
+        }
+
+        case(analysis_frontiers): {
+            if(!analyses->frontiersValid) {
+                requireAnalysis(func, analysis_dominators);
+                computeFrontiers(analyses);
+            }
+            break;
+        }
+
+        case(analysis_dominators): {
+            if(!analyses->dominatorsValid) {
+                if(!analyses->cfgValid) {
+                    computeCFG(func, analyses);
+                }
+                computeDominators(analyses);
+            }
+            break;
+        }
+
+        case(analysis_cfg): {
+            if(!analyses->cfgValid) {
+                computeCFG(func, analyses);
+            }
+            break;
+        }
+    }
+
+    return analyses;
+}
+
+/* drops every cached analysis of the function, to be called whenever its CFG changes */
+void invalidateAnalyses(LLVMValueRef func) {
+    analysisCache.erase(func);
+}
+
+/* numbers the blocks of the function in reverse postorder (the entry is 0) and
+ * stores its edges by block number, so that the analyses can walk them without hashing
+ */
+void computeCFG(LLVMValueRef func, functionAnalyses* analyses) {
+    controlFlowGraph cfg = buildControlFlowGraph(func);
+    analyses->blocks.swap(cfg.blocks);
+    analyses->blockIndex.swap(cfg.blockIndex);
+    analyses->numReachable = cfg.numReachable;
+    swap(analyses->predecessors, cfg.predecessors);
+    swap(analyses->successors, cfg.successors);
+    analyses->cfgValid = true;
+}
+
+/* computes the immediate dominators and dominator tree from the numbered CFG */
+void computeDominators(functionAnalyses* analyses) {
+    assert(analyses->cfgValid);
+
+    analyses->idom = computeImmediateDominators(analyses->predecessors, analyses->successors, 0);
+    analyses->domTree = generateDominatorTree(analyses->idom);
+    numberDominatorTree(analyses->domTree, analyses->idom, analyses->domPreorder, analyses->domPostorder);
+    analyses->dominatorsValid = true;
+}
+
+/* computes the dominance frontiers from the immediate dominators */
+void computeFrontiers(functionAnalyses* analyses) {
+    assert(analyses->dominatorsValid);
+
+    analyses->frontiers = computeDominanceFrontiers(analyses->predecessors, analyses->idom, 0);
+    analyses->frontiersValid = true;
+}
+
+/* computes the immediate post-dominators, post-dominator tree and post-dominance
+ * frontiers from the numbered CFG
+ */
+void computePostDominators(functionAnalyses* analyses) {
+    assert(analyses->cfgValid);
+
+    analyses->ipdom = computeImmediatePostDominators(analyses->successors);
+    analyses->postDomTree = generateDominatorTree(analyses->ipdom);
+    analyses->postFrontiers = computePostDominanceFrontiers(analyses->successors, analyses->ipdom);
+    analyses->postDominatorsValid = true;
+}
+
+/* finds the natural loops from the dominator tree */
+void computeLoops(functionAnalyses* analyses) {
+    assert(analyses->dominatorsValid);
+
+    loopNest nest = findLoops(analyses->successors, analyses->predecessors, analyses->idom, analyses->domPreorder, analyses->domPostorder, 0);
+    analyses->loops.swap(nest.loops);
+    analyses->innermostLoop.swap(nest.innermostLoop);
+    analyses->loopDepth.swap(nest.loopDepth);
+    analyses->loopsValid = true;
+}
+
+/* checks if a block dominates another, by their numbers, in constant time
+ * the analyses must include analysis_dominators
+ */
+bool blockDominates(functionAnalyses* analyses, int dominator, int block) {
+    assert(analyses->dominatorsValid);
+    return dominates(analyses->domPreorder, analyses->domPostorder, dominator, block);
+}
+
+/* STATISTICS */
+/* ---------- */
+
+/* counts an instruction erased by the running pass */
+void recordErasedInstruction() {
+    erasedInstructions++;
+}
+
+/* counts instructions revisited by the running pass in the current round */
+void recordRevisitedInstructions(int count) {
+    instructionsRevisited += count;
+}
+
+/* returns the number of instructions revisited in each round of the last runPasses */
+vector<int> getRevisitCounts() {
+    return revisitCounts;
+}
+
+/* returns the passes with their statistics */
+const vector<optimizerPass>& getPasses() {
+    return passes;
+}
+
+/* prints the time spent in and instructions removed by each pass */
+void printPassStatistics(FILE* out) {
+    assert(out != NULL);
+
+    fprintf(out, "%-32s %8s %8s %10s %12s\n", "pass", "runs", "skipped", "removed", "time (ms)");
+
+    vector<optimizerPass>::iterator it = passes.begin();
+    while(it != passes.end()) {
+        fprintf(out, "%-32s %8d %8d %10d %12.3f\n", it->name, it->runs, it->skips, it->removed, it->ms);
+        it++;
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef PASS_MANAGER_H
+#define PASS_MANAGER_H
+
+#include <llvm-c/Core.h>
+#include <llvm-c/Types.h>
+#include <stdio.h>
+#include <unordered_map>
+#include <set>
+#include <array>
+#include <vector>
+#include "../helper/cfg.h"
+#include "../helper/loops.h"
+
+using namespace std;
+
+//enum to identify the analyses a pass can depend on
+typedef enum {
+		analysis_cfg, // the numbered blocks and their edges
+		analysis_dominators, // immediate dominators and the dominator tree, requires analysis_cfg
+		analysis_frontiers, // dominance frontiers, requires analysis_dominators
+		analysis_postdominators, // immediate post-dominators, the post-dominator tree and its frontiers, requires analysis_cfg
+		analysis_loops // natural loops and the loop depth of each block, requires analysis_dominators
+	} analysis_type;
+
+/* analyses of a single function, cached until a pass that changes the CFG invalidates them */
+typedef struct {
+		bool cfgValid;
+		bool dominatorsValid;
+		bool frontiersValid;
+		bool postDominatorsValid;
+		bool loopsValid;
+
+		// analysis_cfg
+		vector<LLVMBasicBlockRef> blocks; // block number to block, in reverse postorder (the entry is 0)
+		unordered_map<LLVMBasicBlockRef, int> blockIndex; // block to block number
+		int numReachable; // the blocks numbered from it on are unreachable
+		csrGraph predecessors;
+		csrGraph successors;
+
+		// analysis_dominators
+		vector<int> idom; // -1 for the entry and unreachable blocks
+		vector<vector<int>> domTree; // children of each block in the dominator tree
+		vector<int> domPreorder; // numbering of the dominator tree for dominates()
+		vector<int> domPostorder;
+
+		// analysis_frontiers
+		vector<vector<int>> frontiers; // blocks where the dominance of each block ends
+
+		// analysis_postdominators, with the virtual exit numbered after the last block
+		vector<int> ipdom; // -1 for the virtual exit and blocks that reach no exit
+		vector<vector<int>> postDomTree; // children of each block in the post-dominator tree
+		vector<vector<int>> postFrontiers; // blocks each block is control dependent on
+
+		// analysis_loops
+		vector<naturalLoop> loops; // each loop before the loops it contains
+		vector<int> innermostLoop; // -1 for blocks in no loop
+		vector<int> loopDepth;
+	} functionAnalyses;
+
+/* a function pass and the statistics collected for it */
+typedef struct {
+		const char* name;
+		bool (*run)(LLVMValueRef func); // returns true if the function changed
+		vector<analysis_type> required; // analyses computed before the pass runs
+		bool preservesCFG; // if false, a change invalidates the function's analyses
+
+		unordered_map<LLVMValueRef, int> cleanVersion; // function version the pass last left unchanged
+		int runs;
+		int skips; // times the function had not changed since the pass last left it unchanged
+		int removed; // instructions erased
+		double ms;
+		long peakRSS; // in KB, only sampled while the time report is enabled
+	} optimizerPass;
+
+/* FUNCTIONS */
+/* --------- */
+
+void clearPasses();
+void addPass(const char* name, bool (*run)(LLVMValueRef func), vector<analysis_type> required, bool preservesCFG);
+int runPasses(LLVMModuleRef mod);
+
+functionAnalyses* requireAnalysis(LLVMValueRef func, analysis_type type);
+void invalidateAnalyses(LLVMValueRef func);
+bool blockDominates(functionAnalyses* analyses, int dominator, int block);
+
+void recordErasedInstruction();
+void recordRevisitedInstructions(int count);
+vector<int> getRevisitCounts();
+const vector<optimizerPass>& getPasses();
+void printPassStatistics(FILE* out);
+
+#endif
@@ -0,0 +1,243 @@
+/*
+ * This is a benchmark program for the promotion of variables to registers which compiles each given
+ * source, and a generated source of nested loops, three times: with the variables left in memory
+ * (optimizeLLVM_memory), promoted (optimizeLLVM) and built straight into SSA form. It links the assembly
+ * of each with bench_runner.c, runs them and prints the loads and stores left in the IR, the instructions
+ * of the assembly and those among them that access the stack, and the best time per call, checking that
+ * the promoted and SSA builds print and return the same as the one in memory
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <string>
+#include <llvm-c/Core.h>
+#include "../syntax_analyzer/semantic_analysis.h"
+#include "../syntax_analyzer/parser.h"
+#include "../llvm_ir_builder/llvm_gen.h"
+#include "../assembly_generator/llvm_to_assembly.h"
+#include "llvm_optimizations.h"
+using namespace std;
+
+#define RUNNER "bench_runner.c" // linked with the generated assembly, built for 32-bit x86
+#define KERNEL_SOURCE "runtime_kernel.c"
+#define KERNEL_ARGUMENT 100
+#define NUM_BUILDS 3
+
+/* what is counted and timed for a build */
+typedef struct {
+        int memoryAccesses; // loads and stores left in the optimized IR
+        int instructions; // of the assembly
+        int stackAccesses; // instructions of the assembly with an operand on the stack
+        unsigned checksum; // of what the program printed and returned
+        double ns; // best time per call, -1 if the program did not run to the end
+    } runStats;
+
+/* FUNCTION PROTOTYPES */
+/* ------------------- */
+
+bool benchSource(const char* path, int arg, int calls, int repeats);
+bool compileSource(const char* path, int build, const char* output, runStats* stats);
+void countAssembly(const char* path, runStats* stats);
+bool runProgram(const char* binary, int arg, int calls, int repeats, runStats* stats);
+void printStats(const char* name, const char* build, runStats* stats);
+string kernelSource();
+
+
+/* MAIN */
+/* ---- */
+
+int main(int argc, char** argv){
+
+    // runtime_bench [calls] [repeats] [sources]
+    int calls = (argc > 1) ? atoi(argv[1]) : 1000;
+    int repeats = (argc > 2) ? atoi(argv[2]) : 5;
+    assert(calls > 0 && repeats > 0);
+
+    printf("%-16s %-9s %8s %8s %8s %12s\n", "source", "build", "ld/st", "asm", "stack", "ns/call");
+    int failures = 0;
+    for(int i = 3; i < argc; i++) {
+        failures += !benchSource(argv[i], 10, calls, repeats);
+    }
+
+    FILE* kernel = fopen(KERNEL_SOURCE, "w");
+    assert(kernel != NULL);
+    fputs(kernelSource().c_str(), kernel);
+    fclose(kernel);
+    failures += !benchSource(KERNEL_SOURCE, KERNEL_ARGUMENT, calls, repeats);
+
+    printf("%d failed\n", failures);
+    return (failures == 0) ? 0 : 1;
+}
+
+/* compiles the source each way, then runs each program the given number of times,
+ * each calling func with the argument that many times
+ * returns false if the programs print or return different values
+ */
+bool benchSource(const char* path, int arg, int calls, int repeats) {
+    const char* name = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+    const char* builds[] = { "memory", "promoted", "ssa" };
+    runStats stats[NUM_BUILDS];
+
+    for(int b = 0; b < NUM_BUILDS; b++) {
+        string base = string(name) + "." + builds[b];
+        if(!compileSource(path, b, (base + ".s").c_str(), &stats[b])) {
+            printf("%-16s skipped, it does not parse and check\n", name);
+            return true;
+        }
+
+        string link = "as --32 " + base + ".s -o " + base + ".o && gcc -m32 " RUNNER " " + base + ".o -o " + base + ".bin";
+        if(system(link.c_str()) != 0) {
+            printf("FAIL: could not assemble and link %s\n", (base + ".s").c_str());
+            return false;
+        }
+        runProgram(("./" + base + ".bin").c_str(), arg, calls, repeats, &stats[b]);
+        printStats(name, builds[b], &stats[b]);
+    }
+
+    for(int b = 0; b < NUM_BUILDS; b++) {
+        if(stats[b].ns < 0) {
+            printf("%-16s did not run to the end\n", name);
+            return true;
+        }
+    }
+    for(int b = 1; b < NUM_BUILDS; b++) {
+        if(stats[b].checksum != stats[0].checksum) {
+            printf("FAIL: the %s build of %s prints or returns different values\n", builds[b], name);
+            return false;
+        }
+    }
+    printf("%-16s %-9s %38.2fx\n", name, "speedup", stats[0].ns / stats[1].ns);
+    return true;
+}
+
+/* builds, optimizes and generates assembly for the source as the compiler does, with its variables
+ * in memory (build 0), promoted (1) or built in SSA form (2, as with --ssa), and counts the memory
+ * accesses left in the IR and the assembly
+ * returns false if the source does not parse or check
+ */
+bool compileSource(const char* path, int build, const char* output, runStats* stats) {
+    FILE* input = fopen(path, "r");
+    if(input == NULL) {
+        return false;
+    }
+    astArena* arena = createArena();
+    astNode* root = parseFile(input, arena);
+    fclose(input);
+    if(root == NULL || !semanticAnalysis_opt(root)) {
+        freeArena(arena);
+        return false;
+    }
+
+    LLVMContextRef context = LLVMContextCreate();
+    LLVMModuleRef mod;
+    if(build == 2) {
+        mod = createLLVMModelFromAST_ssa(root, (char*) path, context);
+    } else {
+        mod = createLLVMModelFromASTInContext(root, (char*) path, context);
+    }
+    optimizeLLVMBasicBlocks(mod);
+    if(build == 0) {
+        optimizeLLVM_memory(mod);
+    } else {
+        optimizeLLVM(mod);
+    }
+
+    stats->memoryAccesses = 0;
+    for(LLVMValueRef func = LLVMGetFirstFunction(mod); func; func = LLVMGetNextFunction(func)) {
+        for(LLVMBasicBlockRef bb = LLVMGetFirstBasicBlock(func); bb; bb = LLVMGetNextBasicBlock(bb)) {
+            for(LLVMValueRef instruction = LLVMGetFirstInstruction(bb); instruction; instruction = LLVMGetNextInstruction(instruction)) {
+                LLVMOpcode opcode = LLVMGetInstructionOpcode(instruction);
+                stats->memoryAccesses += (opcode == LLVMLoad || opcode == LLVMStore);
+            }
+        }
+    }
+
+    codegen(mod, (char*) output);
+    LLVMDisposeModule(mod);
+    LLVMContextDispose(context);
+    freeArena(arena);
+
+    countAssembly(output, stats);
+    return true;
+}
+
+/* counts the instructions of the assembly file, and those with an operand relative to %ebp */
+void countAssembly(const char* path, runStats* stats) {
+    stats->instructions = 0;
+    stats->stackAccesses = 0;
+
+    FILE* assembly = fopen(path, "r");
+    assert(assembly != NULL);
+    char line[256];
+    while(fgets(line, sizeof(line), assembly) != NULL) {
+        // instructions are indented, labels are not, and directives start with a dot
+        char* text = line + strspn(line, " \t");
+        if(text == line || *text == '.' || *text == '\n' || *text == '\0') {
+            continue;
+        }
+        stats->instructions++;
+        stats->stackAccesses += (strstr(text, "(%ebp)") != NULL);
+    }
+    fclose(assembly);
+}
+
+/* runs the program the given number of times, keeping the best time per call
+ * returns false, with the time set to -1, if a run did not print its checksum
+ */
+bool runProgram(const char* binary, int arg, int calls, int repeats, runStats* stats) {
+    char command[512];
+    snprintf(command, sizeof(command), "%s %d %d", binary, calls, arg);
+    stats->ns = -1;
+
+    for(int r = 0; r < repeats; r++) {
+        FILE* output = popen(command, "r");
+        assert(output != NULL);
+        unsigned checksum;
+        double ns;
+        int read = fscanf(output, "%u %lf", &checksum, &ns);
+        if(pclose(output) != 0 || read != 2) {
+            stats->ns = -1;
+            return false;
+        }
+
+        stats->checksum = checksum;
+        if(stats->ns < 0 || ns < stats->ns) {
+            stats->ns = ns;
+        }
+    }
+    return true;
+}
+
+void printStats(const char* name, const char* build, runStats* stats) {
+    char ns[32];
+    if(stats->ns < 0) {
+        snprintf(ns, sizeof(ns), "-");
+    } else {
+        snprintf(ns, sizeof(ns), "%.1f", stats->ns);
+    }
+    printf("%-16s %-9s %8d %8d %8d %12s\n", name, build, stats->memoryAccesses, stats->instructions, stats->stackAccesses, ns);
+}
+
+/* returns a miniC program that runs nested loops over its argument,
+ * branching on values carried around both loops (an expression has at most one operator)
+ */
+string kernelSource() {
+    string source = "extern void print(int);\nextern int read();\n\nint func(int n){\n";
+    source += "\tint i;\n\tint j;\n\tint sum;\n\tint t;\n";
+    source += "\tsum = 0;\n\ti = 0;\n";
+    source += "\twhile (i < n){\n";
+    source += "\t\tj = 0;\n";
+    source += "\t\twhile (j < n){\n";
+    source += "\t\t\tt = i * j;\n";
+    source += "\t\t\tt = t + sum;\n";
+    source += "\t\t\tif (t > 1000) {\n\t\t\t\tsum = t - 1000;\n\t\t\t} else {\n\t\t\t\tsum = t + i;\n\t\t\t}\n";
+    source += "\t\t\tj = j + 1;\n";
+    source += "\t\t}\n";
+    source += "\t\ti = i + 1;\n";
+    source += "\t}\n";
+    source += "\tprint(sum);\n";
+    source += "\treturn sum;\n}\n";
+    return source;
+}
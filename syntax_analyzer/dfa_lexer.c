@@ -0,0 +1,471 @@
+/*
+ * Library that scans miniC with a hand-written, table-driven DFA instead of flex:
+ * characters are mapped to a handful of classes, the DFA runs over the classes to the
+ * longest token, keywords are told apart from names with a perfect hash, and runs of
+ * whitespace and identifier characters are scanned 16 (SSE2) or 32 (AVX2) bytes at a time
+ *
+ * Built with DFA_LEXER defined, it also provides the flex scanner interface the parser calls
+ * (yylex, yylex_init, yy_scan_buffer, ...) so it can be linked in place of lex.yy.c
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#include "../lib/ast/ast.h"
+#include "dfa_lexer.h"
+//#define NDEBUG
+#include <cassert>
+
+using namespace std;
+
+/* the classes the DFA reads instead of characters */
+typedef enum {
+		class_other, // no token starts or continues with it
+		class_space, // space or tab
+		class_newline,
+		class_letter,
+		class_digit,
+		class_underscore,
+		class_single, // a token of its own: ; + - / * ( ) { }
+		class_lt,
+		class_gt,
+		class_equals,
+		class_bang,
+		num_classes
+	} char_class;
+
+/* states of the DFA, the start state reading the first character of a token */
+typedef enum {
+		state_dead,
+		state_start,
+		state_name, // a name that ends with a letter or digit
+		state_name_underscore, // a name that ends with '_', which a NAME cannot
+		state_num,
+		state_single,
+		state_lt,
+		state_gt,
+		state_assign,
+		state_bang,
+		state_le,
+		state_ge,
+		state_eq,
+		state_neq,
+		num_states
+	} dfa_state;
+
+#define ACCEPT_NONE 0 // not an accepting state
+#define ACCEPT_CHAR -1 // accepts the character itself as the token
+
+/* FUNCTION PROTOTYPES */
+/* ------------------- */
+bool buildCharClasses(uint8_t* classes);
+size_t skipWhitespace(dfaScanner* scanner, size_t pos);
+size_t skipIdentifier(const char* data, size_t pos, size_t end);
+int keywordToken(const char* text, size_t length);
+int numberValue(const char* text, size_t length);
+
+/* GLOBAL VARS */
+/* ----------- */
+
+uint8_t charClasses[256]; // class of every character
+bool charClassesBuilt = buildCharClasses(charClasses); // before main, so before any thread scans
+
+// the next state for each state and class, columns in the order of char_class
+const uint8_t transitions[num_states][num_classes] = {
+	/* dead */ { state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead },
+	/* start */ { state_dead, state_dead, state_dead, state_name, state_num, state_dead, state_single, state_lt, state_gt, state_assign, state_bang },
+	/* name */ { state_dead, state_dead, state_dead, state_name, state_name, state_name_underscore, state_dead, state_dead, state_dead, state_dead, state_dead },
+	/* name_underscore */ { state_dead, state_dead, state_dead, state_name, state_name, state_name_underscore, state_dead, state_dead, state_dead, state_dead, state_dead },
+	/* num */ { state_dead, state_dead, state_dead, state_dead, state_num, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead },
+	/* single */ { state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead },
+	/* lt */ { state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_le, state_dead },
+	/* gt */ { state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_ge, state_dead },
+	/* assign */ { state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_eq, state_dead },
+	/* bang */ { state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_neq, state_dead },
+	/* le */ { state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead },
+	/* ge */ { state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead },
+	/* eq */ { state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead },
+	/* neq */ { state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead, state_dead }
+};
+
+// the token each state accepts, in the order of dfa_state (names and numbers are finished by dfaLex)
+const int accepts[num_states] = {
+	ACCEPT_NONE, ACCEPT_NONE, NAME, ACCEPT_NONE, NUM, ACCEPT_CHAR,
+	LT, GT, '=', ACCEPT_NONE, LE, GE, EQ, NEQ
+};
+
+/* the keywords, each in the slot of the perfect hash
+ * (length + first character + 7 * last character) % 16, which no two of them share
+ */
+typedef struct {
+		const char* text;
+		int token;
+	} keyword;
+
+const keyword keywords[16] = {
+	{ NULL, 0 }, { "print", PRINT }, { "read", READ }, { NULL, 0 },
+	{ NULL, 0 }, { "if", IF }, { "void", VOID }, { NULL, 0 },
+	{ "int", INT }, { NULL, 0 }, { "return", RETURN }, { NULL, 0 },
+	{ "else", ELSE }, { "extern", EXTERN }, { NULL, 0 }, { "while", WHILE }
+};
+
+/* FUNCTIONS */
+/* --------- */
+
+/* scans the source in memory, which must be followed by two NUL bytes
+ * the scanner only reads it, so it may be shared and is not freed with the scanner
+ */
+void dfaScanBuffer(dfaScanner* scanner, const char* data, size_t size) {
+    assert(scanner != NULL && data != NULL);
+    assert(data[size] == '\0' && data[size + 1] == '\0');
+    scanner->data = data;
+    scanner->size = size;
+    scanner->pos = 0;
+    scanner->lineno = 1;
+    scanner->owned = NULL;
+}
+
+/* reads the rest of the file into memory and scans it
+ * returns false, leaving an empty source to scan, if it could not be read
+ */
+bool dfaScanFile(dfaScanner* scanner, FILE* file) {
+    assert(scanner != NULL && file != NULL);
+
+    size_t capacity = 1 << 16;
+    size_t size = 0;
+    char* data = (char*) malloc(capacity);
+    while(data != NULL) {
+        size += fread(data + size, 1, capacity - size - 2, file);
+        if(size < capacity - 2) {
+            break;
+        }
+        capacity *= 2;
+        char* grown = (char*) realloc(data, capacity);
+        if(grown == NULL) {
+            free(data);
+        }
+        data = grown;
+    }
+
+    if(data == NULL || ferror(file)) {
+        free(data);
+        dfaScanBuffer(scanner, "\0", 0);
+        return false;
+    }
+
+    data[size] = '\0';
+    data[size + 1] = '\0';
+    dfaScanBuffer(scanner, data, size);
+    scanner->owned = data;
+    return true;
+}
+
+/* frees the source if the scanner read it from a file */
+void dfaRelease(dfaScanner* scanner) {
+    assert(scanner != NULL);
+    free(scanner->owned);
+    scanner->owned = NULL;
+}
+
+/* returns the next token, setting yylval for names, numbers and the externs,
+ * or 0 at the end of the source
+ * the DFA runs from the start state until it dies, and the token is the longest prefix
+ * that ended in an accepting state; a character that starts no token is echoed and skipped
+ */
+int dfaLex(dfaScanner* scanner, YYSTYPE* yylval) {
+    assert(scanner != NULL && yylval != NULL);
+    const char* data = scanner->data;
+
+    while(true) {
+        size_t start = skipWhitespace(scanner, scanner->pos);
+        if(start >= scanner->size) {
+            scanner->pos = scanner->size;
+            return 0;
+        }
+
+        // reading past the source is safe, as it ends with a NUL, which kills every state
+        int state = state_start;
+        int accepted = state_dead;
+        size_t end = start;
+        size_t pos = start;
+        while(true) {
+            state = transitions[state][charClasses[(unsigned char) data[pos]]];
+            if(state == state_dead) {
+                break;
+            }
+            pos++;
+
+            // the name states only loop on themselves, so the rest of the run is scanned at once,
+            // and the name ends at its last letter or digit
+            if(state == state_name) {
+                end = skipIdentifier(data, pos, scanner->size);
+                while(data[end - 1] == '_') {
+                    end--;
+                }
+                accepted = state_name;
+                break;
+            }
+
+            if(accepts[state] != ACCEPT_NONE) {
+                accepted = state;
+                end = pos;
+            }
+        }
+
+        // flex's default rule: echo the character and carry on
+        if(accepted == state_dead) {
+            fputc(data[start], stdout);
+            scanner->pos = start + 1;
+            continue;
+        }
+
+        scanner->pos = end;
+        const char* text = data + start;
+        size_t length = end - start;
+        switch(accepts[accepted]) {
+            case(NAME): {
+                int token = keywordToken(text, length);
+                if(token == PRINT) {
+                    yylval->ival = id_print;
+                } else if(token == READ) {
+                    yylval->ival = id_read;
+                } else if(token == NAME) {
+                    yylval->ival = internName(text, length);
+                }
+                return token;
+            }
+
+            case(NUM): {
+                yylval->ival = numberValue(text, length);
+                return NUM;
+            }
+
+            case(ACCEPT_CHAR): {
+                return text[0];
+            }
+
+            default: {
+                return accepts[accepted];
+            }
+        }
+    }
+}
+
+/* fills in the class of every character, returning true once done */
+bool buildCharClasses(uint8_t* classes) {
+    memset(classes, class_other, 256);
+    classes[(unsigned char) ' '] = class_space;
+    classes[(unsigned char) '\t'] = class_space;
+    classes[(unsigned char) '\n'] = class_newline;
+    for(int c = 'a'; c <= 'z'; c++) {
+        classes[c] = class_letter;
+        classes[c - 'a' + 'A'] = class_letter;
+    }
+    for(int c = '0'; c <= '9'; c++) {
+        classes[c] = class_digit;
+    }
+    classes[(unsigned char) '_'] = class_underscore;
+    const char* singles = ";+-/*(){}";
+    for(int i = 0; singles[i] != '\0'; i++) {
+        classes[(unsigned char) singles[i]] = class_single;
+    }
+    classes[(unsigned char) '<'] = class_lt;
+    classes[(unsigned char) '>'] = class_gt;
+    classes[(unsigned char) '='] = class_equals;
+    classes[(unsigned char) '!'] = class_bang;
+    return true;
+}
+
+/* returns the position of the first character at or after pos that is not a space, tab or newline,
+ * counting the newlines skipped into the scanner's line number
+ */
+size_t skipWhitespace(dfaScanner* scanner, size_t pos) {
+    const char* data = scanner->data;
+    size_t limit = scanner->size + 2; // the vector loads may read the two NUL bytes, but no further
+
+#if defined(__AVX2__)
+    const __m256i spaces = _mm256_set1_epi8(' ');
+    const __m256i tabs = _mm256_set1_epi8('\t');
+    const __m256i newlines = _mm256_set1_epi8('\n');
+    while(pos + 32 <= limit) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*) (data + pos));
+        __m256i isNewline = _mm256_cmpeq_epi8(chunk, newlines);
+        __m256i isSpace = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, spaces), _mm256_cmpeq_epi8(chunk, tabs)), isNewline);
+        uint32_t space = (uint32_t) _mm256_movemask_epi8(isSpace);
+        uint32_t newline = (uint32_t) _mm256_movemask_epi8(isNewline);
+        if(space != 0xFFFFFFFFu) {
+            int skipped = __builtin_ctz(~space);
+            scanner->lineno += __builtin_popcount(newline & ((1u << skipped) - 1));
+            return pos + skipped;
+        }
+        scanner->lineno += __builtin_popcount(newline);
+        pos += 32;
+    }
+#elif defined(__SSE2__)
+    const __m128i spaces = _mm_set1_epi8(' ');
+    const __m128i tabs = _mm_set1_epi8('\t');
+    const __m128i newlines = _mm_set1_epi8('\n');
+    while(pos + 16 <= limit) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*) (data + pos));
+        __m128i isNewline = _mm_cmpeq_epi8(chunk, newlines);
+        __m128i isSpace = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, spaces), _mm_cmpeq_epi8(chunk, tabs)), isNewline);
+        uint32_t space = (uint32_t) _mm_movemask_epi8(isSpace);
+        uint32_t newline = (uint32_t) _mm_movemask_epi8(isNewline);
+        if(space != 0xFFFFu) {
+            int skipped = __builtin_ctz(~space);
+            scanner->lineno += __builtin_popcount(newline & ((1u << skipped) - 1));
+            return pos + skipped;
+        }
+        scanner->lineno += __builtin_popcount(newline);
+        pos += 16;
+    }
+#endif
+
+    // the rest of the source, a character at a time
+    while(pos < scanner->size && (data[pos] == ' ' || data[pos] == '\t' || data[pos] == '\n')) {
+        if(data[pos] == '\n') {
+            scanner->lineno++;
+        }
+        pos++;
+    }
+    return pos;
+}
+
+/* returns the position of the first character at or after pos that is not a letter, digit or '_'
+ * the source must be followed by two NUL bytes, which end the run, at end and end + 1
+ */
+size_t skipIdentifier(const char* data, size_t pos, size_t end) {
+    size_t limit = end + 2;
+
+#if defined(__AVX2__)
+    const __m256i lowerA = _mm256_set1_epi8('a' - 1);
+    const __m256i lowerZ = _mm256_set1_epi8('z' + 1);
+    const __m256i digit0 = _mm256_set1_epi8('0' - 1);
+    const __m256i digit9 = _mm256_set1_epi8('9' + 1);
+    const __m256i underscores = _mm256_set1_epi8('_');
+    const __m256i caseBit = _mm256_set1_epi8(0x20);
+    while(pos + 32 <= limit) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*) (data + pos));
+        __m256i lower = _mm256_or_si256(chunk, caseBit); // folds upper case letters onto lower case
+        __m256i isLetter = _mm256_and_si256(_mm256_cmpgt_epi8(lower, lowerA), _mm256_cmpgt_epi8(lowerZ, lower));
+        __m256i isDigit = _mm256_and_si256(_mm256_cmpgt_epi8(chunk, digit0), _mm256_cmpgt_epi8(digit9, chunk));
+        __m256i isIdentifier = _mm256_or_si256(_mm256_or_si256(isLetter, isDigit), _mm256_cmpeq_epi8(chunk, underscores));
+        uint32_t identifier = (uint32_t) _mm256_movemask_epi8(isIdentifier);
+        if(identifier != 0xFFFFFFFFu) {
+            return pos + __builtin_ctz(~identifier);
+        }
+        pos += 32;
+    }
+#elif defined(__SSE2__)
+    const __m128i lowerA = _mm_set1_epi8('a' - 1);
+    const __m128i lowerZ = _mm_set1_epi8('z' + 1);
+    const __m128i digit0 = _mm_set1_epi8('0' - 1);
+    const __m128i digit9 = _mm_set1_epi8('9' + 1);
+    const __m128i underscores = _mm_set1_epi8('_');
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+    while(pos + 16 <= limit) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*) (data + pos));
+        __m128i lower = _mm_or_si128(chunk, caseBit); // folds upper case letters onto lower case
+        __m128i isLetter = _mm_and_si128(_mm_cmpgt_epi8(lower, lowerA), _mm_cmplt_epi8(lower, lowerZ));
+        __m128i isDigit = _mm_and_si128(_mm_cmpgt_epi8(chunk, digit0), _mm_cmplt_epi8(chunk, digit9));
+        __m128i isIdentifier = _mm_or_si128(_mm_or_si128(isLetter, isDigit), _mm_cmpeq_epi8(chunk, underscores));
+        uint32_t identifier = (uint32_t) _mm_movemask_epi8(isIdentifier);
+        if(identifier != 0xFFFFu) {
+            return pos + __builtin_ctz(~identifier);
+        }
+        pos += 16;
+    }
+#endif
+
+    // the rest of the source, a character at a time
+    while(pos < end) {
+        uint8_t cls = charClasses[(unsigned char) data[pos]];
+        if(cls != class_letter && cls != class_digit && cls != class_underscore) {
+            break;
+        }
+        pos++;
+    }
+    return pos;
+}
+
+/* returns the token of a keyword, or NAME if the text is not one */
+int keywordToken(const char* text, size_t length) {
+    if(length < 2 || length > 6) {
+        return NAME;
+    }
+
+    unsigned slot = (length + (unsigned char) text[0] + 7 * (unsigned char) text[length - 1]) % 16;
+    const keyword* candidate = &keywords[slot];
+    if(candidate->text != NULL && strlen(candidate->text) == length && memcmp(candidate->text, text, length) == 0) {
+        return candidate->token;
+    }
+    return NAME;
+}
+
+/* returns the value of a run of digits as atoi would, saturating at LONG_MAX before the conversion to int */
+int numberValue(const char* text, size_t length) {
+    long value = 0;
+    for(size_t i = 0; i < length; i++) {
+        int digit = text[i] - '0';
+        if(value > (LONG_MAX - digit) / 10) {
+            value = LONG_MAX;
+            break;
+        }
+        value = value * 10 + digit;
+    }
+    return (int) value;
+}
+
+
+/* FLEX INTERFACE */
+/* -------------- */
+
+#ifdef DFA_LEXER
+
+/* the functions of the reentrant flex scanner the parser calls, each scanner a dfaScanner */
+
+int yylex_init(void** scanner) {
+    dfaScanner* created = (dfaScanner*) calloc(1, sizeof(dfaScanner));
+    if(created == NULL) {
+        return 1;
+    }
+    dfaScanBuffer(created, "\0", 0);
+    *scanner = created;
+    return 0;
+}
+
+void yyset_in(FILE* file, void* scanner) {
+    dfaRelease((dfaScanner*) scanner);
+    dfaScanFile((dfaScanner*) scanner, file);
+}
+
+/* scans the buffer in place, which holds size - 2 bytes of source and two NUL bytes,
+ * returning NULL if it does not end with them (like flex)
+ */
+struct yy_buffer_state* yy_scan_buffer(char* base, size_t size, void* scanner) {
+    if(size < 2 || base[size - 2] != '\0' || base[size - 1] != '\0') {
+        return NULL;
+    }
+    dfaRelease((dfaScanner*) scanner);
+    dfaScanBuffer((dfaScanner*) scanner, base, size - 2);
+    return (struct yy_buffer_state*) scanner;
+}
+
+int yyget_lineno(void* scanner) {
+    return ((dfaScanner*) scanner)->lineno;
+}
+
+int yylex(YYSTYPE* yylval, void* scanner) {
+    return dfaLex((dfaScanner*) scanner, yylval);
+}
+
+int yylex_destroy(void* scanner) {
+    dfaRelease((dfaScanner*) scanner);
+    free(scanner);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef DFA_LEXER_H
+#define DFA_LEXER_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "y.tab.h"
+
+/* state of the hand-written scanner over one source in memory
+ * it returns the same tokens, values and line numbers as the flex scanner (tokenizer.l),
+ * and echoes the characters no rule matches to stdout as flex does
+ */
+typedef struct {
+		const char* data; // the source, followed by two NUL bytes
+		size_t size; // bytes of source, not counting the two NUL bytes after it
+		size_t pos; // where the next token is scanned from
+		int lineno; // line of pos
+		char* owned; // data when read from a file by the scanner, freed with it
+	} dfaScanner;
+
+/* FUNCTIONS */
+/* --------- */
+
+void dfaScanBuffer(dfaScanner* scanner, const char* data, size_t size);
+bool dfaScanFile(dfaScanner* scanner, FILE* file);
+void dfaRelease(dfaScanner* scanner);
+int dfaLex(dfaScanner* scanner, YYSTYPE* yylval);
+
+#endif
@@ -1,23 +1,29 @@
+%code requires {
+#include "parser.h"
+}
+
 %{
 #include <stdio.h>
+#include <cassert>
 #include "../lib/ast/ast.h"
-void yyerror(const char *);
-extern int yylineno;
-extern int yylex();
 
-extern astNode* root;
+// the parser stack lives on the heap and grows by doubling, so let it grow far enough
+// for deeply nested generated programs (bison stops at 10000 states by default)
+#define YYMAXDEPTH 10000000
 %}
 
+%define api.pure full
+%parse-param {void* scanner} {parseContext* context}
+%lex-param {void* scanner}
+
 %union {
-	int ival;
-	char* string;
+	int ival; // a number, or the interned ID of a name
 	astNode* node;	
-	vector<astNode*>* stmt_vec;
+	astNodeList* stmt_vec;
 }
 
 %token EXTERN INT VOID RETURN IF ELSE WHILE LT GT LE GE EQ NEQ
-%token<ival> NUM
-%token<string> NAME READ PRINT
+%token<ival> NUM NAME READ PRINT
 %type<node> minic extern func_def
 %type<node> term expression condition 
 %type<node> statement assign_statement if_statement while_loop call_statement return_statement block_statement declaration
@@ -26,24 +32,37 @@ extern astNode* root;
 %nonassoc IF
 %nonassoc ELSE
 
+%code {
+int yylex(YYSTYPE* yylval, void* scanner);
+void yyerror(void* scanner, parseContext* context, const char *);
+
+int yylex_init(void** scanner);
+void yyset_in(FILE* file, void* scanner);
+int yyget_lineno(void* scanner);
+int yylex_destroy(void* scanner);
+struct yy_buffer_state* yy_scan_buffer(char* base, size_t size, void* scanner);
+
+astNode* runParser(parseContext* context);
+}
+
 %start minic
 %%
 minic:
-	extern extern func_def { $$ = createProg($1, $2, $3); root = $$; }
+	extern extern func_def { $$ = createProg($1, $2, $3); context->root = $$; }
 	;
 
 extern:
-	EXTERN VOID PRINT '(' INT ')' ';' { $$ = createExtern($3); free($3); } |
-	EXTERN INT READ '(' ')' ';' { $$ = createExtern($3); free($3); }
+	EXTERN VOID PRINT '(' INT ')' ';' { $$ = createExtern($3); } |
+	EXTERN INT READ '(' ')' ';' { $$ = createExtern($3); }
 	;
 
 func_def:
-	INT NAME '(' INT NAME ')' block_statement { $$ = createFunc($2, createVar($5), $7); free($2); free($5); } | 
-	INT NAME '(' ')' block_statement { $$ = createFunc($2, NULL, $5); free($2); }
+	INT NAME '(' INT NAME ')' block_statement { $$ = createFunc($2, createVar($5), $7); } | 
+	INT NAME '(' ')' block_statement { $$ = createFunc($2, NULL, $5); }
 	;
 
 term:
-	NAME { $$ = createVar($1); free($1); } |
+	NAME { $$ = createVar($1); } |
 	NUM { $$ = createCnst($1); }
 	;
 
@@ -51,23 +70,23 @@ block_statement:
 	'{' statements '}' { $$ = createBlock($2); } |
 	'{' var_decs statements '}' { 
 			$2->insert($2->end(), $3->begin(), $3->end()); 
-			delete($3); 
+			freeNodeList($3); 
 			$$ = createBlock($2); 
 		}
 	;
 
 var_decs:
 	var_decs declaration { $$ = $1; $$->push_back($2); } |
-	declaration { $$ = new vector<astNode*>(); $$->push_back($1); }
+	declaration { $$ = createNodeList(); $$->push_back($1); }
 	;
 
 declaration:
-	INT NAME ';' { $$ = createDecl($2); free($2); } 
+	INT NAME ';' { $$ = createDecl($2); } 
 	;
 
 statements:
 	statements statement { $$ = $1; $$->push_back($2); } |
-	statement { $$ = new vector<astNode*>(); $$->push_back($1); }
+	statement { $$ = createNodeList(); $$->push_back($1); }
 	;
 
 statement:
@@ -80,20 +99,20 @@ statement:
 	;
 
 assign_statement:
-	NAME '=' expression ';' { $$ = createAsgn(createVar($1), $3); free($1); } |
-	NAME '=' term ';' { $$ = createAsgn(createVar($1), $3); free($1); } |
-	NAME '=' READ '(' ')' ';' { $$ = createAsgn(createVar($1), createCall($3)); free($1); free($3); }
+	NAME '=' expression ';' { $$ = createAsgn(createVar($1), $3); } |
+	NAME '=' term ';' { $$ = createAsgn(createVar($1), $3); } |
+	NAME '=' READ '(' ')' ';' { $$ = createAsgn(createVar($1), createCall($3)); }
 	;
 
 call_statement:
-	PRINT '(' expression ')' ';' { $$ = createCall($1, $3); free($1); } |
-	PRINT '(' term ')' ';' { $$ = createCall($1, $3); free($1); } 
+	PRINT '(' expression ')' ';' { $$ = createCall($1, $3); } |
+	PRINT '(' term ')' ';' { $$ = createCall($1, $3); } 
 	;
 
 return_statement:
 	RETURN term ';' { $$ = createRet($2); } |
 	RETURN expression ';' { $$ = createRet($2); } |
-	RETURN READ '(' ')' ';' { $$ = createRet(createCall($2)); free($2); }
+	RETURN READ '(' ')' ';' { $$ = createRet(createCall($2)); }
 	;
 
 expression:
@@ -125,6 +144,63 @@ while_loop:
 
 %%
 
-void yyerror(const char *){
-	fprintf(stdout, "Syntax error %d\n", yylineno);
+/* parses a whole program from the file with its own scanner, touching no globals
+ * the AST is allocated from the arena, which the caller frees once done with the tree
+ * returns the root of the AST, or NULL if the program has a syntax error
+ */
+astNode* parseFile(FILE* file, astArena* arena) {
+	assert(arena != NULL);
+
+	parseContext context;
+	context.root = NULL;
+	context.arena = arena;
+	if(yylex_init(&context.scanner) != 0) {
+		return NULL;
+	}
+	yyset_in(file, context.scanner);
+
+	return runParser(&context);
+}
+
+/* parses a whole program straight out of memory, without any stdio reads
+ * the buffer holds size bytes of source followed by two NUL bytes, and is written to
+ * while scanning (flex terminates each token in place) but restored afterwards
+ * the AST is allocated from the arena, as in parseFile
+ * returns the root of the AST, or NULL if the program has a syntax error
+ */
+astNode* parseBuffer(char* buffer, size_t size, astArena* arena) {
+	assert(buffer != NULL && buffer[size] == '\0' && buffer[size + 1] == '\0');
+	assert(arena != NULL);
+
+	parseContext context;
+	context.root = NULL;
+	context.arena = arena;
+	if(yylex_init(&context.scanner) != 0) {
+		return NULL;
+	}
+	// the scanner owns the buffer state, and frees it with the scanner
+	if(yy_scan_buffer(buffer, size + 2, context.scanner) == NULL) {
+		yylex_destroy(context.scanner);
+		return NULL;
+	}
+
+	return runParser(&context);
+}
+
+/* runs the parser with the create* functions allocating from the context's arena,
+ * then destroys the scanner - on a syntax error the partial tree is left in the arena
+ * the names of the program are interned from scratch, so its IDs start after the reserved ones
+ */
+astNode* runParser(parseContext* context) {
+	clearInterner();
+	astArena* previous = useArena(context->arena);
+	int status = yyparse(context->scanner, context);
+	useArena(previous);
+	yylex_destroy(context->scanner);
+
+	return (status == 0) ? context->root : NULL;
+}
+
+void yyerror(void* scanner, parseContext* context, const char *){
+	fprintf(stdout, "Syntax error %d\n", yyget_lineno(scanner));
 }
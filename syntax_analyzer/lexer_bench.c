@@ -0,0 +1,239 @@
+/*
+ * This is a benchmark program for the scanner which lexes a large miniC source through
+ * stdio (yyset_in) and straight out of the memory-mapped file (yy_scan_buffer),
+ * and with the hand-written DFA lexer, printing the throughput of each in MB/s
+ * after checking that the DFA lexer returns the same tokens as flex
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <time.h>
+#include "parser.h"
+#include "source_buffer.h"
+#include "dfa_lexer.h"
+#include "y.tab.h"
+#include "../helper/elapsed_time.h"
+using namespace std;
+
+/* FUNCTION PROTOTYPES */
+/* ------------------- */
+int yylex(YYSTYPE* yylval, void* scanner);
+int yylex_init(void** scanner);
+void yyset_in(FILE* file, void* scanner);
+int yylex_destroy(void* scanner);
+int yyget_lineno(void* scanner);
+struct yy_buffer_state* yy_scan_buffer(char* base, size_t size, void* scanner);
+
+void writeSource(const char* path, int numStatements);
+long lexFile(const char* path);
+long lexBuffer(const char* path);
+long lexDFA(const char* path);
+long countTokens(void* scanner);
+bool compareLexers(const char* path);
+
+
+/* MAIN */
+/* ---- */
+
+int main(int argc, char** argv){
+
+    // lexes [file] if given, otherwise a generated source of [statements] statements
+    const char* path = "lexer_bench_input.c";
+    bool generated = true;
+    int numStatements = 1000000;
+    if(argc > 1 && atoi(argv[1]) > 0) {
+        numStatements = atoi(argv[1]);
+    } else if(argc > 1) {
+        path = argv[1];
+        generated = false;
+    }
+    int repeats = (argc > 2) ? atoi(argv[2]) : 5;
+    assert(repeats > 0);
+
+    if(generated) {
+        writeSource(path, numStatements);
+    }
+
+    sourceBuffer source;
+    if(!loadSource(path, &source)) {
+        printf("Could not read %s\n", path);
+        return 1;
+    }
+    double megabytes = source.size / (1024.0 * 1024.0);
+    releaseSource(&source);
+    printf("source: %s (%.2f MB)\n", path, megabytes);
+    if(!compareLexers(path)) {
+        return 1;
+    }
+
+    // the best of the repeats, so every path is timed with the file in the page cache
+    const char* names[] = { "stdio (yyset_in)", "mmap (yy_scan_buffer)", "mmap (dfaLex)" };
+    long (*lexers[])(const char*) = { lexFile, lexBuffer, lexDFA };
+    for(int i = 0; i < 3; i++) {
+        double best = -1;
+        long tokens = 0;
+        for(int r = 0; r < repeats; r++) {
+            struct timespec start, end;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            tokens = lexers[i](path);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+
+            double ms = elapsedMs(start, end);
+            if(best < 0 || ms < best) {
+                best = ms;
+            }
+        }
+        printf("%-22s %10.2f ms %10.1f MB/s (%ld tokens)\n", names[i], best, megabytes / (best / 1000.0), tokens);
+    }
+
+    if(generated) {
+        remove(path);
+    }
+    return 0;
+}
+
+/* writes a valid miniC program whose function body has the given number of statements */
+void writeSource(const char* path, int numStatements) {
+    FILE* out = fopen(path, "w");
+    assert(out != NULL);
+
+    fprintf(out, "extern void print(int);\nextern int read();\n\nint func(int p){\n");
+    int numVars = 16;
+    for(int v = 0; v < numVars; v++) {
+        fprintf(out, "\tint var_%d;\n", v);
+    }
+
+    const char* ops[] = { "+", "-", "*", "/" };
+    for(int i = 0; i < numStatements; i++) {
+        int a = i % numVars;
+        int b = (i * 7 + 3) % numVars;
+        switch(i % 4) {
+            case 0:
+                fprintf(out, "\tvar_%d = var_%d %s %d;\n", a, b, ops[i % 4], i);
+                break;
+            case 1:
+                fprintf(out, "\tif (var_%d <= var_%d) var_%d = read(); else print(var_%d);\n", a, b, a, b);
+                break;
+            case 2:
+                fprintf(out, "\twhile (var_%d != p) var_%d = var_%d %s p;\n", a, a, b, ops[i % 4]);
+                break;
+            default:
+                fprintf(out, "\tvar_%d = -var_%d;\n", a, b);
+                break;
+        }
+    }
+
+    fprintf(out, "\treturn var_0;\n}\n");
+    fclose(out);
+}
+
+/* lexes the file through stdio and returns the number of tokens */
+long lexFile(const char* path) {
+    FILE* file = fopen(path, "r");
+    assert(file != NULL);
+
+    void* scanner;
+    yylex_init(&scanner);
+    yyset_in(file, scanner);
+    long tokens = countTokens(scanner);
+    yylex_destroy(scanner);
+
+    fclose(file);
+    return tokens;
+}
+
+/* maps the file, lexes it in place and returns the number of tokens */
+long lexBuffer(const char* path) {
+    sourceBuffer source;
+    bool loaded = loadSource(path, &source);
+    assert(loaded);
+
+    void* scanner;
+    yylex_init(&scanner);
+    yy_scan_buffer(source.data, source.size + 2, scanner);
+    long tokens = countTokens(scanner);
+    yylex_destroy(scanner);
+
+    releaseSource(&source);
+    return tokens;
+}
+
+/* maps the file and lexes it with the DFA lexer, returning the number of tokens */
+long lexDFA(const char* path) {
+    sourceBuffer source;
+    bool loaded = loadSource(path, &source);
+    assert(loaded);
+
+    dfaScanner scanner;
+    dfaScanBuffer(&scanner, source.data, source.size);
+    clearInterner();
+    YYSTYPE value;
+    long tokens = 0;
+    while(dfaLex(&scanner, &value) != 0) {
+        tokens++;
+    }
+    dfaRelease(&scanner);
+
+    releaseSource(&source);
+    return tokens;
+}
+
+/* lexes the file with flex and the DFA lexer side by side, checking that every token,
+ * its value and its line match, and prints where they first differ if they do not
+ * each lexer has a mapping of its own, as flex writes to the buffer it scans
+ */
+bool compareLexers(const char* path) {
+    sourceBuffer flexSource;
+    sourceBuffer dfaSource;
+    bool loaded = loadSource(path, &flexSource) && loadSource(path, &dfaSource);
+    assert(loaded);
+
+    void* flex;
+    yylex_init(&flex);
+    yy_scan_buffer(flexSource.data, flexSource.size + 2, flex);
+    dfaScanner dfa;
+    dfaScanBuffer(&dfa, dfaSource.data, dfaSource.size);
+
+    clearInterner();
+    bool same = true;
+    long tokens = 0;
+    while(same) {
+        YYSTYPE flexValue;
+        YYSTYPE dfaValue;
+        int flexToken = yylex(&flexValue, flex);
+        int dfaToken = dfaLex(&dfa, &dfaValue);
+        bool hasValue = (flexToken == NUM || flexToken == NAME || flexToken == READ || flexToken == PRINT);
+        same = (flexToken == dfaToken) && (!hasValue || flexValue.ival == dfaValue.ival)
+            && (yyget_lineno(flex) == dfa.lineno);
+        if(!same) {
+            printf("FAIL: token %ld differs: flex returned %d on line %d, the DFA lexer %d on line %d\n",
+                tokens, flexToken, yyget_lineno(flex), dfaToken, dfa.lineno);
+        }
+        if(flexToken == 0) {
+            break;
+        }
+        tokens++;
+    }
+
+    yylex_destroy(flex);
+    dfaRelease(&dfa);
+    releaseSource(&flexSource);
+    releaseSource(&dfaSource);
+    if(same) {
+        printf("PASS: the DFA lexer returned the same %ld tokens as flex\n", tokens);
+    }
+    return same;
+}
+
+/* runs the scanner to the end of its input, interning the names from scratch as a parse would */
+long countTokens(void* scanner) {
+    clearInterner();
+    YYSTYPE value;
+    long tokens = 0;
+    while(yylex(&value, scanner) != 0) {
+        tokens++;
+    }
+    return tokens;
+}
@@ -0,0 +1,26 @@
+#ifndef PARSER_H
+#define PARSER_H
+
+#include <stdio.h>
+#include "../lib/ast/ast.h"
+
+/* state of a single parse, handed to the bison parser and the flex scanner
+ * in place of globals so that files can be parsed on several threads at once
+ */
+typedef struct {
+		void* scanner; // the reentrant flex scanner (a yyscan_t)
+		astNode* root; // set by the minic rule once the whole program is parsed
+		astArena* arena; // the AST is allocated from it
+	} parseContext;
+
+/* FUNCTIONS */
+/* --------- */
+
+astNode* parseFile(FILE* file, astArena* arena);
+astNode* parseBuffer(char* buffer, size_t size, astArena* arena);
+
+// the hand-written parser (rd_parser.c), which builds the same AST and reports the same syntax errors
+astNode* parseFile_rd(FILE* file, astArena* arena);
+astNode* parseBuffer_rd(char* buffer, size_t size, astArena* arena);
+
+#endif
@@ -0,0 +1,209 @@
+/*
+ * This is a test and benchmark program for the hand-written parser which checks that it builds the
+ * same AST as the bison parser and prints the same syntax errors, on the given sources and on every
+ * copy of them with one character deleted or cut off after it, then times both parsers
+ * on a large generated source, printing their throughput in MB/s
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include "parser.h"
+#include "source_buffer.h"
+#include "../lib/ast/flat_ast.h"
+#include "../helper/elapsed_time.h"
+using namespace std;
+
+/* FUNCTION PROTOTYPES */
+/* ------------------- */
+
+typedef astNode* (*parserFunction)(char* buffer, size_t size, astArena* arena);
+
+bool compareParsers(const char* path);
+bool compareParses(string source);
+astNode* parseCapturing(parserFunction parse, string source, astArena* arena, string* output);
+bool sameTree(astNode* root, astNode* other);
+string generateSource(int numStatements);
+
+
+/* MAIN */
+/* ---- */
+
+int main(int argc, char** argv){
+
+    // parser_bench [statements] [repeats] [files to compare the parsers on]
+    int numStatements = (argc > 1) ? atoi(argv[1]) : 200000;
+    int repeats = (argc > 2) ? atoi(argv[2]) : 5;
+    assert(numStatements > 0 && repeats > 0);
+
+    int failures = 0;
+    for(int i = 3; i < argc; i++) {
+        failures += !compareParsers(argv[i]);
+    }
+
+    string source = generateSource(numStatements);
+    if(!compareParses(source)) {
+        printf("FAIL: the parsers differ on the generated source\n");
+        failures++;
+    }
+    double megabytes = source.size() / (1024.0 * 1024.0);
+    printf("source: %d statements (%.2f MB)\n", numStatements, megabytes);
+    source.append(2, '\0'); // both parsers scan it in place
+
+    // the best of the repeats, each parse into an arena of its own
+    const char* names[] = { "bison (parseBuffer)", "hand-written (parseBuffer_rd)" };
+    parserFunction parsers[] = { parseBuffer, parseBuffer_rd };
+    for(int i = 0; i < 2; i++) {
+        double best = -1;
+        double kilobytes = 0;
+        for(int r = 0; r < repeats; r++) {
+            astArena* arena = createArena();
+            struct timespec times[2];
+            clock_gettime(CLOCK_MONOTONIC, &times[0]);
+            astNode* root = parsers[i](&source[0], source.size() - 2, arena);
+            clock_gettime(CLOCK_MONOTONIC, &times[1]);
+            assert(root != NULL);
+            kilobytes = arena->bytes / 1024.0;
+            freeArena(arena);
+
+            double ms = elapsedMs(times[0], times[1]);
+            if(best < 0 || ms < best) {
+                best = ms;
+            }
+        }
+        printf("%-30s %10.2f ms %10.1f MB/s (%.0f KB of AST)\n", names[i], best, megabytes / (best / 1000.0), kilobytes);
+    }
+
+    printf("%d failed\n", failures);
+    return (failures == 0) ? 0 : 1;
+}
+
+/* compares the parsers on the file, and on every copy of it with one character deleted
+ * or with everything after one character cut off, which covers most syntax errors
+ */
+bool compareParsers(const char* path) {
+    sourceBuffer buffer;
+    if(!loadSource(path, &buffer)) {
+        printf("FAIL: could not read %s\n", path);
+        return false;
+    }
+    string source(buffer.data, buffer.size);
+    releaseSource(&buffer);
+
+    int differences = !compareParses(source);
+    for(size_t i = 0; i < source.size(); i++) {
+        string deleted = source;
+        deleted.erase(i, 1);
+        differences += !compareParses(deleted);
+        differences += !compareParses(source.substr(0, i));
+    }
+
+    if(differences > 0) {
+        printf("FAIL: the parsers differ on %d of %d variants of %s\n", differences, 1 + 2 * (int) source.size(), path);
+        return false;
+    }
+    printf("PASS: the parsers agree on %d variants of %s\n", 1 + 2 * (int) source.size(), path);
+    return true;
+}
+
+/* parses the source with both parsers, checking that they print the same output
+ * (the syntax error and the characters the scanner echoes) and build the same tree, or both fail
+ */
+bool compareParses(string source) {
+    string output;
+    string outputRD;
+    astArena* arena = createArena();
+    astArena* arenaRD = createArena();
+    astNode* root = parseCapturing(parseBuffer, source, arena, &output);
+    astNode* rootRD = parseCapturing(parseBuffer_rd, source, arenaRD, &outputRD);
+
+    bool same = (output == outputRD) && ((root == NULL) == (rootRD == NULL));
+    if(same && root != NULL) {
+        same = sameTree(root, rootRD);
+    }
+    freeArena(arena);
+    freeArena(arenaRD);
+    return same;
+}
+
+/* parses a copy of the source, with stdout redirected into the output string */
+astNode* parseCapturing(parserFunction parse, string source, astArena* arena, string* output) {
+    source.append(2, '\0');
+    char* text;
+    size_t length;
+    FILE* captured = open_memstream(&text, &length);
+    assert(captured != NULL);
+
+    fflush(stdout);
+    FILE* saved = stdout;
+    stdout = captured;
+    astNode* root = parse(&source[0], source.size() - 2, arena);
+    stdout = saved;
+
+    fclose(captured);
+    output->assign(text, length);
+    free(text);
+    return root;
+}
+
+/* checks if the two trees are the same by comparing their flat ASTs array by array */
+bool sameTree(astNode* root, astNode* other) {
+    flatAST* flat = flattenAST(root);
+    flatAST* flatOther = flattenAST(other);
+
+    bool same = flat->size == flatOther->size && flat->numChildren == flatOther->numChildren && flat->root == flatOther->root;
+    if(same) {
+        size_t nodeBytes = flat->size * sizeof(int32_t);
+        same = memcmp(flat->first, flatOther->first, nodeBytes) == 0
+            && memcmp(flat->second, flatOther->second, nodeBytes) == 0
+            && memcmp(flat->third, flatOther->third, nodeBytes) == 0
+            && memcmp(flat->children, flatOther->children, flat->numChildren * sizeof(int32_t)) == 0
+            && memcmp(flat->kinds, flatOther->kinds, flat->size) == 0
+            && memcmp(flat->ops, flatOther->ops, flat->size) == 0;
+    }
+
+    freeFlatAST(flat);
+    freeFlatAST(flatOther);
+    return same;
+}
+
+/* returns a valid miniC program whose function body has the given number of statements,
+ * among them ifs, whiles and nested blocks that declare variables of their own
+ */
+string generateSource(int numStatements) {
+    string source = "extern void print(int);\nextern int read();\n\nint func(int p){\n";
+    int numVars = 16;
+    char line[256];
+    for(int v = 0; v < numVars; v++) {
+        snprintf(line, sizeof(line), "\tint var_%d;\n", v);
+        source += line;
+    }
+
+    // each kind of statement cycles through the operators on its own, as i % 4 picks the kind
+    const char* ops[] = { "+", "-", "*", "/" };
+    for(int i = 0; i < numStatements; i++) {
+        int a = i % numVars;
+        int b = (i * 7 + 3) % numVars;
+        switch(i % 4) {
+            case 0:
+                snprintf(line, sizeof(line), "\tvar_%d = var_%d %s %d;\n", a, b, ops[(i / 4) % 4], i);
+                break;
+            case 1:
+                snprintf(line, sizeof(line), "\tif (var_%d <= var_%d) var_%d = read(); else print(var_%d);\n", a, b, a, b);
+                break;
+            case 2:
+                snprintf(line, sizeof(line), "\twhile (var_%d != p) { int t; t = var_%d %s p; var_%d = -t; }\n", a, b, ops[(i / 4) % 4], a);
+                break;
+            default:
+                snprintf(line, sizeof(line), "\t{ int s; s = read(); if (s > var_%d) { print(s); } var_%d = s; }\n", b, a);
+                break;
+        }
+        source += line;
+    }
+
+    source += "\treturn var_0;\n}\n";
+    return source;
+}
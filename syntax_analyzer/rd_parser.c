@@ -0,0 +1,488 @@
+/*
+ * Library that parses miniC by hand instead of with the bison grammar (grammar.y), driving the
+ * same reentrant scanner and building the same AST: one token of lookahead picks each rule,
+ * as the grammar is LL(1) once the expressions are left-factored, and every syntax error is
+ * reported on the same token and line as the bison parser reports it
+ *
+ * The statements of each block are gathered on a stack shared by every block being parsed and
+ * copied into a list of exactly their number once the block closes, instead of growing a list
+ * for the declarations and another for the statements and appending one to the other.
+ * Nested statements are parsed with an explicit stack of the blocks, ifs and whiles still open
+ * rather than by recursion, so deeply nested programs cannot overflow the call stack
+*/
+#include <stdio.h>
+#include <vector>
+#include "../lib/ast/ast.h"
+#include "parser.h"
+#include "y.tab.h"
+//#define NDEBUG
+#include <cassert>
+
+using namespace std;
+
+/* TYPES */
+/* ----- */
+
+// kinds of statement that are still open while the statements inside them are parsed
+typedef enum {
+		open_block, // gathering its statements on the pending stack
+		open_if, // waiting for its body
+		open_else, // has its body, waiting for the else body
+		open_while // waiting for its body
+	} open_kind;
+
+typedef struct {
+		open_kind kind;
+		size_t mark; // open_block: size of the pending stack when the block opened
+		astNode* cond; // open_if, open_else, open_while
+		astNode* body; // open_else: the if body
+	} openStatement;
+
+/* state of one hand-written parse, with the token it is looking at */
+typedef struct {
+		void* scanner;
+		int token; // the lookahead token, 0 at the end of the source
+		YYSTYPE value; // its value, for NUM, NAME, PRINT and READ
+	} rdContext;
+
+/* FUNCTION PROTOTYPES */
+/* ------------------- */
+
+int yylex(YYSTYPE* yylval, void* scanner);
+int yylex_init(void** scanner);
+void yyset_in(FILE* file, void* scanner);
+int yyget_lineno(void* scanner);
+int yylex_destroy(void* scanner);
+struct yy_buffer_state* yy_scan_buffer(char* base, size_t size, void* scanner);
+
+astNode* runParser_rd(void* scanner, astArena* arena);
+astNode* parseProgram(rdContext* parser);
+astNode* parseExtern(rdContext* parser);
+astNode* parseFunction(rdContext* parser);
+astNode* parseStatement(rdContext* parser);
+astNode* parseSimpleStatement(rdContext* parser);
+astNode* parseValue(rdContext* parser);
+astNode* parseTerm(rdContext* parser);
+astNode* parseCondition(rdContext* parser);
+void advance(rdContext* parser);
+bool expect(rdContext* parser, int token);
+astNode* syntaxError(rdContext* parser);
+
+/* GLOBAL VARS */
+/* ----------- */
+
+// reused by every parse on the thread, so a parse allocates no stacks once they have grown
+thread_local vector<openStatement> openStatements; // the innermost last
+thread_local vector<astNode*> pendingStatements; // statements of the open blocks, the innermost block's last
+
+/* FUNCTIONS */
+/* --------- */
+
+/* parses a whole program from the file, as parseFile does, but with the hand-written parser
+ * returns the root of the AST, or NULL if the program has a syntax error
+ */
+astNode* parseFile_rd(FILE* file, astArena* arena) {
+    assert(arena != NULL);
+
+    void* scanner;
+    if(yylex_init(&scanner) != 0) {
+        return NULL;
+    }
+    yyset_in(file, scanner);
+
+    return runParser_rd(scanner, arena);
+}
+
+/* parses a whole program straight out of memory, as parseBuffer does, but with the hand-written parser
+ * the buffer holds size bytes of source followed by two NUL bytes
+ * returns the root of the AST, or NULL if the program has a syntax error
+ */
+astNode* parseBuffer_rd(char* buffer, size_t size, astArena* arena) {
+    assert(buffer != NULL && buffer[size] == '\0' && buffer[size + 1] == '\0');
+    assert(arena != NULL);
+
+    void* scanner;
+    if(yylex_init(&scanner) != 0) {
+        return NULL;
+    }
+    if(yy_scan_buffer(buffer, size + 2, scanner) == NULL) {
+        yylex_destroy(scanner);
+        return NULL;
+    }
+
+    return runParser_rd(scanner, arena);
+}
+
+/* parses the program with the create* functions allocating from the arena, then destroys the scanner
+ * on a syntax error the partial tree is left in the arena, as with the bison parser
+ */
+astNode* runParser_rd(void* scanner, astArena* arena) {
+    clearInterner();
+    astArena* previous = useArena(arena);
+    openStatements.clear();
+    pendingStatements.clear();
+
+    rdContext parser;
+    parser.scanner = scanner;
+    advance(&parser);
+    astNode* root = parseProgram(&parser);
+
+    useArena(previous);
+    yylex_destroy(scanner);
+    return root;
+}
+
+/* minic: extern extern func_def, followed by the end of the source */
+astNode* parseProgram(rdContext* parser) {
+    astNode* extern1 = parseExtern(parser);
+    if(extern1 == NULL) {
+        return NULL;
+    }
+    astNode* extern2 = parseExtern(parser);
+    if(extern2 == NULL) {
+        return NULL;
+    }
+    astNode* func = parseFunction(parser);
+    if(func == NULL) {
+        return NULL;
+    }
+    if(parser->token != 0) {
+        return syntaxError(parser);
+    }
+    return createProg(extern1, extern2, func);
+}
+
+/* extern: EXTERN VOID PRINT '(' INT ')' ';' | EXTERN INT READ '(' ')' ';' */
+astNode* parseExtern(rdContext* parser) {
+    if(!expect(parser, EXTERN)) {
+        return NULL;
+    }
+
+    int id;
+    if(parser->token == VOID) {
+        advance(parser);
+        id = parser->value.ival;
+        if(!expect(parser, PRINT) || !expect(parser, '(') || !expect(parser, INT)) {
+            return NULL;
+        }
+    } else if(parser->token == INT) {
+        advance(parser);
+        id = parser->value.ival;
+        if(!expect(parser, READ) || !expect(parser, '(')) {
+            return NULL;
+        }
+    } else {
+        return syntaxError(parser);
+    }
+
+    if(!expect(parser, ')') || !expect(parser, ';')) {
+        return NULL;
+    }
+    return createExtern(id);
+}
+
+/* func_def: INT NAME '(' [INT NAME] ')' block_statement */
+astNode* parseFunction(rdContext* parser) {
+    if(!expect(parser, INT)) {
+        return NULL;
+    }
+    int name = parser->value.ival;
+    if(!expect(parser, NAME) || !expect(parser, '(')) {
+        return NULL;
+    }
+
+    astNode* param = NULL;
+    if(parser->token == INT) {
+        advance(parser);
+        int paramName = parser->value.ival;
+        if(!expect(parser, NAME)) {
+            return NULL;
+        }
+        param = createVar(paramName);
+    }
+    if(!expect(parser, ')')) {
+        return NULL;
+    }
+
+    if(parser->token != '{') {
+        return syntaxError(parser);
+    }
+    astNode* body = parseStatement(parser);
+    if(body == NULL) {
+        return NULL;
+    }
+    return createFunc(name, param, body);
+}
+
+/* parses a statement and every statement nested in it, returning NULL on a syntax error
+ * opening a block, if or while pushes it on the open statements and goes on with the first
+ * statement inside it; each finished statement is handed to the innermost open one,
+ * which may finish it in turn, until a block needs its next statement or none is left open
+ */
+astNode* parseStatement(rdContext* parser) {
+    size_t base = openStatements.size();
+
+    while(true) {
+        // open every block, if and while the statement starts with, down to a simple statement
+        astNode* node = NULL;
+        while(node == NULL) {
+            switch(parser->token) {
+                case('{'): {
+                    advance(parser);
+                    openStatements.push_back({ open_block, pendingStatements.size(), NULL, NULL });
+                    while(parser->token == INT) {
+                        advance(parser);
+                        int id = parser->value.ival;
+                        if(!expect(parser, NAME) || !expect(parser, ';')) {
+                            return NULL;
+                        }
+                        pendingStatements.push_back(createDecl(id));
+                    }
+                    // a block holds at least one statement after its declarations
+                    if(parser->token == '}') {
+                        return syntaxError(parser);
+                    }
+                    break;
+                }
+
+                case(IF):
+                case(WHILE): {
+                    open_kind kind = (parser->token == IF) ? open_if : open_while;
+                    advance(parser);
+                    astNode* cond = parseCondition(parser);
+                    if(cond == NULL) {
+                        return NULL;
+                    }
+                    openStatements.push_back({ kind, 0, cond, NULL });
+                    break;
+                }
+
+                default: {
+                    node = parseSimpleStatement(parser);
+                    if(node == NULL) {
+                        return NULL;
+                    }
+                    break;
+                }
+            }
+        }
+
+        // finish the open statements the new one completes
+        bool needStatement = false;
+        while(!needStatement && openStatements.size() > base) {
+            openStatement* open = &openStatements.back();
+            switch(open->kind) {
+                case(open_block): {
+                    pendingStatements.push_back(node);
+                    if(parser->token != '}') {
+                        needStatement = true;
+                        break;
+                    }
+                    advance(parser);
+
+                    astNodeList* stmts = createNodeList();
+                    stmts->reserve(pendingStatements.size() - open->mark);
+                    stmts->insert(stmts->end(), pendingStatements.begin() + open->mark, pendingStatements.end());
+                    pendingStatements.resize(open->mark);
+                    node = createBlock(stmts);
+                    openStatements.pop_back();
+                    break;
+                }
+
+                case(open_if): {
+                    // an else belongs to the innermost if still waiting for one
+                    if(parser->token == ELSE) {
+                        advance(parser);
+                        open->kind = open_else;
+                        open->body = node;
+                        needStatement = true;
+                        break;
+                    }
+                    node = createIf(open->cond, node);
+                    openStatements.pop_back();
+                    break;
+                }
+
+                case(open_else): {
+                    node = createIf(open->cond, open->body, node);
+                    openStatements.pop_back();
+                    break;
+                }
+
+                case(open_while): {
+                    node = createWhile(open->cond, node);
+                    openStatements.pop_back();
+                    break;
+                }
+            }
+        }
+
+        if(!needStatement) {
+            return node;
+        }
+    }
+}
+
+/* parses a statement that holds no other statement:
+ *   NAME '=' (expression | term | READ '(' ')') ';'
+ *   PRINT '(' (expression | term) ')' ';'
+ *   RETURN (expression | term | READ '(' ')') ';'
+ */
+astNode* parseSimpleStatement(rdContext* parser) {
+    switch(parser->token) {
+        case(NAME): {
+            int id = parser->value.ival;
+            advance(parser);
+            if(!expect(parser, '=')) {
+                return NULL;
+            }
+
+            astNode* rhs;
+            if(parser->token == READ) {
+                int read = parser->value.ival;
+                advance(parser);
+                if(!expect(parser, '(') || !expect(parser, ')')) {
+                    return NULL;
+                }
+                rhs = createCall(read);
+            } else {
+                rhs = parseValue(parser);
+            }
+            if(rhs == NULL || !expect(parser, ';')) {
+                return NULL;
+            }
+            return createAsgn(createVar(id), rhs);
+        }
+
+        case(PRINT): {
+            int id = parser->value.ival;
+            advance(parser);
+            if(!expect(parser, '(')) {
+                return NULL;
+            }
+            astNode* param = parseValue(parser);
+            if(param == NULL || !expect(parser, ')') || !expect(parser, ';')) {
+                return NULL;
+            }
+            return createCall(id, param);
+        }
+
+        case(RETURN): {
+            advance(parser);
+            astNode* expr;
+            if(parser->token == READ) {
+                int read = parser->value.ival;
+                advance(parser);
+                if(!expect(parser, '(') || !expect(parser, ')')) {
+                    return NULL;
+                }
+                expr = createCall(read);
+            } else {
+                expr = parseValue(parser);
+            }
+            if(expr == NULL || !expect(parser, ';')) {
+                return NULL;
+            }
+            return createRet(expr);
+        }
+
+        default: {
+            return syntaxError(parser);
+        }
+    }
+}
+
+/* parses an expression or a lone term:
+ *   '-' term | term | term ('+' | '-' | '/' | '*') term
+ * the operands are always terms, so there is only one level of precedence to parse
+ */
+astNode* parseValue(rdContext* parser) {
+    if(parser->token == '-') {
+        advance(parser);
+        astNode* term = parseTerm(parser);
+        return (term != NULL) ? createUExpr(term, uminus) : NULL;
+    }
+
+    astNode* lhs = parseTerm(parser);
+    if(lhs == NULL) {
+        return NULL;
+    }
+
+    op_type op;
+    switch(parser->token) {
+        case('+'): op = add; break;
+        case('-'): op = sub; break;
+        case('/'): op = divide; break;
+        case('*'): op = mul; break;
+        default: return lhs;
+    }
+    advance(parser);
+    astNode* rhs = parseTerm(parser);
+    return (rhs != NULL) ? createBExpr(lhs, rhs, op) : NULL;
+}
+
+/* term: NAME | NUM */
+astNode* parseTerm(rdContext* parser) {
+    int value = parser->value.ival;
+    if(parser->token == NAME) {
+        advance(parser);
+        return createVar(value);
+    }
+    if(parser->token == NUM) {
+        advance(parser);
+        return createCnst(value);
+    }
+    return syntaxError(parser);
+}
+
+/* condition: '(' term (LT | GT | LE | GE | EQ | NEQ) term ')' */
+astNode* parseCondition(rdContext* parser) {
+    if(!expect(parser, '(')) {
+        return NULL;
+    }
+    astNode* lhs = parseTerm(parser);
+    if(lhs == NULL) {
+        return NULL;
+    }
+
+    rop_type op;
+    switch(parser->token) {
+        case(LT): op = lt; break;
+        case(GT): op = gt; break;
+        case(LE): op = le; break;
+        case(GE): op = ge; break;
+        case(EQ): op = eq; break;
+        case(NEQ): op = neq; break;
+        default: return syntaxError(parser);
+    }
+    advance(parser);
+
+    astNode* rhs = parseTerm(parser);
+    if(rhs == NULL || !expect(parser, ')')) {
+        return NULL;
+    }
+    return createRExpr(lhs, rhs, op);
+}
+
+/* reads the next token into the lookahead */
+void advance(rdContext* parser) {
+    parser->token = yylex(&parser->value, parser->scanner);
+}
+
+/* moves past the lookahead if it is the given token, otherwise reports a syntax error
+ * returns if it was the given token
+ */
+bool expect(rdContext* parser, int token) {
+    if(parser->token != token) {
+        syntaxError(parser);
+        return false;
+    }
+    advance(parser);
+    return true;
+}
+
+/* reports a syntax error on the lookahead as yyerror does, returning NULL for the caller to pass on */
+astNode* syntaxError(rdContext* parser) {
+    fprintf(stdout, "Syntax error %d\n", yyget_lineno(parser->scanner));
+    return NULL;
+}
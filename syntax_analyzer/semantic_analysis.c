@@ -10,28 +10,41 @@
 #include <cassert>
 #include<vector>
 #include<deque>
-#include<unordered_set>
-#include<string>
 #include "semantic_analysis.h"
 using namespace std;
 
+/* a node still to be checked by the optimized traversal, 
+ * or the point where the scope of a function or block is closed
+ */
+typedef struct {
+        astNode* node;
+        bool closesScope;
+    } pendingNode;
+
+/* the same for the flat traversal, by node index */
+typedef struct {
+        int32_t node;
+        bool closesScope;
+    } pendingFlatNode;
+
 /* FUNCTION PROTOTYPES */
 /* ------------------- */
 // non-optimized
 bool handleStatements(astNode* node);
-bool onSymbolTable(char* var);
+bool onSymbolTable(int var);
 
 // optimized
-bool handleStatements_opt(astNode* node);
-bool onSymbolTable_opt(string var);
-bool onFrontSymbolTable_opt(char* var);
-void deleteNonActiveSymbols_opt(vector<char*>* symbols);
+bool checkNode_opt(astNode* node, vector<pendingNode>& pending);
+bool handleStatements_opt(astNode* node, vector<pendingNode>& pending);
+
+// flat
+bool checkFlatNode(flatAST* ast, int32_t node, vector<pendingFlatNode>& pending);
 
 /* GLOBAL VARS */
 /* ----------- */
 
-deque<vector<char*>*> stack; // stores symbol tables
-unordered_set<string> activeSymbols; // for optimization
+thread_local deque<vector<int>*> stack; // stores symbol tables, as interned IDs
+thread_local symbolTable symbols; // for optimization, the innermost declaration of each interned ID
 
 /* METHODS */
 /* ------- */
@@ -68,7 +81,7 @@ bool semanticAnalysis(astNode* node) {
         // check if the variable is on the symbol table, if not print an error
         case(ast_var):
             assert(node->var.name != NULL);
-            if(!onSymbolTable(node->var.name)) {
+            if(!onSymbolTable(node->var.id)) {
                 fprintf(stderr, "Symbol error: var [%s] has not been declared\n\n", node->var.name);
                 result = false;
             }
@@ -103,11 +116,11 @@ bool semanticAnalysis(astNode* node) {
         // handle parameters
         case(ast_func):
             // create new var list and add parameter if it exists
-            vector<char*>* current_symbols = new vector<char*>();
+            vector<int>* current_symbols = new vector<int>();
+            stack.push_front(current_symbols); // always pushed, as it is always popped below
             if(node->func.param != NULL) {
-                stack.push_front(current_symbols);
                 assert(node->func.param->var.name != NULL);
-                current_symbols->push_back(node->func.param->var.name);
+                current_symbols->push_back(node->func.param->var.id);
             }
 
             assert(node->func.body != NULL);
@@ -134,7 +147,7 @@ bool handleStatements(astNode* node) {
         // if a declaration, add var to list in top of stack
         case(ast_decl):
             assert(node->stmt.decl.name != NULL);
-            stack.front()->push_back(node->stmt.decl.name);
+            stack.front()->push_back(node->stmt.decl.id);
             break;
 
         // traverse nodes
@@ -179,11 +192,11 @@ bool handleStatements(astNode* node) {
 
         // if a block statement, create new var list and iterate statements
         case(ast_block):
-            vector<char*>* current_symbols = new vector<char*>();
+            vector<int>* current_symbols = new vector<int>();
             stack.push_front(current_symbols);
 
-            vector<astNode*>* slist = node->stmt.block.stmt_list;
-            vector<astNode*>::iterator it = slist->begin();
+            astNodeList* slist = node->stmt.block.stmt_list;
+            astNodeList::iterator it = slist->begin();
             while(it != slist->end()) { // iterate through all statements and traverse
                 result &= semanticAnalysis(*it);
                 it++;
@@ -202,18 +215,17 @@ bool handleStatements(astNode* node) {
 /* checks if a variable is on the symbol table 
  * that is, it checks if the var is on any of the vectors in our stack 
  */
-bool onSymbolTable(char* var) { 
-    assert(var != NULL);
+bool onSymbolTable(int var) { 
+    assert(var >= 0);
 
     // iterate through all of the tables on the stack
-    deque<vector<char*>*>::iterator st_it = stack.begin();
+    deque<vector<int>*>::iterator st_it = stack.begin();
     while(st_it != stack.end()) {
         // loop through all symbols and check if any are equal to the var
-        vector<char*>* symbols = *st_it;
-        vector<char*>::iterator vec_it = symbols->begin();
+        vector<int>* symbols = *st_it;
+        vector<int>::iterator vec_it = symbols->begin();
         while(vec_it != symbols->end()) {
-            assert(*vec_it != NULL);
-            if(strcmp(*vec_it, var) == 0) { // if equal return true
+            if(*vec_it == var) { // if equal return true
                 return true;
             }
             vec_it++;
@@ -230,29 +242,56 @@ bool onSymbolTable(char* var) {
 
 /* main semantic analysis method - 
  * traverses nodes and handles them according to type 
- * optimized using a set for faster runtime;
+ * optimized using a scoped symbol table keyed by interned ID for faster runtime;
  * additionally throws errors in re-declarations 
+ * the traversal keeps its own stack on the heap, so the nesting depth of the program is not
+ * limited by the native stack
  */
 bool semanticAnalysis_opt(astNode* node) {  
     assert(node != NULL);
 
+    bool result = true;
+    vector<pendingNode> pending;
+    pending.push_back({ node, false });
+
+    // check nodes in the order the recursive traversal would reach them
+    while(!pending.empty()) {
+        pendingNode next = pending.back();
+        pending.pop_back();
+
+        if(next.closesScope) {
+            closeScope(&symbols);
+        } else {
+            result &= checkNode_opt(next.node, pending);
+        }
+    }
+    
+    return result;
+}
+
+/* checks a single node, pushing its children onto the pending stack
+ * in reverse so that they are popped from left to right
+ */
+bool checkNode_opt(astNode* node, vector<pendingNode>& pending) {
+    assert(node != NULL);
+
     bool result = true;
     // react based on node types
     switch(node->type) {
 
         // traverse nodes
         case(ast_prog):
-            assert(node->prog.ext1 != NULL);
-            result &= semanticAnalysis_opt(node->prog.ext1); // unnecessary
-            assert(node->prog.ext2 != NULL);
-            result &= semanticAnalysis_opt(node->prog.ext2); // unnecessary
             assert(node->prog.func != NULL);
-            result &= semanticAnalysis_opt(node->prog.func);
+            pending.push_back({ node->prog.func, false });
+            assert(node->prog.ext2 != NULL);
+            pending.push_back({ node->prog.ext2, false }); // unnecessary
+            assert(node->prog.ext1 != NULL);
+            pending.push_back({ node->prog.ext1, false }); // unnecessary
             break;
 
         // handle block and declaration statements
         case(ast_stmt):
-            result &= handleStatements_opt(node);
+            result &= handleStatements_opt(node, pending);
             break;
 
         // do nothing
@@ -261,11 +300,7 @@ bool semanticAnalysis_opt(astNode* node) {
 
         // check if the variable is on the symbol table, if not print an error
         case(ast_var):
-            assert(node->var.name != NULL);
-            if(!onSymbolTable_opt(node->var.name)) {
-                fprintf(stderr, "Symbol error: var [%s] has not been declared\n\n", node->var.name);
-                result = false;
-            }
+            result &= checkVariable(node);
             break;
 
         // do nothing
@@ -274,44 +309,40 @@ bool semanticAnalysis_opt(astNode* node) {
 
         // traverse nodes
         case(ast_rexpr):
-            assert(node->rexpr.lhs != NULL);
-            result &= semanticAnalysis_opt(node->rexpr.lhs);
             assert(node->rexpr.rhs != NULL);
-            result &= semanticAnalysis_opt(node->rexpr.rhs);
+            pending.push_back({ node->rexpr.rhs, false });
+            assert(node->rexpr.lhs != NULL);
+            pending.push_back({ node->rexpr.lhs, false });
             break;
 
         // traverse nodes
         case(ast_bexpr):
-            assert(node->bexpr.lhs != NULL);
-            result &= semanticAnalysis_opt(node->bexpr.lhs);
             assert(node->bexpr.rhs != NULL);
-            result &= semanticAnalysis_opt(node->bexpr.rhs);
+            pending.push_back({ node->bexpr.rhs, false });
+            assert(node->bexpr.lhs != NULL);
+            pending.push_back({ node->bexpr.lhs, false });
             break;
 
         // traverse nodes
         case(ast_uexpr):
             assert(node->uexpr.expr != NULL);
-            result &= semanticAnalysis_opt(node->uexpr.expr);
+            pending.push_back({ node->uexpr.expr, false });
             break;
 
         // handle parameters
         case(ast_func):
             // create new var list and add parameter if it exists
-            vector<char*>* current_symbols = new vector<char*>();
+            openScope(&symbols); // always opened, as it is always closed after the body
+            startFunction(&symbols);
             if(node->func.param != NULL) {
-                stack.push_front(current_symbols);
                 assert(node->func.param->var.name != NULL);
-                current_symbols->push_back(node->func.param->var.name);
-                activeSymbols.insert(string(node->func.param->var.name));
+                node->func.param->var.slot = declareSymbol(&symbols, node->func.param->var.id);
             }
 
+            // traverse into body of function, then close its scope
+            pending.push_back({ NULL, true });
             assert(node->func.body != NULL);
-            result &= semanticAnalysis_opt(node->func.body); // traverse into body of function
-
-            // free the front symbol vector
-            stack.pop_front();
-            deleteNonActiveSymbols_opt(current_symbols);
-            delete(current_symbols);
+            pending.push_back({ node->func.body, false });
             break;
 
     }
@@ -320,9 +351,9 @@ bool semanticAnalysis_opt(astNode* node) {
 }
 
 /* handles all of the possible statement types 
- * optimized using a set for faster runtime 
+ * optimized using a scoped symbol table for faster runtime 
  */
-bool handleStatements_opt(astNode* node) {
+bool handleStatements_opt(astNode* node, vector<pendingNode>& pending) {
     assert(node != NULL);
    
     bool result = true;
@@ -332,73 +363,61 @@ bool handleStatements_opt(astNode* node) {
         // if a declaration, add var to list in top of stack
         case(ast_decl):
             // error if already exists - duplicate declaration
-            assert(node->stmt.decl.name != NULL);
-            if(onFrontSymbolTable_opt(node->stmt.decl.name)) {
-                fprintf(stderr, "Symbol error: var [%s] has already been declared\n\n", node->stmt.decl.name);
-                result = false;
-                break;
-            }
-            stack.front()->push_back(node->stmt.decl.name);
-            activeSymbols.insert(string(node->stmt.decl.name));
+            result &= checkDeclaration(node);
             break;
 
         // traverse nodes
         case(ast_call):
             if(node->stmt.call.param != NULL) {
-                result &= semanticAnalysis_opt(node->stmt.call.param);
+                pending.push_back({ node->stmt.call.param, false });
             }
             break;
 
         // traverse nodes
         case(ast_ret):
             assert(node->stmt.ret.expr != NULL);
-            result &= semanticAnalysis_opt(node->stmt.ret.expr);
+            pending.push_back({ node->stmt.ret.expr, false });
             break;
 
         // traverse nodes
         case(ast_while):
-            assert(node->stmt.whilen.cond != NULL);
-            result &= semanticAnalysis_opt(node->stmt.whilen.cond);
             assert(node->stmt.whilen.body != NULL);
-            result &= semanticAnalysis_opt(node->stmt.whilen.body);
+            pending.push_back({ node->stmt.whilen.body, false });
+            assert(node->stmt.whilen.cond != NULL);
+            pending.push_back({ node->stmt.whilen.cond, false });
             break;
 
         // traverse nodes
         case(ast_if):
-            assert(node->stmt.ifn.cond != NULL);
-            result &= semanticAnalysis_opt(node->stmt.ifn.cond);
-            assert(node->stmt.ifn.if_body != NULL);
-            result &= semanticAnalysis_opt(node->stmt.ifn.if_body);
             if(node->stmt.ifn.else_body != NULL) {
-                result &= semanticAnalysis_opt(node->stmt.ifn.else_body);
+                pending.push_back({ node->stmt.ifn.else_body, false });
             }
+            assert(node->stmt.ifn.if_body != NULL);
+            pending.push_back({ node->stmt.ifn.if_body, false });
+            assert(node->stmt.ifn.cond != NULL);
+            pending.push_back({ node->stmt.ifn.cond, false });
             break;
 
         // traverse nodes
         case(ast_asgn):
-            assert(node->stmt.asgn.lhs != NULL);
-            result &= semanticAnalysis_opt(node->stmt.asgn.lhs);
             assert(node->stmt.asgn.rhs != NULL);
-            result &= semanticAnalysis_opt(node->stmt.asgn.rhs);
+            pending.push_back({ node->stmt.asgn.rhs, false });
+            assert(node->stmt.asgn.lhs != NULL);
+            pending.push_back({ node->stmt.asgn.lhs, false });
             break;
 
         // if a block statement, create new var list and iterate statements
         case(ast_block):
-            vector<char*>* current_symbols = new vector<char*>();
-            stack.push_front(current_symbols);
+            openScope(&symbols);
+            pending.push_back({ NULL, true }); // closed once all statements are checked
 
-            vector<astNode*>* slist = node->stmt.block.stmt_list;
-            vector<astNode*>::iterator it = slist->begin();
-            while(it != slist->end()) { // iterate through all statements and traverse
+            astNodeList* slist = node->stmt.block.stmt_list;
+            astNodeList::reverse_iterator it = slist->rbegin();
+            while(it != slist->rend()) { // push all statements to traverse, last first
                 assert(*it != NULL);
-                result &= semanticAnalysis_opt(*it);
+                pending.push_back({ *it, false });
                 it++;
             }
-
-            // free the front symbol vector
-            stack.pop_front();
-            deleteNonActiveSymbols_opt(current_symbols);
-            delete(current_symbols);
             break;
 
     }
@@ -406,39 +425,208 @@ bool handleStatements_opt(astNode* node) {
     return result;
 }
 
-/* checks if a variable is on the symbol table 
- * that is, it checks if the var is on any of the vectors in our stack 
- * optimized using a set 
+/* returns the symbol table of the optimized traversal */
+symbolTable* semanticSymbols() {
+    return &symbols;
+}
+
+/* resolves a variable to the slot of its innermost declaration in scope
+ * prints an error and returns false if it has not been declared
+ */
+bool checkVariable(astNode* node) {
+    assert(node != NULL && node->type == ast_var);
+    assert(node->var.name != NULL);
+
+    node->var.slot = resolveSymbol(&symbols, node->var.id);
+    if(node->var.slot < 0) {
+        fprintf(stderr, "Symbol error: var [%s] has not been declared\n\n", node->var.name);
+        return false;
+    }
+    return true;
+}
+
+/* declares a variable in the innermost scope, giving it a slot
+ * prints an error and returns false if the scope already declares it
  */
-bool onSymbolTable_opt(string var) { 
-    return (activeSymbols.find(var) != activeSymbols.end());
+bool checkDeclaration(astNode* node) {
+    assert(node != NULL && node->type == ast_stmt && node->stmt.type == ast_decl);
+    assert(node->stmt.decl.name != NULL);
+
+    if(declaredInScope(&symbols, node->stmt.decl.id)) {
+        fprintf(stderr, "Symbol error: var [%s] has already been declared\n\n", node->stmt.decl.name);
+        return false;
+    }
+    node->stmt.decl.slot = declareSymbol(&symbols, node->stmt.decl.id);
+    return true;
+}
+
+/* checks every variable of an expression or condition, left to right
+ * expressions are at most an operator over two terms, so this recursion stays shallow
+ */
+bool checkExpression(astNode* node) {
+    assert(node != NULL);
+
+    bool result = true;
+    switch(node->type) {
+        case(ast_var):
+            result &= checkVariable(node);
+            break;
+
+        case(ast_rexpr):
+            result &= checkExpression(node->rexpr.lhs);
+            result &= checkExpression(node->rexpr.rhs);
+            break;
+
+        case(ast_bexpr):
+            result &= checkExpression(node->bexpr.lhs);
+            result &= checkExpression(node->bexpr.rhs);
+            break;
+
+        case(ast_uexpr):
+            result &= checkExpression(node->uexpr.expr);
+            break;
+
+        // an extern call
+        case(ast_stmt):
+            if(node->stmt.type == ast_call && node->stmt.call.param != NULL) {
+                result &= checkExpression(node->stmt.call.param);
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return result;
 }
 
-/* checks if a variable is on the top symbol table vector */
-bool onFrontSymbolTable_opt(char* var) { 
-    assert(var != NULL);
-
-    // loop through all symbols on top vector and check if any are equal to the var
-    vector<char*>* symbols = stack.front();
-    vector<char*>::iterator it = symbols->begin();
-    while(it != symbols->end()) {
-        assert(*it != NULL);
-        if(strcmp(*it, var) == 0) { // if equal return true
-            return true;
+/* FLAT AST SOLUTION */
+/* ----------------- */
+
+/* semantic analysis of a flat AST - 
+ * the same checks and errors as semanticAnalysis_opt, sharing its symbol table, 
+ * but walking the node arrays instead of following pointers, with its own stack on the heap
+ * the slot each variable resolves to is written to its second operand 
+ */
+bool semanticAnalysis_flat(flatAST* ast) {
+    assert(ast != NULL);
+
+    bool result = true;
+    vector<pendingFlatNode> pending;
+    pending.push_back({ ast->root, false });
+
+    // check nodes in the order the recursive traversal would reach them
+    while(!pending.empty()) {
+        pendingFlatNode next = pending.back();
+        pending.pop_back();
+
+        if(next.closesScope) {
+            closeScope(&symbols);
+        } else {
+            result &= checkFlatNode(ast, next.node, pending);
         }
-        it++;
     }
 
-    return false;
+    return result;
 }
 
-/* deletes any symbols in the given symbol table from the symbol set */
-void deleteNonActiveSymbols_opt(vector<char*>* symbols) {
-    assert(symbols != NULL);
-    vector<char*>::iterator it = symbols->begin();
-    while(it != symbols->end() ) {
-        assert(*it != NULL);
-        activeSymbols.erase(string(*it));
-        it++;
+/* checks a single node of the flat AST, pushing its children onto the pending stack
+ * in reverse so that they are popped from left to right
+ */
+bool checkFlatNode(flatAST* ast, int32_t node, vector<pendingFlatNode>& pending) {
+    assert(node >= 0 && node < ast->size);
+
+    bool result = true;
+    int32_t first = ast->first[node];
+    int32_t second = ast->second[node];
+    int32_t third = ast->third[node];
+
+    // react based on node kinds
+    switch(ast->kinds[node]) {
+
+        // traverse into the function, the externs need no checks
+        case(flat_prog):
+            pending.push_back({ third, false });
+            break;
+
+        // check if the variable is on the symbol table, if not print an error
+        case(flat_var):
+            ast->second[node] = resolveSymbol(&symbols, first); // the slot of its innermost declaration
+            if(ast->second[node] < 0) {
+                fprintf(stderr, "Symbol error: var [%s] has not been declared\n\n", internedName(first));
+                result = false;
+            }
+            break;
+
+        // traverse nodes
+        case(flat_rexpr):
+        case(flat_bexpr):
+        case(flat_while):
+        case(flat_asgn):
+            pending.push_back({ second, false });
+            pending.push_back({ first, false });
+            break;
+
+        // traverse nodes
+        case(flat_uexpr):
+        case(flat_ret):
+            pending.push_back({ first, false });
+            break;
+
+        // traverse nodes
+        case(flat_call):
+            if(second != FLAT_NONE) {
+                pending.push_back({ second, false });
+            }
+            break;
+
+        // traverse nodes
+        case(flat_if):
+            if(third != FLAT_NONE) {
+                pending.push_back({ third, false });
+            }
+            pending.push_back({ second, false });
+            pending.push_back({ first, false });
+            break;
+
+        // if a declaration, add var to list in top of stack, error if already declared there
+        case(flat_decl):
+            if(declaredInScope(&symbols, first)) {
+                fprintf(stderr, "Symbol error: var [%s] has already been declared\n\n", internedName(first));
+                result = false;
+                break;
+            }
+            ast->second[node] = declareSymbol(&symbols, first);
+            break;
+
+        // create new var list with the parameter if it exists
+        case(flat_func): {
+            openScope(&symbols);
+            startFunction(&symbols);
+            if(second != FLAT_NONE) {
+                ast->second[second] = declareSymbol(&symbols, ast->first[second]);
+            }
+
+            // traverse into body of function, then close its scope
+            pending.push_back({ FLAT_NONE, true });
+            pending.push_back({ third, false });
+            break;
+        }
+
+        // if a block statement, create new var list and iterate statements, last first
+        case(flat_block): {
+            openScope(&symbols);
+            pending.push_back({ FLAT_NONE, true }); // closed once all statements are checked
+            for(int32_t i = first + second - 1; i >= first; i--) {
+                pending.push_back({ ast->children[i], false });
+            }
+            break;
+        }
+
+        // do nothing
+        default:
+            break;
     }
-}
\ No newline at end of file
+
+    return result;
+}
@@ -1,4 +1,6 @@
 #include "../lib/ast/ast.h"
+#include "../lib/ast/flat_ast.h"
+#include "symbol_table.h"
 
 /* FUNCTIONS */
 /* --------- */
@@ -8,3 +10,12 @@ bool semanticAnalysis(astNode* node);
 
 // optimized methods
 bool semanticAnalysis_opt(astNode* node);
+
+// checks the fused IR builder runs on each node as it reaches it, sharing the optimized symbol table
+symbolTable* semanticSymbols();
+bool checkVariable(astNode* node);
+bool checkDeclaration(astNode* node);
+bool checkExpression(astNode* node);
+
+// flat AST methods
+bool semanticAnalysis_flat(flatAST* ast);
@@ -0,0 +1,165 @@
+/*
+ * Library that loads a source file into memory for the scanner, mapping regular files
+ * directly so that flex lexes them without any stdio reads or copies
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "source_buffer.h"
+//#define NDEBUG
+#include <cassert>
+
+using namespace std;
+
+/* FUNCTION PROTOTYPES */
+/* ------------------- */
+bool mapSource(int fd, size_t size, sourceBuffer* source);
+bool readSource(int fd, sourceBuffer* source);
+
+/* FUNCTIONS */
+/* --------- */
+
+/* loads the file at the path, or stdin if the path is NULL or "-"
+ * returns false if it could not be opened or read
+ */
+bool loadSource(const char* path, sourceBuffer* source) {
+    assert(source != NULL);
+    source->data = NULL;
+    source->size = 0;
+    source->length = 0;
+    source->mapped = false;
+
+    if(path == NULL || strcmp(path, "-") == 0) {
+        return readSource(STDIN_FILENO, source);
+    }
+
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        return false;
+    }
+
+    // only regular files can be mapped, and mapping an empty file fails
+    struct stat info;
+    bool loaded;
+    if(fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        loaded = mapSource(fd, info.st_size, source) || readSource(fd, source);
+    } else {
+        loaded = readSource(fd, source);
+    }
+
+    close(fd);
+    return loaded;
+}
+
+/* maps the file privately with room for the two NUL bytes after it
+ * the bytes past the end of a file in its last page read as zero, but if the file
+ * fills its last page exactly they would fault, so the file is mapped over a zeroed
+ * anonymous reservation that is at least two bytes longer
+ * the mapping is writable because flex briefly terminates each token in place -
+ * the pages it touches are copied, the file itself is never changed
+ */
+bool mapSource(int fd, size_t size, sourceBuffer* source) {
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t length = (size + 2 + page - 1) / page * page;
+
+    void* reserved = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(reserved == MAP_FAILED) {
+        return false;
+    }
+
+    void* data = mmap(reserved, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0);
+    if(data == MAP_FAILED) {
+        munmap(reserved, length);
+        return false;
+    }
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    source->data = (char*) data;
+    source->size = size;
+    source->length = length;
+    source->mapped = true;
+    return true;
+}
+
+/* reads the rest of the file descriptor into a growing heap buffer, for sources that cannot be mapped */
+bool readSource(int fd, sourceBuffer* source) {
+    size_t length = 4096;
+    size_t size = 0;
+    char* data = (char*) malloc(length);
+    if(data == NULL) {
+        return false;
+    }
+
+    while(true) {
+        // keep two bytes free for the terminators
+        if(length - size < 2 + 1024) {
+            length *= 2;
+            char* grown = (char*) realloc(data, length);
+            if(grown == NULL) {
+                free(data);
+                return false;
+            }
+            data = grown;
+        }
+
+        ssize_t bytes = read(fd, data + size, length - size - 2);
+        if(bytes < 0) {
+            free(data);
+            return false;
+        }
+        if(bytes == 0) {
+            break;
+        }
+        size += bytes;
+    }
+
+    data[size] = '\0';
+    data[size + 1] = '\0';
+
+    source->data = data;
+    source->size = size;
+    source->length = length;
+    source->mapped = false;
+    return true;
+}
+
+/* unmaps or frees the source */
+void releaseSource(sourceBuffer* source) {
+    assert(source != NULL);
+    if(source->data == NULL) {
+        return;
+    }
+
+    if(source->mapped) {
+        munmap(source->data, source->length);
+    } else {
+        free(source->data);
+    }
+    source->data = NULL;
+    source->size = 0;
+    source->length = 0;
+}
+
+/* hashes the bytes of the source, eight at a time, to tell whether a cached AST was made from it
+ * (FNV-1a over 64-bit words, then over the bytes left)
+ */
+uint64_t hashSource(sourceBuffer* source) {
+    assert(source != NULL && source->data != NULL);
+    const uint64_t prime = 0x100000001b3ULL;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    size_t i = 0;
+    for(; i + sizeof(uint64_t) <= source->size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, source->data + i, sizeof(word));
+        hash = (hash ^ word) * prime;
+    }
+    for(; i < source->size; i++) {
+        hash = (hash ^ (unsigned char) source->data[i]) * prime;
+    }
+    return hash;
+}
@@ -0,0 +1,24 @@
+#ifndef SOURCE_BUFFER_H
+#define SOURCE_BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* the contents of a source file in memory, followed by the two NUL bytes flex's yy_scan_buffer needs
+ * regular files are mapped copy-on-write, anything else (stdin, pipes) is read into the heap
+ */
+typedef struct {
+		char* data;
+		size_t size; // bytes of source, not counting the two NUL bytes after it
+		size_t length; // bytes mapped or allocated
+		bool mapped; // data comes from mmap rather than malloc
+	} sourceBuffer;
+
+/* FUNCTIONS */
+/* --------- */
+
+bool loadSource(const char* path, sourceBuffer* source);
+void releaseSource(sourceBuffer* source);
+uint64_t hashSource(sourceBuffer* source);
+
+#endif
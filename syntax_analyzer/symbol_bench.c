@@ -0,0 +1,114 @@
+/*
+ * This is a benchmark program for the symbol table which checks functions whose blocks
+ * each declare thousands of variables, shadowing the declarations of the enclosing block,
+ * timing the scope-list lookups of semanticAnalysis against the scoped table of semanticAnalysis_opt
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <time.h>
+#include "semantic_analysis.h"
+#include "../helper/elapsed_time.h"
+using namespace std;
+
+/* FUNCTION PROTOTYPES */
+/* ------------------- */
+
+astNode* wideTree(int numBlocks, int numVars);
+astNode* wideBlock(int numVars, int shift, astNode* inner);
+bool checkRedeclaration(int numVars);
+
+
+/* MAIN */
+/* ---- */
+
+int main(int argc, char** argv){
+
+    // checks [blocks] nested blocks of [variables] declarations for each width, the best of [repeats] runs
+    int numBlocks = (argc > 1) ? atoi(argv[1]) : 4;
+    int repeats = (argc > 2) ? atoi(argv[2]) : 3;
+    assert(numBlocks > 0 && repeats > 0);
+    int widths[] = { 1000, 4000, 16000 };
+
+    printf("%-10s %-8s %16s %22s\n", "variables", "blocks", "semanticAnalysis", "semanticAnalysis_opt");
+    for(int w = 0; w < 3; w++) {
+        astNode* root = wideTree(numBlocks, widths[w]);
+        double best[2] = { -1, -1 };
+        for(int r = 0; r < repeats; r++) {
+            struct timespec times[3];
+            clock_gettime(CLOCK_MONOTONIC, &times[0]);
+            bool valid = semanticAnalysis(root);
+            clock_gettime(CLOCK_MONOTONIC, &times[1]);
+            bool validOpt = semanticAnalysis_opt(root);
+            clock_gettime(CLOCK_MONOTONIC, &times[2]);
+            assert(valid && validOpt);
+
+            for(int i = 0; i < 2; i++) {
+                double ms = elapsedMs(times[i], times[i + 1]);
+                if(best[i] < 0 || ms < best[i]) {
+                    best[i] = ms;
+                }
+            }
+        }
+        printf("%-10d %-8d %13.2f ms %19.2f ms\n", widths[w], numBlocks, best[0], best[1]);
+        freeNode(root);
+    }
+
+    // a redeclaration at the end of a wide block must still be caught
+    return checkRedeclaration(widths[2]) ? 0 : 1;
+}
+
+/* returns a program whose function nests the given number of blocks, each declaring
+ * the same variables as the block around it and assigning each from its neighbour,
+ * so every name is shadowed and resolves to the innermost block's declaration
+ */
+astNode* wideTree(int numBlocks, int numVars) {
+    astNode* body = NULL;
+    for(int b = numBlocks - 1; b >= 0; b--) {
+        body = wideBlock(numVars, b + 1, body);
+    }
+
+    astNode* func = createFunc("func", createVar("p"), body);
+    return createProg(createExtern("print"), createExtern("read"), func);
+}
+
+/* returns a block declaring var_0 to var_[numVars - 1], assigning var_i from var_[i + shift],
+ * then holding the inner block if there is one, and returning p
+ */
+astNode* wideBlock(int numVars, int shift, astNode* inner) {
+    astNodeList* stmts = createNodeList();
+    char name[32];
+    char other[32];
+    for(int v = 0; v < numVars; v++) {
+        snprintf(name, sizeof(name), "var_%d", v);
+        stmts->push_back(createDecl(name));
+    }
+    for(int v = 0; v < numVars; v++) {
+        snprintf(name, sizeof(name), "var_%d", v);
+        snprintf(other, sizeof(other), "var_%d", (v + shift) % numVars);
+        stmts->push_back(createAsgn(createVar(name), createBExpr(createVar(other), createVar("p"), add)));
+    }
+    if(inner != NULL) {
+        stmts->push_back(inner);
+    }
+    stmts->push_back(createRet(createVar("p")));
+    return createBlock(stmts);
+}
+
+/* checks that semanticAnalysis_opt reports a name declared twice in a wide block, on stderr */
+bool checkRedeclaration(int numVars) {
+    astNode* root = wideTree(1, numVars);
+    astNodeList* stmts = root->prog.func->func.body->stmt.block.stmt_list;
+    stmts->insert(stmts->begin() + numVars, createDecl("var_0"));
+
+    bool valid = semanticAnalysis_opt(root);
+    freeNode(root);
+    if(valid) {
+        printf("FAIL: var_0 was declared twice in a block of %d declarations without an error\n", numVars);
+        return false;
+    }
+    printf("PASS: redeclaration found in a block of %d declarations\n", numVars);
+    return true;
+}
@@ -0,0 +1,79 @@
+/*
+ * Library of the scoped symbol table semantic analysis resolves variables with,
+ * mapping each interned name to the stack slot of its innermost declaration
+*/
+#include <stdlib.h>
+#include "../lib/ast/ast.h"
+#include "symbol_table.h"
+//#define NDEBUG
+#include <cassert>
+
+using namespace std;
+
+/* FUNCTIONS */
+/* --------- */
+
+/* opens a new scope inside the current one */
+void openScope(symbolTable* table) {
+    assert(table != NULL);
+    table->scopeMarks.push_back(table->undoLog.size());
+}
+
+/* closes the innermost scope, undoing its declarations last first,
+ * which makes visible again the declarations they shadowed
+ */
+void closeScope(symbolTable* table) {
+    assert(table != NULL && !table->scopeMarks.empty());
+    size_t mark = table->scopeMarks.back();
+    table->scopeMarks.pop_back();
+
+    while(table->undoLog.size() > mark) {
+        symbolUndo undo = table->undoLog.back();
+        table->undoLog.pop_back();
+        table->entries[undo.id] = undo.hidden;
+    }
+}
+
+/* starts handing out slots from 0 again for the next function */
+void startFunction(symbolTable* table) {
+    assert(table != NULL);
+    table->numSlots = 0;
+}
+
+/* declares a name in the innermost scope, giving it the function's next stack slot
+ * the declaration of the same name in an outer scope, if any, is hidden until this scope closes
+ * returns the slot
+ */
+int declareSymbol(symbolTable* table, int id) {
+    assert(table != NULL && !table->scopeMarks.empty());
+    assert(id >= 0);
+    if(id >= (int) table->entries.size()) {
+        symbolEntry undeclared = { -1, 0 };
+        table->entries.resize(internedCount(), undeclared);
+    }
+
+    symbolEntry* entry = &table->entries[id];
+    table->undoLog.push_back({ id, *entry });
+    entry->slot = table->numSlots++;
+    entry->depth = table->scopeMarks.size();
+    return entry->slot;
+}
+
+/* returns the slot of the innermost declaration of the name in the open scopes, or -1 if there is none */
+int resolveSymbol(symbolTable* table, int id) {
+    assert(table != NULL);
+    assert(id >= 0);
+    return (id < (int) table->entries.size()) ? table->entries[id].slot : -1;
+}
+
+/* checks if the name has been declared in the innermost scope */
+bool declaredInScope(symbolTable* table, int id) {
+    assert(table != NULL);
+    assert(id >= 0);
+    if(id >= (int) table->entries.size()) {
+        return false;
+    }
+
+    symbolEntry* entry = &table->entries[id];
+    return entry->slot >= 0 && entry->depth == (int) table->scopeMarks.size();
+}
@@ -0,0 +1,41 @@
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+
+#include <stddef.h>
+#include <vector>
+
+/* the declaration a name resolves to in the open scopes */
+typedef struct {
+		int slot; // stack slot of the declaration, -1 if the name is not declared in any open scope
+		int depth; // number of scopes open when it was declared
+	} symbolEntry;
+
+/* a declaration made in an open scope, with the entry it hid so closing the scope can restore it */
+typedef struct {
+		int id;
+		symbolEntry hidden;
+	} symbolUndo;
+
+/* scoped symbol table keyed by interned ID, which is dense, so each name's entry is found by indexing
+ * with no hashing or probing, and each entry is the top of that name's shadow stack,
+ * the rest of which is kept in the undo log
+ * lookups and redeclaration checks only read the name's entry, whatever the number of names in scope,
+ * and closing a scope unwinds the log back to where the scope began */
+typedef struct {
+		std::vector<symbolEntry> entries; // by interned ID, grown to fit every ID declared so far
+		std::vector<symbolUndo> undoLog; // every declaration in the open scopes, the innermost last
+		std::vector<size_t> scopeMarks; // length of the undo log as each open scope was entered
+		int numSlots; // slots handed out in the current function
+	} symbolTable;
+
+/* FUNCTIONS */
+/* --------- */
+
+void openScope(symbolTable* table);
+void closeScope(symbolTable* table);
+void startFunction(symbolTable* table);
+int declareSymbol(symbolTable* table, int id);
+int resolveSymbol(symbolTable* table, int id);
+bool declaredInScope(symbolTable* table, int id);
+
+#endif
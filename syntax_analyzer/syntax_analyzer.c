@@ -8,43 +8,39 @@
 #include<assert.h>
 #include<string.h>
 #include "semantic_analysis.h"
+#include "parser.h"
 using namespace std;
 
-/* EXTERNS */
-/* ------- */
-
-extern void yyparse();
-extern int yylex_destroy();
-extern FILE *yyin;
-extern char* yytext;
-
 /* GLOBAL VARIABLES */
 /* ---------------- */
 
 astNode* root; // root of the AST
+astArena* arena; // owns every node of the AST
+FILE* input = stdin; // source file, or stdin if none is given
 
 /* MAIN */
 /* ---- */
 
 int main(int argc, char** argv){
 	if (argc == 2){
-		yyin = fopen(argv[1], "r");
+		input = fopen(argv[1], "r");
 	}
 
     // generate the AST
-	yyparse();
+	arena = createArena();
+	root = parseFile(input, arena);
     printf("AST:\n--------------\n");
     printNode(root);
     printf("\nRESULT:\n---------\n");
 
     // check semantics of the program
     bool validSemantics = semanticAnalysis_opt(root); // run with or without _opt extension - _opt trades memory for runtime
-    freeNode(root);
+    printArenaStatistics(stderr, arena);
+    freeArena(arena);
 
     // close
-	if (yyin != stdin)
-		fclose(yyin);
-	yylex_destroy();
+	if (input != stdin)
+		fclose(input);
 	
     // return if failure
     if(!validSemantics) return 1;